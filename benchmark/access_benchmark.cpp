@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ndarray.h>
+#include <fixed_ndarray.h>
+#include <ndarray_view.h>
+
+static void BM_AtRank2(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n);
+  array.set_value(1.0);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        sum += array.at(i, j);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n * n));
+}
+
+static void BM_AtRank4(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n, n, n);
+  array.set_value(1.0);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        for (size_t k = 0; k < n; ++k) {
+          for (size_t l = 0; l < n; ++l) {
+            sum += array.at(i, j, k, l);
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n * n * n * n));
+}
+
+static void BM_RefRank2(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n);
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        *array.ref(i, j) = double(j);
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n * n));
+}
+
+static void BM_FixedAtRank2(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::fixed_ndarray<double, 2> array(n, n);
+  array.set_value(1.0);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        sum += array(i, j);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n * n));
+}
+
+static void BM_PointerRank2(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n);
+  array.set_value(1.0);
+  for (auto _ : state) {
+    const double *p = array.begin();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        sum += p[i * n + j];
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n * n));
+}
+
+BENCHMARK(BM_AtRank2)->Arg(64)->Arg(512);
+BENCHMARK(BM_AtRank4)->Arg(8)->Arg(24);
+BENCHMARK(BM_RefRank2)->Arg(64)->Arg(512);
+BENCHMARK(BM_FixedAtRank2)->Arg(64)->Arg(512);
+BENCHMARK(BM_PointerRank2)->Arg(64)->Arg(512);
+
+// slicing creates views, items are the created views
+
+static void BM_SliceIndex(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n, n);
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i) {
+      ndarray::ndarray<double> view = array(i);
+      benchmark::DoNotOptimize(view.begin());
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+}
+
+static void BM_SliceIndexPair(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n, n);
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i) {
+      ndarray::ndarray<double> view = array(i, n - 1 - i);
+      benchmark::DoNotOptimize(view.begin());
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+}
+
+static void BM_SliceRange(benchmark::State &state) {
+  using ndarray::range;
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> array(n, n, n);
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i) {
+      ndarray::ndarray<double> view = array(range(0, i + 1), range(ndarray::none, ndarray::none, -2), i);
+      benchmark::DoNotOptimize(view.begin());
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+}
+
+BENCHMARK(BM_SliceIndex)->Arg(16)->Arg(128);
+BENCHMARK(BM_SliceIndexPair)->Arg(16)->Arg(128);
+BENCHMARK(BM_SliceRange)->Arg(16)->Arg(128);
+
+// rows of one array sliced by all threads: slices of ndarray update the shared reference count,
+// slices of ndarray_view only copy the layout
+
+template<typename Array>
+static void BM_SharedSliceIndex(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  static ndarray::ndarray<double> array(n, n);
+  Array shared = array;
+  for (auto _ : state) {
+    for (size_t i = 0; i < n; ++i) {
+      Array row = shared(i);
+      benchmark::DoNotOptimize(row.begin());
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+}
+
+BENCHMARK_TEMPLATE(BM_SharedSliceIndex, ndarray::ndarray<double>)->Arg(128)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_SharedSliceIndex, ndarray::ndarray_view<double>)->Arg(128)->ThreadRange(1, 8);
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <complex>
+
+#include <ndarray_math.h>
+
+// Elementwise kernels are memory bound for large arrays, bytes processed count both operands and the result.
+
+template<typename T1, typename T2>
+static void BM_Add(benchmark::State &state) {
+  using result_t = decltype(T1{} + T2{});
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T1> a(n);
+  ndarray::ndarray<T2> b(n);
+  a.set_value(1.0);
+  b.set_value(2.0);
+  for (auto _ : state) {
+    ndarray::ndarray<result_t> c = a + b;
+    benchmark::DoNotOptimize(c.begin());
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * (sizeof(T1) + sizeof(T2) + sizeof(result_t))));
+}
+
+template<typename T>
+static void BM_AddScalar(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> c = a + T(3.0);
+    benchmark::DoNotOptimize(c.begin());
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+template<typename T1, typename T2>
+static void BM_InplaceAdd(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T1> a(n);
+  ndarray::ndarray<T2> b(n);
+  b.set_value(1.0);
+  for (auto _ : state) {
+    a += b;
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * (2 * sizeof(T1) + sizeof(T2))));
+}
+
+template<typename T>
+static void BM_Scale(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    a *= typename ndarray::detail::real_type<T>::type(1.0);
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+// fused update against the same update through a temporary
+template<typename T>
+static void BM_Axpy(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> x(n);
+  ndarray::ndarray<T> y(n);
+  x.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::axpy(0.5, x, y);
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(3 * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_AxpyTemporary(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> x(n);
+  ndarray::ndarray<T> y(n);
+  x.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> t = x.copy();
+    t *= 0.5;
+    y += t;
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(3 * n * sizeof(T)));
+}
+
+// every arithmetic operator through a common template, the result of expressions is a new array
+
+struct add_op {
+  template<typename A, typename B>
+  static auto apply(const A &a, const B &b) -> decltype(a + b) { return a + b; }
+};
+
+struct sub_op {
+  template<typename A, typename B>
+  static auto apply(const A &a, const B &b) -> decltype(a - b) { return a - b; }
+};
+
+struct add_assign_op {
+  template<typename A, typename B>
+  static void apply(A &a, const B &b) { a += b; }
+};
+
+struct sub_assign_op {
+  template<typename A, typename B>
+  static void apply(A &a, const B &b) { a -= b; }
+};
+
+struct mul_assign_op {
+  template<typename A, typename B>
+  static void apply(A &a, const B &b) { a *= b; }
+};
+
+struct div_assign_op {
+  template<typename A, typename B>
+  static void apply(A &a, const B &b) { a /= b; }
+};
+
+template<typename T, typename Op>
+static void BM_Operator(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  a.set_value(1.0);
+  b.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> c = Op::apply(a, b);
+    benchmark::DoNotOptimize(c.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(3 * n * sizeof(T)));
+}
+
+template<typename T, typename Op>
+static void BM_ScalarOperator(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> c = Op::apply(a, T(1.0));
+    benchmark::DoNotOptimize(c.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+// operands are ones, so that repeated in-place updates keep values finite
+template<typename T, typename Op>
+static void BM_InplaceOperator(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  a.set_value(1.0);
+  b.set_value(1.0);
+  for (auto _ : state) {
+    Op::apply(a, b);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(3 * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_Negate(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> c = -a;
+    benchmark::DoNotOptimize(c.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_Equal(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  a.set_value(1.0);
+  b.set_value(1.0);
+  for (auto _ : state) {
+    bool equal = a == b;
+    benchmark::DoNotOptimize(equal);
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+#define NDARRAY_OPERATOR_BENCHMARKS(T) \
+  BENCHMARK_TEMPLATE(BM_Operator, T, add_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_Operator, T, sub_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_ScalarOperator, T, add_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_ScalarOperator, T, sub_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_InplaceOperator, T, add_assign_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_InplaceOperator, T, sub_assign_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_InplaceOperator, T, mul_assign_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_InplaceOperator, T, div_assign_op)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_Negate, T)->Arg(1 << 12)->Arg(1 << 22); \
+  BENCHMARK_TEMPLATE(BM_Equal, T)->Arg(1 << 12)->Arg(1 << 22)
+
+NDARRAY_OPERATOR_BENCHMARKS(int);
+NDARRAY_OPERATOR_BENCHMARKS(float);
+NDARRAY_OPERATOR_BENCHMARKS(double);
+NDARRAY_OPERATOR_BENCHMARKS(std::complex<float>);
+NDARRAY_OPERATOR_BENCHMARKS(std::complex<double>);
+
+// second argument is the instruction set: 0 - scalar, 1 - SSE2, 2 - AVX2, 3 - AVX-512
+static void simd_arguments(benchmark::internal::Benchmark *b) {
+  for (int64_t n : {1 << 12, 1 << 16, 1 << 22}) {
+    for (int64_t level = 0; level <= 3; ++level) {
+      b->Args({n, level});
+    }
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_Add, double, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Add, float, float)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Add, std::complex<double>, std::complex<double>)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Add, double, std::complex<double>)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Add, std::complex<float>, float)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_AddScalar, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_AddScalar, std::complex<double>)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_InplaceAdd, double, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_InplaceAdd, std::complex<double>, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Scale, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Scale, std::complex<float>)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_Axpy, double)->Apply(simd_arguments);
+BENCHMARK_TEMPLATE(BM_AxpyTemporary, double)->Apply(simd_arguments);
+
+template<typename T>
+static void BM_AddThreads(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  size_t previous = ndarray::set_num_threads(size_t(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  ndarray::ndarray<T> c(n);
+  a.set_value(1.0);
+  b.set_value(2.0);
+  for (auto _ : state) {
+    c += a;
+    c -= b;
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_num_threads(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(6 * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_FillThreads(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  size_t previous = ndarray::set_num_threads(size_t(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  for (auto _ : state) {
+    a.set_value(1.0);
+    benchmark::ClobberMemory();
+  }
+  ndarray::set_num_threads(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(T)));
+}
+
+// second argument is the number of threads
+static void thread_arguments(benchmark::internal::Benchmark *b) {
+  for (int64_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+    b->Args({1 << 24, threads});
+  }
+  b->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_AddThreads, double)->Apply(thread_arguments);
+BENCHMARK_TEMPLATE(BM_FillThreads, double)->Apply(thread_arguments);
@@ -0,0 +1,8 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
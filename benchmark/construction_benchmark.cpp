@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <complex>
+
+#include <ndarray.h>
+
+// shape of the given rank with about `elements` elements in total
+static ndarray::shape_t cube_shape(size_t rank, size_t elements) {
+  size_t side = size_t(std::lround(std::pow(double(elements), 1.0 / double(rank))));
+  return ndarray::shape_t(rank, side);
+}
+
+template<typename T>
+static void BM_ConstructZero(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  for (auto _ : state) {
+    ndarray::ndarray<T> array(n, n);
+    benchmark::DoNotOptimize(array.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_ConstructUninitialized(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  for (auto _ : state) {
+    ndarray::ndarray<T> array(ndarray::uninitialized, n, n);
+    benchmark::DoNotOptimize(array.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_Copy(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> array(n, n);
+  array.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> copy = array.copy();
+    benchmark::DoNotOptimize(copy.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * n * sizeof(T)));
+}
+
+BENCHMARK_TEMPLATE(BM_ConstructZero, double)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_ConstructUninitialized, double)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_Copy, double)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_ConstructZero, std::complex<double>)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_ConstructUninitialized, std::complex<double>)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_Copy, std::complex<double>)->RangeMultiplier(4)->Range(256, 4096);
+
+// construction of arrays with the same number of elements and different ranks, the first argument is the rank
+template<typename T>
+static void BM_ConstructRank(benchmark::State &state) {
+  ndarray::shape_t shape = cube_shape(size_t(state.range(0)), size_t(state.range(1)));
+  size_t size = 1;
+  for (size_t s : shape) {
+    size *= s;
+  }
+  for (auto _ : state) {
+    ndarray::ndarray<T> array(shape);
+    benchmark::DoNotOptimize(array.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(size * sizeof(T)));
+}
+
+// construction of many small arrays is dominated by the bookkeeping of shapes and strides
+template<typename T>
+static void BM_ConstructSmall(benchmark::State &state) {
+  ndarray::shape_t shape = cube_shape(size_t(state.range(0)), 64);
+  for (auto _ : state) {
+    ndarray::ndarray<T> array(shape);
+    benchmark::DoNotOptimize(array.begin());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+static void rank_arguments(benchmark::internal::Benchmark *b) {
+  for (int64_t rank = 1; rank <= 4; ++rank) {
+    for (int64_t n : {1 << 12, 1 << 20}) {
+      b->Args({rank, n});
+    }
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_ConstructRank, float)->Apply(rank_arguments);
+BENCHMARK_TEMPLATE(BM_ConstructRank, double)->Apply(rank_arguments);
+BENCHMARK_TEMPLATE(BM_ConstructRank, std::complex<double>)->Apply(rank_arguments);
+BENCHMARK_TEMPLATE(BM_ConstructSmall, double)->DenseRange(1, 4);
+
+// second argument: 0 - the whole dense array, 1 - a view of every second column
+template<typename T>
+static void BM_SetValue(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> array(n, n);
+  ndarray::ndarray<T> target = state.range(1) ? array(ndarray::range(),
+                                                      ndarray::range(ndarray::none, ndarray::none, 2)) : array;
+  for (auto _ : state) {
+    target.set_value(1.0);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(target.size() * sizeof(T)));
+}
+
+template<typename T>
+static void BM_CopyStrided(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> array(n, n);
+  array.set_value(1.0);
+  ndarray::ndarray<T> view = array(ndarray::range(),
+                                   ndarray::range(ndarray::none, ndarray::none, 2));
+  for (auto _ : state) {
+    ndarray::ndarray<T> copy = view.copy();
+    benchmark::DoNotOptimize(copy.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * view.size() * sizeof(T)));
+}
+
+BENCHMARK_TEMPLATE(BM_SetValue, double)->Args({256, 0})->Args({256, 1})->Args({2048, 0})->Args({2048, 1});
+BENCHMARK_TEMPLATE(BM_SetValue, std::complex<float>)->Args({256, 0})->Args({256, 1})->Args({2048, 0})->Args({2048, 1});
+BENCHMARK_TEMPLATE(BM_CopyStrided, double)->Arg(256)->Arg(2048);
+BENCHMARK_TEMPLATE(BM_CopyStrided, std::complex<double>)->Arg(256)->Arg(2048);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <complex>
+#include <string>
+
+#include <einsum.h>
+
+// Matrix products report floating point operations as items processed (a complex multiply-add counts as one item).
+
+template<typename T>
+static void BM_Matmul(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<T> a(n, n);
+  ndarray::ndarray<T> b(n, n);
+  a.set_value(1.0);
+  b.set_value(2.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> c = ndarray::matmul(a, b);
+    benchmark::DoNotOptimize(c.begin());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n * n * n));
+}
+
+BENCHMARK_TEMPLATE(BM_Matmul, double)->Arg(64)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_Matmul, std::complex<double>)->Arg(64)->Arg(256);
+
+static void BM_EinsumContraction(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> a(n, n, n, n);
+  ndarray::ndarray<double> b(n, n);
+  a.set_value(1.0);
+  b.set_value(2.0);
+  for (auto _ : state) {
+    ndarray::ndarray<double> c = ndarray::einsum("ijkl,lm->ijkm", a, b);
+    benchmark::DoNotOptimize(c.begin());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n * n * n * n * n));
+}
+
+BENCHMARK(BM_EinsumContraction)->Arg(8)->Arg(32);
+
+// reversal of all axes of an array with 2^22 elements, the first argument is the rank
+template<typename T>
+static void BM_Transpose(benchmark::State &state) {
+  size_t rank = size_t(state.range(0));
+  std::string from = std::string("ijkl").substr(0, rank);
+  std::string pattern = from + "->" + std::string(from.rbegin(), from.rend());
+  ndarray::shape_t shape(rank, size_t(1) << (22 / rank));
+  shape[0] <<= 22 % rank;
+  ndarray::ndarray<T> a(shape);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<T> t = ndarray::transpose(a, pattern);
+    benchmark::DoNotOptimize(t.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * a.size() * sizeof(T)));
+}
+
+BENCHMARK_TEMPLATE(BM_Transpose, float)->DenseRange(2, 4);
+BENCHMARK_TEMPLATE(BM_Transpose, double)->DenseRange(2, 4);
+BENCHMARK_TEMPLATE(BM_Transpose, std::complex<double>)->DenseRange(2, 4);
+
+// transpose of many small blocks, with a pattern string and with a precompiled plan
+
+static void BM_TransposeBlocks(benchmark::State &state) {
+  ndarray::ndarray<double> a(256, 4, 6, 8);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    for (size_t b = 0; b < 256; ++b) {
+      ndarray::ndarray<double> t = ndarray::transpose(a(b), "ijk->kji");
+      benchmark::DoNotOptimize(t.begin());
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * a.size() * sizeof(double)));
+}
+
+BENCHMARK(BM_TransposeBlocks);
+
+static void BM_TransposeBlocksPlan(benchmark::State &state) {
+  ndarray::ndarray<double> a(256, 4, 6, 8);
+  a.set_value(1.0);
+  ndarray::ndarray<double> t(8, 6, 4);
+  std::shared_ptr<const ndarray::transpose_plan> plan = ndarray::get_transpose_plan("ijk->kji", a(0));
+  for (auto _ : state) {
+    for (size_t b = 0; b < 256; ++b) {
+      plan->execute(a(b), t);
+      benchmark::DoNotOptimize(t.begin());
+    }
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * a.size() * sizeof(double)));
+}
+
+BENCHMARK(BM_TransposeBlocksPlan);
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <complex>
+#include <cstdio>
+#include <string>
+
+#include <checkpoint.h>
+#include <mapped_ndarray.h>
+#include <ndarray_io.h>
+#include <reduction.h>
+
+// files are written to the working directory, bytes processed count the payload of a file
+
+static const char *io_benchmark_file = "ndarray_io_benchmark.bin";
+
+static void BM_Save(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::save(a, io_benchmark_file);
+  }
+  std::remove(io_benchmark_file);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(double)));
+}
+
+// opening a mapped file does not read the data
+static void BM_Load(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> a(n);
+  a.set_value(1.0);
+  ndarray::save(a, io_benchmark_file);
+  for (auto _ : state) {
+    ndarray::ndarray<double> loaded = ndarray::load<double>(io_benchmark_file);
+    benchmark::DoNotOptimize(loaded.begin());
+  }
+  std::remove(io_benchmark_file);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(double)));
+}
+
+// open and read every element
+static void BM_LoadSum(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<double> a(n);
+  a.set_value(1.0);
+  ndarray::save(a, io_benchmark_file);
+  for (auto _ : state) {
+    double s = ndarray::sum(ndarray::load<double>(io_benchmark_file));
+    benchmark::DoNotOptimize(s);
+  }
+  std::remove(io_benchmark_file);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(double)));
+}
+
+BENCHMARK(BM_Save)->Arg(1 << 16)->Arg(1 << 24);
+BENCHMARK(BM_Load)->Arg(1 << 16)->Arg(1 << 24);
+BENCHMARK(BM_LoadSum)->Arg(1 << 16)->Arg(1 << 24);
+
+// update of a file-backed array in place, as a whole and block by block
+static void BM_MappedScale(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  size_t rows = size_t(state.range(1));
+  ndarray::mapped_ndarray<double> mapped = ndarray::mapped_ndarray<double>::create(io_benchmark_file, {n, 1024});
+  for (auto _ : state) {
+    if (rows == 0) {
+      ndarray::ndarray<double> array = mapped.array();
+      array *= 0.5;
+    } else {
+      mapped.for_each_chunk(rows, [](ndarray::ndarray<double> block, size_t) { block *= 0.5; });
+    }
+    benchmark::ClobberMemory();
+  }
+  std::remove(io_benchmark_file);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * 1024 * sizeof(double)));
+}
+
+BENCHMARK(BM_MappedScale)->Args({4096, 0})->Args({4096, 256});
+
+// time the caller is stalled by a checkpoint: the snapshot is taken synchronously, the file is written
+// in the background (waiting for it is not timed)
+static void BM_CheckpointStall(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::ndarray<std::complex<double> > a(n);
+  a.set_value(1.0);
+  ndarray::checkpoint_writer writer(2 * n * sizeof(std::complex<double>));
+  for (auto _ : state) {
+    writer.save(a, io_benchmark_file);
+    state.PauseTiming();
+    writer.wait();
+    state.ResumeTiming();
+  }
+  std::remove(io_benchmark_file);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(std::complex<double>)));
+}
+
+BENCHMARK(BM_CheckpointStall)->Arg(1 << 16)->Arg(1 << 22);
+
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <complex>
+
+#include <reduction.h>
+
+// Reductions only read their operands, bytes processed count the elements of all operands.
+
+template<typename T>
+static void BM_Sum(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::summation mode = state.range(2) ? ndarray::summation::compensated : ndarray::summation::standard;
+  ndarray::ndarray<T> a(n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    T s = ndarray::sum(a, mode);
+    benchmark::DoNotOptimize(s);
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_Vdot(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::summation mode = state.range(2) ? ndarray::summation::compensated : ndarray::summation::standard;
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  a.set_value(1.0);
+  b.set_value(2.0);
+  for (auto _ : state) {
+    T s = ndarray::vdot(a, b, mode);
+    benchmark::DoNotOptimize(s);
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_MaxAbs(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  a.set_value(-1.0);
+  for (auto _ : state) {
+    T m = ndarray::max_abs(a);
+    benchmark::DoNotOptimize(m);
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * sizeof(T)));
+}
+
+template<typename T>
+static void BM_Allclose(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(state.range(1)));
+  ndarray::ndarray<T> a(n);
+  ndarray::ndarray<T> b(n);
+  a.set_value(1.0);
+  b.set_value(1.0 + 1e-7);
+  for (auto _ : state) {
+    bool close = ndarray::allclose(a, b);
+    benchmark::DoNotOptimize(close);
+  }
+  ndarray::set_simd_level(previous);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * sizeof(T)));
+}
+
+// sum of a square matrix over rows (axis 1) and over columns (axis 0)
+static void BM_SumAxis(benchmark::State &state) {
+  size_t n = size_t(state.range(0));
+  size_t axis = size_t(state.range(1));
+  ndarray::ndarray<double> a(n, n);
+  a.set_value(1.0);
+  for (auto _ : state) {
+    ndarray::ndarray<double> s = ndarray::sum(a, {axis});
+    benchmark::DoNotOptimize(s.begin());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(n * n * sizeof(double)));
+}
+
+// second argument is the instruction set: 0 - scalar, 1 - SSE2, 2 - AVX2, 3 - AVX-512,
+// third one is the summation mode: 0 - standard, 1 - compensated
+static void reduction_arguments(benchmark::internal::Benchmark *b) {
+  for (int64_t n : {1 << 16, 1 << 22}) {
+    for (int64_t level = 0; level <= 3; ++level) {
+      for (int64_t mode = 0; mode <= 1; ++mode) {
+        b->Args({n, level, mode});
+      }
+    }
+  }
+}
+
+static void level_arguments(benchmark::internal::Benchmark *b) {
+  for (int64_t n : {1 << 16, 1 << 22}) {
+    for (int64_t level = 0; level <= 3; ++level) {
+      b->Args({n, level});
+    }
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_Sum, double)->Apply(reduction_arguments);
+BENCHMARK_TEMPLATE(BM_Sum, float)->Apply(reduction_arguments);
+BENCHMARK_TEMPLATE(BM_Vdot, double)->Apply(reduction_arguments);
+BENCHMARK_TEMPLATE(BM_Vdot, std::complex<double>)->Apply(reduction_arguments);
+BENCHMARK_TEMPLATE(BM_MaxAbs, double)->Apply(level_arguments);
+BENCHMARK_TEMPLATE(BM_Allclose, double)->Apply(level_arguments);
+BENCHMARK_TEMPLATE(BM_Allclose, float)->Apply(level_arguments);
+BENCHMARK(BM_SumAxis)->Args({2048, 0})->Args({2048, 1});
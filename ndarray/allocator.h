@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_ALLOCATOR_H
+#define NDARRAY_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace ndarray {
+
+  /**
+   * Alignment (in bytes) of every buffer allocated for ndarray storage
+   */
+  constexpr size_t default_alignment = 64;
+
+  /**
+   * Snapshot of memory counters for ndarray storage
+   */
+  struct allocation_stats {
+    // number of buffers handed out to ndarrays
+    size_t allocations;
+    // number of buffers returned by ndarrays
+    size_t deallocations;
+    // number of requests forwarded to the system allocator (buffers and shared_ptr control blocks)
+    size_t system_allocations;
+    // number of blocks returned to the system allocator
+    size_t system_deallocations;
+    // bytes currently held by ndarrays
+    size_t bytes_in_use;
+  };
+
+  namespace detail {
+
+    struct allocation_counters {
+      std::atomic<size_t> allocations{0};
+      std::atomic<size_t> deallocations{0};
+      std::atomic<size_t> system_allocations{0};
+      std::atomic<size_t> system_deallocations{0};
+      std::atomic<size_t> bytes_in_use{0};
+    };
+
+    inline allocation_counters &counters() {
+      static allocation_counters c;
+      return c;
+    }
+
+  }
+
+  /**
+   * @return current values of memory counters
+   */
+  inline allocation_stats get_allocation_stats() {
+    detail::allocation_counters &c = detail::counters();
+    return allocation_stats{c.allocations.load(), c.deallocations.load(), c.system_allocations.load(),
+                            c.system_deallocations.load(), c.bytes_in_use.load()};
+  }
+
+  /**
+   * Reset event counters. Number of bytes in use is kept.
+   */
+  inline void reset_allocation_stats() {
+    detail::allocation_counters &c = detail::counters();
+    c.allocations = 0;
+    c.deallocations = 0;
+    c.system_allocations = 0;
+    c.system_deallocations = 0;
+  }
+
+  /**
+   * Interface of a memory source for ndarray storage. Every returned block has to be aligned to `default_alignment`.
+   * Resource has to outlive all the arrays allocated from it.
+   */
+  class memory_resource {
+  public:
+    virtual ~memory_resource() {}
+
+    virtual void *allocate(size_t bytes) = 0;
+
+    virtual void deallocate(void *p, size_t bytes) = 0;
+  };
+
+  /**
+   * Memory resource that takes aligned blocks directly from the system allocator
+   */
+  class aligned_resource : public memory_resource {
+  public:
+    void *allocate(size_t bytes) override {
+      // keep pointer to the raw block right in front of the aligned one
+      void *raw = ::operator new(bytes + default_alignment + sizeof(void *));
+      std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *);
+      std::uintptr_t aligned = (start + default_alignment - 1) & ~std::uintptr_t(default_alignment - 1);
+      reinterpret_cast<void **>(aligned)[-1] = raw;
+      ++detail::counters().system_allocations;
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    void deallocate(void *p, size_t) override {
+      if (p == nullptr) {
+        return;
+      }
+      ::operator delete(reinterpret_cast<void **>(p)[-1]);
+      ++detail::counters().system_deallocations;
+    }
+
+    static aligned_resource *instance() {
+      static aligned_resource resource;
+      return &resource;
+    }
+  };
+
+  /**
+   * Memory resource that keeps released blocks in per-size free lists and hands them out again
+   * for requests of the same size class. Intended for loops that repeatedly create temporaries
+   * of the same shapes, which become allocation free after the first iteration.
+   */
+  class pool_resource : public memory_resource {
+  public:
+    /**
+     * @param upstream - resource used when there is no cached block of a requested size class
+     * @param max_cached_bytes - upper bound for the amount of memory kept in free lists
+     */
+    explicit pool_resource(memory_resource *upstream = aligned_resource::instance(),
+                           size_t max_cached_bytes = size_t(-1)) :
+        upstream_(upstream), max_cached_bytes_(max_cached_bytes), cached_bytes_(0) {}
+
+    ~pool_resource() override {
+      release();
+    }
+
+    pool_resource(const pool_resource &) = delete;
+
+    pool_resource &operator=(const pool_resource &) = delete;
+
+    void *allocate(size_t bytes) override {
+      size_t size = size_class(bytes);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<void *> &blocks = free_[size];
+        if (!blocks.empty()) {
+          void *p = blocks.back();
+          blocks.pop_back();
+          cached_bytes_ -= size;
+          return p;
+        }
+      }
+      return upstream_->allocate(size);
+    }
+
+    void deallocate(void *p, size_t bytes) override {
+      size_t size = size_class(bytes);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cached_bytes_ + size <= max_cached_bytes_) {
+          free_[size].push_back(p);
+          cached_bytes_ += size;
+          return;
+        }
+      }
+      upstream_->deallocate(p, size);
+    }
+
+    /**
+     * Return all cached blocks to the upstream resource
+     */
+    void release() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &blocks : free_) {
+        for (void *p : blocks.second) {
+          upstream_->deallocate(p, blocks.first);
+        }
+      }
+      free_.clear();
+      cached_bytes_ = 0;
+    }
+
+    /**
+     * @return number of bytes kept in free lists
+     */
+    size_t cached_bytes() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return cached_bytes_;
+    }
+
+  private:
+    static size_t size_class(size_t bytes) {
+      return ((bytes + default_alignment - 1) / default_alignment) * default_alignment;
+    }
+
+    memory_resource *upstream_;
+    size_t max_cached_bytes_;
+    size_t cached_bytes_;
+    std::unordered_map<size_t, std::vector<void *> > free_;
+    mutable std::mutex mutex_;
+  };
+
+  namespace detail {
+
+    inline std::atomic<memory_resource *> &default_resource() {
+      static std::atomic<memory_resource *> resource(aligned_resource::instance());
+      return resource;
+    }
+
+  }
+
+  /**
+   * @return memory resource used for allocation of new ndarrays
+   */
+  inline memory_resource *get_default_resource() {
+    return detail::default_resource().load();
+  }
+
+  /**
+   * Change memory resource used for allocation of new ndarrays. Existing arrays release their memory into
+   * the resource they were allocated from.
+   *
+   * @param resource - new resource, `nullptr` restores the system aligned resource
+   * @return previous resource
+   */
+  inline memory_resource *set_default_resource(memory_resource *resource) {
+    return detail::default_resource().exchange(resource == nullptr ? aligned_resource::instance() : resource);
+  }
+
+  namespace detail {
+
+    /**
+     * STL allocator on top of memory_resource, used for shared_ptr control blocks
+     */
+    template<typename U>
+    struct resource_allocator {
+      using value_type = U;
+
+      explicit resource_allocator(memory_resource *r) : resource(r) {}
+
+      template<typename V>
+      resource_allocator(const resource_allocator<V> &rhs) : resource(rhs.resource) {}
+
+      U *allocate(size_t n) {
+        return static_cast<U *>(resource->allocate(n * sizeof(U)));
+      }
+
+      void deallocate(U *p, size_t n) {
+        resource->deallocate(p, n * sizeof(U));
+      }
+
+      template<typename V>
+      bool operator==(const resource_allocator<V> &rhs) const {
+        return resource == rhs.resource;
+      }
+
+      template<typename V>
+      bool operator!=(const resource_allocator<V> &rhs) const {
+        return resource != rhs.resource;
+      }
+
+      memory_resource *resource;
+    };
+
+    struct storage_deleter {
+      memory_resource *resource;
+      size_t bytes;
+
+      void operator()(const void *p) const {
+        resource->deallocate(const_cast<void *>(p), bytes);
+        ++counters().deallocations;
+        counters().bytes_in_use -= bytes;
+      }
+    };
+
+    /**
+     * Allocate uninitialized storage for `size` elements from the default memory resource.
+     * Both buffer and shared_ptr control block are taken from the resource.
+     *
+     * @tparam T - type of an element
+     * @param size - number of elements
+     * @return shared pointer to the storage
+     */
+    template<typename T>
+    std::shared_ptr<T> allocate_storage(size_t size) {
+      static_assert(std::is_trivially_destructible<T>::value, "");
+      memory_resource *resource = get_default_resource();
+      size_t bytes = size * sizeof(T);
+      T *p = static_cast<T *>(resource->allocate(bytes));
+      ++counters().allocations;
+      counters().bytes_in_use += bytes;
+      return std::shared_ptr<T>(p, storage_deleter{resource, bytes}, resource_allocator<T>(resource));
+    }
+
+  }
+}
+
+#endif //NDARRAY_ALLOCATOR_H
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_CHECKPOINT_H
+#define NDARRAY_CHECKPOINT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <ndarray/ndarray.h>
+#include <ndarray/ndarray_io.h>
+
+namespace ndarray {
+
+  /**
+   * Background writer of arrays for checkpoints. `save` takes a snapshot of an array in the calling thread,
+   * which costs one copy in memory, and stores it to a file on a background thread while the caller continues
+   * with the computation. The array can be modified as soon as `save` returns.
+   *
+   * Snapshots waiting to be written take at most `max_buffered_bytes`: when the limit would be exceeded,
+   * `save` waits for earlier writes to complete. With a limit of twice the size of a checkpoint, the next
+   * checkpoint is taken while the previous one is being written (double buffering). Buffers of written snapshots
+   * are kept within the same limit and reused, so repeated checkpoints do not allocate fresh memory.
+   *
+   * Files are written in the order of `save` calls. Errors are reported by the futures of the failed writes
+   * and of the next `barrier`. The destructor waits for all pending writes.
+   */
+  class checkpoint_writer {
+  public:
+    /**
+     * @param max_buffered_bytes - limit on the memory taken by snapshots waiting to be written. A single snapshot
+     * larger than the limit is accepted when nothing else is pending.
+     */
+    explicit checkpoint_writer(size_t max_buffered_bytes) : max_buffered_bytes_(max_buffered_bytes),
+                                                            buffered_bytes_(0), free_bytes_(0),
+                                                            stop_(false) {
+      thread_ = std::thread([this]() { work(); });
+    }
+
+    checkpoint_writer(const checkpoint_writer &) = delete;
+
+    checkpoint_writer &operator=(const checkpoint_writer &) = delete;
+
+    ~checkpoint_writer() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      queued_.notify_all();
+      thread_.join();
+    }
+
+    /**
+     * Snapshot array and store it in the native format (see `ndarray::save`) in the background
+     *
+     * @param array - array to store
+     * @param filename - path to the file
+     * @return future that becomes ready when the file is written, or holds the error of the write
+     */
+    template<typename T>
+    std::shared_future<void> save(const ndarray<T> &array, const std::string &filename) {
+      using value_type = typename std::remove_const<T>::type;
+      std::shared_ptr<buffer> storage = acquire(array.size() * sizeof(T));
+      value_type *data = reinterpret_cast<value_type *>(storage->data.get());
+      detail::transpose_copy(array.shape(), array.strides(), array.data().get() + array.offset(), data);
+      ndarray<value_type> snapshot(storage, data, array.shape());
+      return enqueue(storage, [snapshot, filename]() { ::ndarray::save(snapshot, filename); });
+    }
+
+    /**
+     * @return future that becomes ready when all writes requested so far are complete, e.g. when the whole
+     * checkpoint is stored. Holds the first error of the writes since the previous barrier.
+     */
+    std::shared_future<void> barrier() {
+      return enqueue(nullptr, std::function<void()>());
+    }
+
+    /**
+     * Wait for all writes requested so far
+     */
+    void wait() {
+      barrier().wait();
+    }
+
+    /**
+     * @return memory taken by snapshots that are not yet written
+     */
+    size_t buffered_bytes() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return buffered_bytes_;
+    }
+
+  private:
+    struct buffer {
+      std::unique_ptr<char[]> data;
+      size_t capacity;
+    };
+
+    struct task {
+      // empty for barriers
+      std::shared_ptr<buffer> storage;
+      std::function<void()> write;
+      std::shared_ptr<std::promise<void> > done;
+    };
+
+    size_t max_buffered_bytes_;
+    size_t buffered_bytes_;
+    // buffers of written snapshots
+    std::vector<std::shared_ptr<buffer> > free_;
+    size_t free_bytes_;
+    bool stop_;
+    std::exception_ptr error_;
+    std::deque<task> tasks_;
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable released_;
+    std::thread thread_;
+
+    /**
+     * Wait until a snapshot of `bytes` fits into the limit and get a buffer for it: the smallest free buffer
+     * that is large enough, or a new one after free buffers that do not fit into the limit are dropped
+     */
+    std::shared_ptr<buffer> acquire(size_t bytes) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      released_.wait(lock, [this, bytes]() {
+        return buffered_bytes_ == 0 || buffered_bytes_ + bytes <= max_buffered_bytes_;
+      });
+      std::vector<std::shared_ptr<buffer> >::iterator best = free_.end();
+      for (std::vector<std::shared_ptr<buffer> >::iterator it = free_.begin(); it != free_.end(); ++it) {
+        if ((*it)->capacity >= bytes && (best == free_.end() || (*it)->capacity < (*best)->capacity)) {
+          best = it;
+        }
+      }
+      std::shared_ptr<buffer> storage;
+      if (best != free_.end()) {
+        storage = *best;
+        free_.erase(best);
+        free_bytes_ -= storage->capacity;
+      } else {
+        while (!free_.empty() && buffered_bytes_ + free_bytes_ + bytes > max_buffered_bytes_) {
+          free_bytes_ -= free_.back()->capacity;
+          free_.pop_back();
+        }
+        storage = std::make_shared<buffer>();
+        storage->data.reset(new char[std::max(bytes, size_t(1))]);
+        storage->capacity = bytes;
+      }
+      buffered_bytes_ += storage->capacity;
+      return storage;
+    }
+
+    void release(const std::shared_ptr<buffer> &storage) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffered_bytes_ -= storage->capacity;
+        free_.push_back(storage);
+        free_bytes_ += storage->capacity;
+      }
+      released_.notify_all();
+    }
+
+    std::shared_future<void> enqueue(const std::shared_ptr<buffer> &storage, std::function<void()> write) {
+      std::shared_ptr<std::promise<void> > done = std::make_shared<std::promise<void> >();
+      std::shared_future<void> future = done->get_future().share();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(task{storage, std::move(write), done});
+      }
+      queued_.notify_one();
+      return future;
+    }
+
+    void work() {
+      for (;;) {
+        task next;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          queued_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+          if (tasks_.empty()) {
+            return;
+          }
+          next = std::move(tasks_.front());
+          tasks_.pop_front();
+        }
+        if (!next.write) {
+          std::exception_ptr error;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::swap(error, error_);
+          }
+          if (error) {
+            next.done->set_exception(error);
+          } else {
+            next.done->set_value();
+          }
+          continue;
+        }
+        try {
+          next.write();
+          // the snapshot is released before the write is reported as complete
+          next.write = std::function<void()>();
+          release(next.storage);
+          next.done->set_value();
+        } catch (...) {
+          next.write = std::function<void()>();
+          release(next.storage);
+          std::exception_ptr error = std::current_exception();
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+              error_ = error;
+            }
+          }
+          next.done->set_exception(error);
+        }
+      }
+    }
+  };
+
+}
+
+#endif //NDARRAY_CHECKPOINT_H
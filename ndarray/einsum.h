@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_EINSUM_H
+#define NDARRAY_EINSUM_H
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ndarray/ndarray_math.h>
+#include <ndarray/plan_cache.h>
+
+namespace ndarray {
+
+  // Einstein summation over latin index letters
+
+  namespace detail {
+
+    /**
+     * Type of the result of einsum over operands of types `T, Ts...`
+     */
+    template<typename T, typename...Ts>
+    struct einsum_result {
+      using type = typename std::remove_const<T>::type;
+    };
+
+    template<typename T, typename T2, typename...Ts>
+    struct einsum_result<T, T2, Ts...> {
+      using type = typename einsum_result<typename product_type<typename std::remove_const<T>::type,
+                                                                typename std::remove_const<T2>::type>::type,
+                                          Ts...>::type;
+    };
+
+    /**
+     * Parsed einsum pattern, one string of indices per operand and a string of indices of the result
+     */
+    struct einsum_pattern {
+      std::vector<std::string> inputs;
+      std::string output;
+    };
+
+    /**
+     * Parse einsum pattern of the form "ijkl,lm->ijkm". Without "->" the result has the indices that appear exactly
+     * once in the pattern, in alphabetical order.
+     *
+     * @param string_pattern - einsum pattern
+     * @param operands - number of operands
+     * @return indices of operands and of the result
+     */
+    inline einsum_pattern parse_einsum_pattern(const std::string &string_pattern, size_t operands) {
+      einsum_pattern pattern;
+      size_t find = string_pattern.find("->");
+      std::string from = string_pattern.substr(0, find);
+      size_t begin = 0;
+      while (true) {
+        size_t comma = from.find(',', begin);
+        std::string term = trim(from.substr(begin, comma == std::string::npos ? std::string::npos : comma - begin));
+        if (!all_latin(term)) {
+          throw std::runtime_error("Einsum indices should be latin letters.");
+        }
+        pattern.inputs.push_back(term);
+        if (comma == std::string::npos) {
+          break;
+        }
+        begin = comma + 1;
+      }
+      if (pattern.inputs.size() != operands) {
+        throw std::runtime_error("Number of einsum terms and number of operands are different.");
+      }
+      std::map<char, size_t> counts;
+      for (const std::string &term : pattern.inputs) {
+        for (char c : term) {
+          ++counts[c];
+        }
+      }
+      if (find == std::string::npos) {
+        for (const auto &count : counts) {
+          if (count.second == 1) {
+            pattern.output += count.first;
+          }
+        }
+        return pattern;
+      }
+      pattern.output = trim(string_pattern.substr(find + 2));
+      if (!all_latin(pattern.output)) {
+        throw std::runtime_error("Einsum indices should be latin letters.");
+      }
+      for (size_t k = 0; k < pattern.output.size(); ++k) {
+        if (counts.count(pattern.output[k]) == 0) {
+          throw std::runtime_error("Einsum result index is not found in operand indices.");
+        }
+        if (pattern.output.find(pattern.output[k], k + 1) != std::string::npos) {
+          throw std::runtime_error("Einsum result index is repeated.");
+        }
+      }
+      return pattern;
+    }
+
+    /**
+     * Intermediate operand of a contraction together with its indices, one distinct letter per axis
+     */
+    template<typename T>
+    struct einsum_operand {
+      ndarray<T> array;
+      std::string labels;
+
+      size_t extent(char label) const {
+        return array.shape()[labels.find(label)];
+      }
+    };
+
+    inline bool has_label(const std::string &labels, char label) {
+      return labels.find(label) != std::string::npos;
+    }
+
+    /**
+     * Bring operand to unique indices, repeated indices (e.g. "ii") select a diagonal with a strided view.
+     */
+    template<typename T>
+    einsum_operand<T> einsum_diagonal(const ndarray<T> &array, const std::string &labels) {
+      if (labels.size() != array.dim()) {
+        throw std::runtime_error("Number of einsum indices and array dimension are different.");
+      }
+      std::string unique;
+      shape_t shape;
+      shape_t strides;
+      for (size_t k = 0; k < labels.size(); ++k) {
+        size_t pos = unique.find(labels[k]);
+        if (pos == std::string::npos) {
+          unique += labels[k];
+          shape.push_back(array.shape()[k]);
+          strides.push_back(array.strides()[k]);
+        } else {
+          if (shape[pos] != array.shape()[k]) {
+            throw std::runtime_error("Repeated einsum index has different extents.");
+          }
+          strides[pos] += array.strides()[k];
+        }
+      }
+      return einsum_operand<T>{ndarray<T>(array, shape, strides, array.offset()), unique};
+    }
+
+    /**
+     * Sum operand over all indices not in `keep` and return a dense array with indices ordered as in `keep`.
+     * Returns the operand itself if it is already dense in the requested order.
+     *
+     * @param op - operand
+     * @param keep - indices of the result, subset of operand indices
+     */
+    template<typename T>
+    einsum_operand<T> einsum_reduce(const einsum_operand<T> &op, const std::string &keep) {
+      std::string order = keep;
+      for (char c : op.labels) {
+        if (!has_label(keep, c)) {
+          order += c;
+        }
+      }
+      std::vector<size_t> pattern(op.labels.size());
+      for (size_t k = 0; k < op.labels.size(); ++k) {
+        pattern[k] = order.find(op.labels[k]);
+      }
+      ndarray<T> dense = permute_view(op.array, pattern).contiguous();
+      if (order.size() == keep.size()) {
+        return einsum_operand<T>{dense, keep};
+      }
+      shape_t shape(dense.shape().begin(), dense.shape().begin() + keep.size());
+      size_t columns = 1;
+      for (size_t k = keep.size(); k < order.size(); ++k) {
+        columns *= dense.shape()[k];
+      }
+      ndarray<T> result(uninitialized, shape);
+      const T *src = dense.data().get() + dense.offset();
+      T *dst = result.data().get();
+      parallel_for(result.size(), sizeof(T) * (columns + 1), [src, dst, columns](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          T sum(0);
+          for (size_t j = 0; j < columns; ++j) {
+            sum += src[i * columns + j];
+          }
+          dst[i] = sum;
+        }
+      });
+      return einsum_operand<T>{result, keep};
+    }
+
+    /**
+     * Contract two operands over their common indices that are not in `keep`. Common indices that are kept are
+     * batch indices. The contraction is brought to a batch of GEMMs `(batch, left, contracted) x
+     * (batch, contracted, right) -> (batch, left, right)` with transposes of the operands.
+     *
+     * @param a, b - operands
+     * @param keep - indices needed by the result or by remaining operands
+     */
+    template<typename T>
+    einsum_operand<T> einsum_contract(einsum_operand<T> a, einsum_operand<T> b, const std::string &keep) {
+      // indices that are only in one operand and not needed later are summed before the contraction
+      std::string keep_a, keep_b;
+      for (char c : a.labels) {
+        if (has_label(b.labels, c) || has_label(keep, c)) {
+          keep_a += c;
+        }
+      }
+      for (char c : b.labels) {
+        if (has_label(a.labels, c) || has_label(keep, c)) {
+          keep_b += c;
+        }
+      }
+      if (keep_a.size() != a.labels.size()) {
+        a = einsum_reduce(a, keep_a);
+      }
+      if (keep_b.size() != b.labels.size()) {
+        b = einsum_reduce(b, keep_b);
+      }
+      std::string batch, contracted, left, right;
+      for (char c : a.labels) {
+        if (!has_label(b.labels, c)) {
+          left += c;
+        } else if (has_label(keep, c)) {
+          batch += c;
+        } else {
+          contracted += c;
+        }
+      }
+      for (char c : b.labels) {
+        if (!has_label(a.labels, c)) {
+          right += c;
+        }
+      }
+      ndarray<T> lhs = einsum_reduce(a, batch + left + contracted).array;
+      ndarray<T> rhs = einsum_reduce(b, batch + contracted + right).array;
+      size_t nb = 1, m = 1, k = 1, n = 1;
+      shape_t shape;
+      for (char c : batch) {
+        nb *= a.extent(c);
+        shape.push_back(a.extent(c));
+      }
+      for (char c : left) {
+        m *= a.extent(c);
+        shape.push_back(a.extent(c));
+      }
+      for (char c : contracted) {
+        k *= a.extent(c);
+      }
+      for (char c : right) {
+        n *= b.extent(c);
+        shape.push_back(b.extent(c));
+      }
+      ndarray<T> result(uninitialized, shape);
+      const T *lp = lhs.data().get() + lhs.offset();
+      const T *rp = rhs.data().get() + rhs.offset();
+      T *out = result.data().get();
+      // batches are split between threads as in matmul, gemm of a batch then runs on its thread
+      parallel_for(nb, sizeof(T) * m * n * std::max(k, size_t(1)), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          gemm(m, n, k, lp + i * m * k, k, rp + i * k * n, n, out + i * m * n, n);
+        }
+      });
+      return einsum_operand<T>{result, batch + left + right};
+    }
+
+    /**
+     * Size of the result of the contraction of operands `i` and `j`, used to choose the contraction order
+     *
+     * @param labels - indices of the remaining operands
+     * @param output - indices of the result
+     * @param extents - extent of every index
+     */
+    inline size_t einsum_cost(const std::vector<std::string> &labels, size_t i, size_t j, const std::string &output,
+                              const std::map<char, size_t> &extents) {
+      size_t cost = 1;
+      std::string seen;
+      for (size_t q : {i, j}) {
+        for (char c : labels[q]) {
+          if (has_label(seen, c)) {
+            continue;
+          }
+          seen += c;
+          bool needed = has_label(output, c);
+          for (size_t r = 0; r < labels.size() && !needed; ++r) {
+            needed = r != i && r != j && has_label(labels[r], c);
+          }
+          if (needed) {
+            cost *= extents.at(c);
+          }
+        }
+      }
+      return cost;
+    }
+
+    /**
+     * Indices of the result of `einsum_contract` for operands with indices `a` and `b`: batch, left, then right
+     */
+    inline std::string einsum_contract_labels(const std::string &a, const std::string &b, const std::string &keep) {
+      std::string batch, left, right;
+      for (char c : a) {
+        if (has_label(keep, c)) {
+          (has_label(b, c) ? batch : left) += c;
+        }
+      }
+      for (char c : b) {
+        if (!has_label(a, c) && has_label(keep, c)) {
+          right += c;
+        }
+      }
+      return batch + left + right;
+    }
+
+    /**
+     * Pairwise contraction of a plan: operands `first` and `second` of the current list are replaced by their
+     * contraction, appended to the end of the list
+     */
+    struct einsum_step {
+      size_t first;
+      size_t second;
+      // indices needed by the result or by the remaining operands
+      std::string keep;
+    };
+
+  }
+
+  /**
+   * Precompiled einsum for operands of fixed shapes. The pattern is parsed and validated against the shapes once,
+   * and the order of pairwise contractions is chosen greedily, contracting the pair with the smallest intermediate
+   * result first. The plan can be executed for any operands of the same shapes.
+   */
+  class einsum_plan {
+  public:
+    /**
+     * @param pattern - einsum pattern, e.g. "ijkl,lm->ijkm"
+     * @param shapes - shapes of the operands
+     */
+    einsum_plan(const std::string &pattern, const std::vector<shape_t> &shapes) :
+        pattern_(detail::parse_einsum_pattern(pattern, shapes.size())), shapes_(shapes) {
+      std::map<char, size_t> extents;
+      std::vector<std::string> labels;
+      for (size_t q = 0; q < shapes.size(); ++q) {
+        const std::string &input = pattern_.inputs[q];
+        if (input.size() != shapes[q].size()) {
+          throw std::runtime_error("Number of einsum indices and array dimension are different.");
+        }
+        std::string unique;
+        for (size_t k = 0; k < input.size(); ++k) {
+          size_t pos = input.find(input[k]);
+          if (pos != k) {
+            if (shapes[q][pos] != shapes[q][k]) {
+              throw std::runtime_error("Repeated einsum index has different extents.");
+            }
+            continue;
+          }
+          unique += input[k];
+          auto it = extents.insert(std::make_pair(input[k], shapes[q][k])).first;
+          if (it->second != shapes[q][k]) {
+            throw std::runtime_error("Einsum index has different extents in different operands.");
+          }
+        }
+        labels.push_back(unique);
+      }
+      while (labels.size() > 1) {
+        size_t bi = 0, bj = 1;
+        size_t best = detail::einsum_cost(labels, bi, bj, pattern_.output, extents);
+        for (size_t i = 0; i < labels.size(); ++i) {
+          for (size_t j = i + 1; j < labels.size(); ++j) {
+            size_t cost = detail::einsum_cost(labels, i, j, pattern_.output, extents);
+            if (cost < best) {
+              best = cost;
+              bi = i;
+              bj = j;
+            }
+          }
+        }
+        detail::einsum_step step{bi, bj, pattern_.output};
+        for (size_t r = 0; r < labels.size(); ++r) {
+          if (r != bi && r != bj) {
+            step.keep += labels[r];
+          }
+        }
+        std::string result = detail::einsum_contract_labels(labels[bi], labels[bj], step.keep);
+        labels.erase(labels.begin() + bj);
+        labels.erase(labels.begin() + bi);
+        labels.push_back(result);
+        steps_.push_back(step);
+      }
+    }
+
+    /**
+     * Evaluate einsum for `operands` of the shapes the plan was built for.
+     *
+     * @return newly allocated dense array
+     */
+    template<typename T>
+    ndarray<T> execute(const std::vector<ndarray<T> > &operands) const {
+      if (operands.size() != shapes_.size()) {
+        throw std::runtime_error("Number of einsum terms and number of operands are different.");
+      }
+      std::vector<detail::einsum_operand<T> > ops;
+      for (size_t q = 0; q < operands.size(); ++q) {
+        if (operands[q].shape() != shapes_[q]) {
+          throw std::runtime_error("Array shapes do not match einsum plan.");
+        }
+        ops.push_back(detail::einsum_diagonal(operands[q], pattern_.inputs[q]));
+      }
+      for (const detail::einsum_step &step : steps_) {
+        detail::einsum_operand<T> result = detail::einsum_contract(ops[step.first], ops[step.second], step.keep);
+        ops.erase(ops.begin() + step.second);
+        ops.erase(ops.begin() + step.first);
+        ops.push_back(result);
+      }
+      ndarray<T> result = detail::einsum_reduce(ops[0], pattern_.output).array;
+      if (operands.size() == 1 && result.data() == operands[0].data()) {
+        return result.copy();
+      }
+      return result;
+    }
+
+  private:
+    detail::einsum_pattern pattern_;
+    std::vector<shape_t> shapes_;
+    std::vector<detail::einsum_step> steps_;
+  };
+
+  namespace detail {
+
+    inline plan_cache<einsum_plan> &einsum_plans() {
+      static plan_cache<einsum_plan> cache;
+      return cache;
+    }
+
+  }
+
+  /**
+   * Einsum plan for `pattern` and operands of `shapes` from a global thread-safe cache. The plan is built on
+   * the first request and reused afterwards. In hot loops hold on to the plan and call `execute` directly.
+   *
+   * @param pattern - einsum pattern
+   * @param shapes - shapes of the operands
+   * @return shared plan
+   */
+  inline std::shared_ptr<const einsum_plan> get_einsum_plan(const std::string &pattern,
+                                                            const std::vector<shape_t> &shapes) {
+    detail::plan_layout layout;
+    for (const shape_t &shape : shapes) {
+      layout.push_back(shape.size());
+      layout.insert(layout.end(), shape.begin(), shape.end());
+    }
+    return detail::einsum_plans().get(pattern, layout, [&]() { return einsum_plan(pattern, shapes); });
+  }
+
+  /**
+   * Einstein summation, e.g. `einsum("ijkl,lm->ijkm", a, b)`. Indices repeated between operands and absent in the
+   * result are summed over, repeated indices within one operand select a diagonal. Without "->" the result has
+   * the indices that appear only once, in alphabetical order. Operands are contracted pairwise, each pairwise
+   * contraction is done by a matrix multiplication of transposed operands. Plans are cached per pattern and shapes,
+   * see `get_einsum_plan`.
+   *
+   * @param pattern - einsum pattern
+   * @param first, rest - operands
+   * @return newly allocated dense array
+   */
+  template<typename T, typename...Ts>
+  ndarray<typename detail::einsum_result<T, Ts...>::type>
+  einsum(const std::string &pattern, const ndarray<T> &first, const ndarray<Ts> &...rest) {
+    using R = typename detail::einsum_result<T, Ts...>::type;
+    std::vector<ndarray<R> > operands{detail::cast_array<R>(first), detail::cast_array<R>(rest)...};
+    std::vector<shape_t> shapes;
+    for (const ndarray<R> &operand : operands) {
+      shapes.push_back(operand.shape());
+    }
+    return get_einsum_plan(pattern, shapes)->execute(operands);
+  }
+
+  /**
+   * Einstein summation with non-owning views among the operands
+   */
+  template<typename A, typename...As,
+      typename = typename std::enable_if<detail::view_arguments<A, As...>::value>::type>
+  auto einsum(const std::string &pattern, const A &first, const As &...rest)
+  -> decltype(einsum(pattern, detail::view_to_array(first), detail::view_to_array(rest)...)) {
+    return einsum(pattern, detail::view_to_array(first), detail::view_to_array(rest)...);
+  }
+
+}
+
+#endif //NDARRAY_EINSUM_H
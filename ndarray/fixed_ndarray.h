@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_FIXED_NDARRAY_H
+#define NDARRAY_FIXED_NDARRAY_H
+
+#include <ndarray/ndarray.h>
+
+namespace ndarray {
+
+  /**
+   * Array with rank `N` known at compile time. Shape and strides are stored inline in `std::array`, element
+   * access and slicing do not allocate and index computation is unrolled. Shares data with `ndarray<T>`
+   * and converts to and from it.
+   *
+   * @tparam T - type of an element
+   * @tparam N - rank of an array
+   */
+  template<typename T, size_t N>
+  struct fixed_ndarray {
+    static_assert(is_scalar<T>::value, "");
+
+    /**
+     * Default constructor
+     */
+    fixed_ndarray() : shape_(), strides_(), size_(0), offset_(0) {}
+
+    /**
+     * Constructor for initialization from dimensions (allocates memory for attribute data_).
+     *
+     * @param[in] d1 is first dimension.
+     * @param[in] inds are after first dimensions.
+     */
+    template<typename...Indices, typename = typename std::enable_if<sizeof...(Indices) + 1 == N>::type>
+    explicit fixed_ndarray(size_t d1, Indices...inds) : fixed_ndarray(std::array<size_t, N>{{d1, size_t(inds)...}}) {}
+
+    /**
+     * Constructor for initialization from array of dimensions (allocates memory for attribute data_).
+     *
+     * @param[in] shape is a shape of an array.
+     */
+    explicit fixed_ndarray(const std::array<size_t, N> &shape) : fixed_ndarray(uninitialized, shape) {
+      set_value(0.0);
+    }
+
+    /**
+     * Constructor for allocation of memory for attribute data_ without zero initialization.
+     *
+     * @param[in] shape is a shape of an array.
+     */
+    fixed_ndarray(uninitialized_t, const std::array<size_t, N> &shape) :
+        shape_(shape), strides_(strides_for_shape(shape)), size_(size_for_shape(shape)), offset_(0),
+        data_(detail::allocate_storage<typename std::remove_const<T>::type>(size_)) {}
+
+    /**
+     * Constructor from a dynamic-rank array. Shares data with `rhs`.
+     *
+     * @param[in] rhs is an array of dimension `N`.
+     */
+    template<typename T2=typename std::remove_const<T>::type>
+    explicit fixed_ndarray(const ndarray<T2> &rhs) : size_(rhs.size()), offset_(rhs.offset()), data_(rhs.data()) {
+      if (rhs.dim() != N) {
+        throw std::runtime_error("Array's dimension (" + std::to_string(rhs.dim()) +
+                                 ") is not equal to the static rank (" + std::to_string(N) + ")");
+      }
+      std::copy(rhs.shape().begin(), rhs.shape().end(), shape_.begin());
+      std::copy(rhs.strides().begin(), rhs.strides().end(), strides_.begin());
+    }
+
+    template<typename T2=typename std::remove_const<T>::type>
+    fixed_ndarray(const fixed_ndarray<T2, N> &rhs) : shape_(rhs.shape()), strides_(rhs.strides()), size_(rhs.size()),
+                                                     offset_(rhs.offset()), data_(rhs.data()) {}
+
+    /**
+     * Conversion into dynamic-rank array that shares data with current one
+     */
+    operator ndarray<T>() const {
+      return ndarray<T>(data_, shape_, strides_, offset_);
+    }
+
+    /**
+     * Deep copy of array
+     *
+     * @return new array that is a full copy of current array
+     */
+    fixed_ndarray<typename std::remove_const<T>::type, N> copy() const {
+      fixed_ndarray<typename std::remove_const<T>::type, N> ret(uninitialized, shape_);
+      detail::transpose_copy(shape_, strides_, data_.get() + offset_, ret.data().get());
+      return ret;
+    }
+
+    /**
+     * Access element at given coordinates
+     *
+     * @param inds - coordinates of an element, exactly `N` indices
+     * @return reference to the element
+     */
+    template<typename...Indices>
+    typename std::enable_if<sizeof...(Indices) == N, T &>::type operator()(Indices...inds) {
+      return data_.get()[offset_ + index(inds...)];
+    }
+
+    template<typename...Indices>
+    typename std::enable_if<sizeof...(Indices) == N, const T &>::type operator()(Indices...inds) const {
+      return data_.get()[offset_ + index(inds...)];
+    }
+
+    /**
+     * Extract a sub-array at given leading coordinates
+     *
+     * @param inds - leading coordinates, less than `N` indices
+     * @return sub-array of rank `N - sizeof...(inds)` that shares data with current array
+     */
+    template<typename...Indices>
+    typename std::enable_if<(sizeof...(Indices) < N), fixed_ndarray<T, N - sizeof...(Indices)> >::type
+    operator()(Indices...inds) {
+      return sub_array<T, sizeof...(Indices)>(offset_ + index(inds...));
+    }
+
+    template<typename...Indices>
+    typename std::enable_if<(sizeof...(Indices) < N),
+        fixed_ndarray<const typename std::remove_const<T>::type, N - sizeof...(Indices)> >::type
+    operator()(Indices...inds) const {
+      return sub_array<const typename std::remove_const<T>::type, sizeof...(Indices)>(offset_ + index(inds...));
+    }
+
+    template<typename...Indices>
+    T &at(Indices...inds) {
+      static_assert(sizeof...(Indices) == N, "Number of indices is not equal to array's dimension");
+      return data_.get()[offset_ + index(inds...)];
+    }
+
+    template<typename...Indices>
+    const T &at(Indices...inds) const {
+      static_assert(sizeof...(Indices) == N, "Number of indices is not equal to array's dimension");
+      return data_.get()[offset_ + index(inds...)];
+    }
+
+    /**
+     * Set all elements of an array to be `value`
+     */
+    template<typename T2>
+    typename std::enable_if<is_scalar<T2>::value && std::is_convertible<T2, T>::value>::type set_value(T2 value) {
+      T v(value);
+      detail::parallel_strided_for_each(shape_, data_.get() + offset_, strides_, [v](T &x) { x = v; });
+    }
+
+    bool is_contiguous() const {
+      size_t stride = 1;
+      for (size_t k = N; k > 0; --k) {
+        if (shape_[k - 1] != 1 && strides_[k - 1] != stride) {
+          return false;
+        }
+        stride *= shape_[k - 1];
+      }
+      return true;
+    }
+
+    const T *begin() const {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
+      return data_.get() + offset_;
+    }
+
+    T *begin() {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
+      return data_.get() + offset_;
+    }
+
+    const T *end() const {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
+      return data_.get() + offset_ + size_;
+    }
+
+    T *end() {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
+      return data_.get() + offset_ + size_;
+    }
+
+    const std::shared_ptr<T> &data() const {
+      return data_;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    size_t offset() const {
+      return offset_;
+    }
+
+    const std::array<size_t, N> &shape() const {
+      return shape_;
+    }
+
+    const std::array<size_t, N> &strides() const {
+      return strides_;
+    }
+
+    static constexpr size_t dim() {
+      return N;
+    }
+
+  private:
+    template<typename, size_t>
+    friend struct fixed_ndarray;
+
+    fixed_ndarray(const std::shared_ptr<T> &data, const std::array<size_t, N> &shape,
+                  const std::array<size_t, N> &strides, size_t offset) :
+        shape_(shape), strides_(strides), size_(size_for_shape(shape)), offset_(offset), data_(data) {}
+
+    template<typename T2, size_t K>
+    fixed_ndarray<T2, N - K> sub_array(size_t offset) const {
+      std::array<size_t, N - K> shape;
+      std::array<size_t, N - K> strides;
+      std::copy(shape_.begin() + K, shape_.end(), shape.begin());
+      std::copy(strides_.begin() + K, strides_.end(), strides.begin());
+      return fixed_ndarray<T2, N - K>(std::shared_ptr<T2>(data_), shape, strides, offset);
+    }
+
+    void check_contiguous() const {
+      if (!is_contiguous()) {
+        throw std::runtime_error("Linear iteration over non-contiguous array.");
+      }
+    }
+
+    template<typename...Indices>
+    size_t index(Indices...inds) const {
+#if NDARRAY_CHECKED_ACCESS
+      detail::check_index_bounds<0>(shape_, inds...);
+#endif
+      return detail::index_offset<0>(strides_, inds...);
+    }
+
+    static size_t size_for_shape(const std::array<size_t, N> &shape) {
+      return std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    static std::array<size_t, N> strides_for_shape(const std::array<size_t, N> &shape) {
+      std::array<size_t, N> str;
+      size_t stride = 1;
+      for (size_t k = N; k > 0; --k) {
+        str[k - 1] = stride;
+        stride *= shape[k - 1];
+      }
+      return str;
+    }
+
+    std::array<size_t, N> shape_;
+    std::array<size_t, N> strides_;
+    size_t size_;
+    size_t offset_;
+    std::shared_ptr<T> data_;
+  };
+
+}
+
+#endif //NDARRAY_FIXED_NDARRAY_H
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_GEMM_H
+#define NDARRAY_GEMM_H
+
+#include <algorithm>
+#include <climits>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include <ndarray/parallel.h>
+
+#ifdef NDARRAY_HAVE_CBLAS
+#include <cblas.h>
+#endif
+
+namespace ndarray {
+
+  namespace detail {
+
+    /**
+     * `c += a * b` for real numbers
+     */
+    template<typename T>
+    inline void multiply_add(T &c, T a, T b) {
+      c += a * b;
+    }
+
+    /**
+     * `c += a * b` for complex numbers, without the inf/nan recovery of `std::complex` multiplication
+     * that prevents vectorization
+     */
+    template<typename T>
+    inline void multiply_add(std::complex<T> &c, const std::complex<T> &a, const std::complex<T> &b) {
+      c = std::complex<T>(c.real() + (a.real() * b.real() - a.imag() * b.imag()),
+                          c.imag() + (a.real() * b.imag() + a.imag() * b.real()));
+    }
+
+    /**
+     * Number of columns of `b` in a block of the loop kernel. Together with `gemm_block_k` rows a block of `b`
+     * takes 128 KiB and stays in L2 cache while it is applied to all rows of `a`.
+     */
+    template<typename T>
+    constexpr size_t gemm_block_n() {
+      return 2048 / sizeof(T);
+    }
+
+    constexpr size_t gemm_block_k = 64;
+
+    /**
+     * Size of the block of `c` kept in registers by the micro-kernel: 4 rows of 32 bytes, or of one element
+     * for complex numbers
+     */
+    constexpr size_t gemm_micro_rows = 4;
+
+    template<typename T>
+    constexpr size_t gemm_micro_cols() {
+      return sizeof(T) >= 16 ? 1 : 32 / sizeof(T);
+    }
+
+    /**
+     * Accumulate `gemm_micro_rows x gemm_micro_cols` block of `c` starting at row `i` over `p` in `[pb, pe)`.
+     * The block is summed in local accumulators, so that every loaded row of `b` is used for several rows of `c`.
+     */
+    template<typename T>
+    inline void gemm_micro(bool trans_a, size_t i, size_t pb, size_t pe, const T *a, size_t lda,
+                           const T *b, size_t ldb, T *c, size_t ldc) {
+      const size_t cols = gemm_micro_cols<T>();
+      T acc[gemm_micro_rows][gemm_micro_cols<T>()];
+      for (size_t r = 0; r < gemm_micro_rows; ++r) {
+        for (size_t j = 0; j < cols; ++j) {
+          acc[r][j] = c[r * ldc + j];
+        }
+      }
+      for (size_t p = pb; p < pe; ++p) {
+        const T *bp = b + (p - pb) * ldb;
+        for (size_t r = 0; r < gemm_micro_rows; ++r) {
+          const T arp = trans_a ? a[p * lda + i + r] : a[(i + r) * lda + p];
+          for (size_t j = 0; j < cols; ++j) {
+            multiply_add(acc[r][j], arp, bp[j]);
+          }
+        }
+      }
+      for (size_t r = 0; r < gemm_micro_rows; ++r) {
+        for (size_t j = 0; j < cols; ++j) {
+          c[r * ldc + j] = acc[r][j];
+        }
+      }
+    }
+
+    /**
+     * Columns `[j0, j1)` of row `i` of `c` over `p` in `[pb, pe)`, for the edges not covered by the micro-kernel
+     */
+    template<typename T>
+    inline void gemm_row_tail(bool trans_a, size_t i, size_t pb, size_t pe, size_t j0, size_t j1, const T *a,
+                              size_t lda, const T *b, size_t ldb, T *ci) {
+      for (size_t p = pb; p < pe; ++p) {
+        const T aip = trans_a ? a[p * lda + i] : a[i * lda + p];
+        const T *bp = b + (p - pb) * ldb;
+        for (size_t j = j0; j < j1; ++j) {
+          multiply_add(ci[j], aip, bp[j]);
+        }
+      }
+    }
+
+    /**
+     * Rows `[row_begin, row_end)` of `c = op(a) * op(b)` with the loop kernel. Blocks of `op(b)` are packed into
+     * a dense buffer, so the innermost loop runs over contiguous rows of the packed block and of `c`.
+     */
+    template<typename T>
+    void gemm_rows(bool trans_a, bool trans_b, size_t row_begin, size_t row_end, size_t n, size_t k,
+                   const T *a, size_t lda, const T *b, size_t ldb, T *c, size_t ldc) {
+      for (size_t i = row_begin; i < row_end; ++i) {
+        std::fill(c + i * ldc, c + i * ldc + n, T(0));
+      }
+      const size_t block_n = gemm_block_n<T>();
+      std::vector<T> panel(trans_b ? gemm_block_k * std::min(n, block_n) : 0);
+      for (size_t pb = 0; pb < k; pb += gemm_block_k) {
+        size_t pe = std::min(k, pb + gemm_block_k);
+        for (size_t jb = 0; jb < n; jb += block_n) {
+          size_t je = std::min(n, jb + block_n);
+          const T *block = b + pb * ldb + jb;
+          size_t ld = ldb;
+          if (trans_b) {
+            for (size_t p = pb; p < pe; ++p) {
+              for (size_t j = jb; j < je; ++j) {
+                panel[(p - pb) * (je - jb) + (j - jb)] = b[j * ldb + p];
+              }
+            }
+            block = panel.data();
+            ld = je - jb;
+          }
+          size_t i = row_begin;
+          for (; i + gemm_micro_rows <= row_end; i += gemm_micro_rows) {
+            size_t j = 0;
+            for (; j + gemm_micro_cols<T>() <= je - jb; j += gemm_micro_cols<T>()) {
+              gemm_micro(trans_a, i, pb, pe, a, lda, block + j, ld, c + i * ldc + jb + j, ldc);
+            }
+            for (size_t r = i; r < i + gemm_micro_rows; ++r) {
+              gemm_row_tail(trans_a, r, pb, pe, j, je - jb, a, lda, block, ld, c + r * ldc + jb);
+            }
+          }
+          for (; i < row_end; ++i) {
+            gemm_row_tail(trans_a, i, pb, pe, 0, je - jb, a, lda, block, ld, c + i * ldc + jb);
+          }
+        }
+      }
+    }
+
+    /**
+     * Matrix product with BLAS. The generic version is used for types not supported by BLAS
+     * or when no BLAS was found at configuration time.
+     *
+     * @return false if the product was not computed
+     */
+    template<typename T>
+    bool blas_gemm(bool, bool, size_t, size_t, size_t, const T *, size_t, const T *, size_t, T *, size_t) {
+      return false;
+    }
+
+#ifdef NDARRAY_HAVE_CBLAS
+
+    inline bool blas_sizes(size_t m, size_t n, size_t k, size_t lda, size_t ldb, size_t ldc) {
+      const size_t limit = size_t(INT_MAX);
+      return m <= limit && n <= limit && k <= limit && lda <= limit && ldb <= limit && ldc <= limit;
+    }
+
+    inline CBLAS_TRANSPOSE blas_trans(bool trans) {
+      return trans ? CblasTrans : CblasNoTrans;
+    }
+
+    inline bool blas_gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const float *a, size_t lda,
+                          const float *b, size_t ldb, float *c, size_t ldc) {
+      if (!blas_sizes(m, n, k, lda, ldb, ldc)) {
+        return false;
+      }
+      cblas_sgemm(CblasRowMajor, blas_trans(trans_a), blas_trans(trans_b), int(m), int(n), int(k), 1.0f, a, int(lda),
+                  b, int(ldb), 0.0f, c, int(ldc));
+      return true;
+    }
+
+    inline bool blas_gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const double *a, size_t lda,
+                          const double *b, size_t ldb, double *c, size_t ldc) {
+      if (!blas_sizes(m, n, k, lda, ldb, ldc)) {
+        return false;
+      }
+      cblas_dgemm(CblasRowMajor, blas_trans(trans_a), blas_trans(trans_b), int(m), int(n), int(k), 1.0, a, int(lda),
+                  b, int(ldb), 0.0, c, int(ldc));
+      return true;
+    }
+
+    inline bool blas_gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const std::complex<float> *a,
+                          size_t lda, const std::complex<float> *b, size_t ldb, std::complex<float> *c, size_t ldc) {
+      if (!blas_sizes(m, n, k, lda, ldb, ldc)) {
+        return false;
+      }
+      const std::complex<float> one(1), zero(0);
+      cblas_cgemm(CblasRowMajor, blas_trans(trans_a), blas_trans(trans_b), int(m), int(n), int(k), &one, a, int(lda),
+                  b, int(ldb), &zero, c, int(ldc));
+      return true;
+    }
+
+    inline bool blas_gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const std::complex<double> *a,
+                          size_t lda, const std::complex<double> *b, size_t ldb, std::complex<double> *c, size_t ldc) {
+      if (!blas_sizes(m, n, k, lda, ldb, ldc)) {
+        return false;
+      }
+      const std::complex<double> one(1), zero(0);
+      cblas_zgemm(CblasRowMajor, blas_trans(trans_a), blas_trans(trans_b), int(m), int(n), int(k), &one, a, int(lda),
+                  b, int(ldb), &zero, c, int(ldc));
+      return true;
+    }
+
+#endif
+
+    /**
+     * Matrix product `c = op(a) * op(b)` of row-major matrices, where `op(x)` is `x` or its transpose.
+     * `op(a)` is m x k, `op(b)` is k x n and `c` is m x n. Uses BLAS when it was found at configuration time,
+     * otherwise the blocked loop kernel with rows of `c` split between threads.
+     *
+     * @param trans_a, trans_b - whether `a` (stored as k x m) and `b` (stored as n x k) are transposed
+     * @param lda, ldb, ldc - distance in elements between stored rows of `a`, `b` and `c`
+     */
+    template<typename T>
+    void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const T *a, size_t lda,
+              const T *b, size_t ldb, T *c, size_t ldc) {
+      if (m == 0 || n == 0) {
+        return;
+      }
+      if (k > 0 && blas_gemm(trans_a, trans_b, m, n, k, a, lda, b, ldb, c, ldc)) {
+        return;
+      }
+      // threads are split by the amount of arithmetic per row rather than by the size of the row
+      parallel_for(m, sizeof(T) * n * std::max(k, size_t(1)), [&](size_t begin, size_t end) {
+        gemm_rows(trans_a, trans_b, begin, end, n, k, a, lda, b, ldb, c, ldc);
+      });
+    }
+
+    /**
+     * Matrix product `c = a * b` of dense row-major matrices
+     */
+    template<typename T>
+    void gemm(size_t m, size_t n, size_t k, const T *a, size_t lda, const T *b, size_t ldb, T *c, size_t ldc) {
+      gemm(false, false, m, n, k, a, lda, b, ldb, c, ldc);
+    }
+
+  }
+}
+
+#endif //NDARRAY_GEMM_H
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_MAPPED_NDARRAY_H
+#define NDARRAY_MAPPED_NDARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <ndarray/ndarray.h>
+#include <ndarray/ndarray_io.h>
+
+namespace ndarray {
+
+  /**
+   * Expected order of access to a file-backed array
+   */
+  enum class access_pattern {
+    normal,
+    // pages are read ahead aggressively and dropped soon after the access
+    sequential,
+    // no read-ahead
+    random
+  };
+
+  /**
+   * Array stored in a file in the native format (see `save`) and mapped into memory, for data larger than
+   * the physical memory. Elements are read from the file when they are first accessed and modifications are
+   * written back to it, pages are dropped from memory by the system when memory is needed.
+   *
+   * `array()` is an ordinary `ndarray<T>` referring to the mapping, so the whole existing API works on it and
+   * the mapping stays alive as long as any view refers to it. Operations on the whole array page through
+   * the file in the order of their memory access. To bound memory use explicitly, process the array in blocks
+   * of leading indices with `for_each_chunk`, which reads ahead the next block and drops the processed ones.
+   *
+   * @tparam T - type of the elements
+   */
+  template<typename T>
+  class mapped_ndarray {
+  public:
+    /**
+     * Create a file for an array of the given shape with all elements equal to zero. The file is allocated
+     * sparsely where the file system supports it, so creation does not depend on the size of the array.
+     *
+     * @param filename - path to the file, an existing file is overwritten
+     * @param shape - shape of the array
+     */
+    static mapped_ndarray create(const std::string &filename, const shape_t &shape) {
+      std::vector<char> head = detail::native_header_bytes<T>(shape);
+      size_t size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>()) * sizeof(T);
+      {
+        detail::file_handle file = detail::open_file(filename, "wb");
+        if (std::fwrite(head.data(), 1, head.size(), file.get()) != head.size() || std::fflush(file.get()) != 0) {
+          throw detail::io_error("Cannot write file", filename);
+        }
+      }
+#if NDARRAY_HAVE_MMAP
+      if (::truncate(filename.c_str(), off_t(head.size() + size)) != 0) {
+        throw detail::io_error("Cannot resize file", filename);
+      }
+#else
+      (void) size;
+      throw std::runtime_error("Shared file mappings are not supported on this platform.");
+#endif
+      return open(filename);
+    }
+
+    /**
+     * Open an array stored in the native format for reading and writing
+     *
+     * @param filename - path to the file
+     */
+    static mapped_ndarray open(const std::string &filename) {
+      std::shared_ptr<detail::file_mapping> mapping =
+          std::make_shared<detail::file_mapping>(filename, detail::mapping_mode::shared);
+      return mapped_ndarray(mapping, detail::native_array<T>(mapping, filename));
+    }
+
+    /**
+     * @return array referring to the whole mapped file
+     */
+    const ndarray<T> &array() const {
+      return array_;
+    }
+
+    const shape_t &shape() const {
+      return array_.shape();
+    }
+
+    size_t size() const {
+      return array_.size();
+    }
+
+    /**
+     * Slice over leading indices, e.g. `vertex(w)` for a single frequency of a vertex tensor. Reading of the
+     * sub-array from the file is started before it is returned.
+     */
+    template<typename...Indices>
+    ndarray<T> operator()(Indices...inds) const {
+      ndarray<T> view = ndarray<T>(array_)(inds...);
+      prefetch(view);
+      return view;
+    }
+
+    /**
+     * Set the expected order of access to the whole file
+     */
+    void advise(access_pattern pattern) const {
+      mapping_->advise(0, mapping_->size(), pattern == access_pattern::sequential ? detail::access_hint::sequential :
+                                            pattern == access_pattern::random ? detail::access_hint::random :
+                                            detail::access_hint::normal);
+    }
+
+    /**
+     * Start reading elements of a view of this array from the file
+     */
+    void prefetch(const ndarray<T> &view) const {
+      advise(view, detail::access_hint::will_need);
+    }
+
+    /**
+     * Drop elements of a view of this array from memory. Modified elements are kept by the file and
+     * the view remains valid, its elements are read again on the next access.
+     */
+    void evict(const ndarray<T> &view) const {
+      advise(view, detail::access_hint::dont_need);
+    }
+
+    /**
+     * Store all modifications to the file
+     */
+    void flush() const {
+      mapping_->sync();
+    }
+
+    /**
+     * Process the array in blocks of `rows` leading indices, `f(block, first)` is called for every block in order
+     * with the view of the block and its first leading index. The next block is read ahead while `f` runs,
+     * and every block is dropped from memory after it is processed, so at most two blocks are resident.
+     */
+    template<typename F>
+    void for_each_chunk(size_t rows, F f) const {
+      if (array_.dim() == 0) {
+        f(array_, size_t(0));
+        return;
+      }
+      size_t extent = array_.shape()[0];
+      rows = std::max(rows, size_t(1));
+      for (size_t first = 0; first < extent; first += rows) {
+        ndarray<T> block = chunk(first, std::min(extent, first + rows));
+        if (first + rows < extent) {
+          prefetch(chunk(first + rows, std::min(extent, first + 2 * rows)));
+        }
+        f(block, first);
+        evict(block);
+      }
+    }
+
+  private:
+    std::shared_ptr<detail::file_mapping> mapping_;
+    ndarray<T> array_;
+
+    mapped_ndarray(const std::shared_ptr<detail::file_mapping> &mapping, const ndarray<T> &array) :
+        mapping_(mapping), array_(array) {}
+
+    ndarray<T> chunk(size_t begin, size_t end) const {
+      return ndarray<T>(array_)(range(std::ptrdiff_t(begin), std::ptrdiff_t(end)));
+    }
+
+    /**
+     * Apply a hint to the bytes between the first and the last element of a view
+     */
+    void advise(const ndarray<T> &view, detail::access_hint hint) const {
+      if (view.size() == 0) {
+        return;
+      }
+      uintptr_t base = reinterpret_cast<uintptr_t>(mapping_->data());
+      uintptr_t first = reinterpret_cast<uintptr_t>(view.data().get() + view.offset());
+      std::ptrdiff_t low = 0, high = 0;
+      for (size_t k = 0; k < view.dim(); ++k) {
+        std::ptrdiff_t step = std::ptrdiff_t(view.strides()[k]) * std::ptrdiff_t(view.shape()[k] - 1);
+        (step < 0 ? low : high) += step;
+      }
+      uintptr_t begin = first + uintptr_t(low * std::ptrdiff_t(sizeof(T)));
+      uintptr_t end = first + uintptr_t((high + 1) * std::ptrdiff_t(sizeof(T)));
+      if (begin < base || end > base + mapping_->size()) {
+        throw std::runtime_error("View does not refer to the mapped array.");
+      }
+      mapping_->advise(size_t(begin - base), size_t(end - base), hint);
+    }
+  };
+
+}
+
+#endif //NDARRAY_MAPPED_NDARRAY_H
@@ -10,12 +10,31 @@
 #include <memory>
 #include <array>
 #include <complex>
+#include <cstddef>
+#include <limits>
 #include <numeric>
 #include <string>
 #include <vector>
 #include <map>
+#include <stdexcept>
+#include <type_traits>
 
+#include <ndarray/allocator.h>
+#include <ndarray/parallel.h>
+#include <ndarray/small_vector.h>
 #include <ndarray/string_utils.h>
+#include <ndarray/strided_loop.h>
+#include <ndarray/transpose_kernel.h>
+
+/**
+ * Bounds checking of scalar element access (`at()`, `ref()`). Always enabled in debug builds, optimized builds
+ * can keep it by defining NDARRAY_BOUNDS_CHECK. Checks throw `index_error` without formatting a message.
+ */
+#if !defined(NDEBUG) || defined(NDARRAY_BOUNDS_CHECK)
+#define NDARRAY_CHECKED_ACCESS 1
+#else
+#define NDARRAY_CHECKED_ACCESS 0
+#endif
 
 namespace ndarray {
 
@@ -26,8 +45,164 @@ namespace ndarray {
   struct is_complex<std::complex<T>> : std::true_type {
   };
   template<typename T>
+  struct is_complex<const T> : is_complex<T> {
+  };
+  template<typename T>
   using is_scalar = std::integral_constant<bool, std::is_arithmetic<T>::value || is_complex<T>::value>;
 
+  /**
+   * Tag type for constructors that allocate memory for ndarray without initializing it.
+   * Used when every element is going to be overwritten right after construction.
+   */
+  struct uninitialized_t {
+  };
+  constexpr uninitialized_t uninitialized = uninitialized_t();
+
+  /**
+   * Exception thrown by checked element access for an index that is out of bounds. Message is static,
+   * so throwing does not format strings, offending axis, index and extent are available as fields.
+   */
+  class index_error : public std::out_of_range {
+  public:
+    index_error(size_t axis, size_t index, size_t extent) : std::out_of_range("ndarray index is out of range"),
+                                                            axis_(axis), index_(index), extent_(extent) {}
+
+    size_t axis() const {
+      return axis_;
+    }
+
+    size_t index() const {
+      return index_;
+    }
+
+    size_t extent() const {
+      return extent_;
+    }
+
+  private:
+    size_t axis_;
+    size_t index_;
+    size_t extent_;
+  };
+
+  /**
+   * Placeholder for an omitted bound of a `range`
+   */
+  constexpr std::ptrdiff_t none = std::numeric_limits<std::ptrdiff_t>::min();
+
+  /**
+   * Range of indices along one axis used for slicing: from `start` to `stop` (exclusive) with `step`.
+   * Negative bounds are counted from the end of an axis, omitted bounds (`none`) cover the whole axis
+   * in the direction of `step`. Default constructed range selects the whole axis.
+   */
+  struct range {
+    range() : start(none), stop(none), step(1) {}
+
+    range(std::ptrdiff_t start_, std::ptrdiff_t stop_, std::ptrdiff_t step_ = 1) :
+        start(start_), stop(stop_), step(step_) {}
+
+    std::ptrdiff_t start;
+    std::ptrdiff_t stop;
+    std::ptrdiff_t step;
+  };
+
+  namespace detail {
+
+    /**
+     * Single argument of a general slice: either an index, that removes the axis, or a range.
+     */
+    struct slice_argument {
+      template<typename I, typename = typename std::enable_if<std::is_integral<I>::value>::type>
+      slice_argument(I i) : is_index(true), index(std::ptrdiff_t(i)) {}
+
+      slice_argument(const range &r) : is_index(false), index(0), rng(r) {}
+
+      bool is_index;
+      std::ptrdiff_t index;
+      range rng;
+    };
+
+    /**
+     * Linear offset of an element with indices `i, inds...` starting from axis K. Recursion is resolved at
+     * compile time, so the offset is computed as a plain chain of multiply-adds.
+     */
+    template<size_t K, typename Strides>
+    inline size_t index_offset(const Strides &) {
+      return 0;
+    }
+
+    template<size_t K, typename Strides, typename Index, typename...Indices>
+    inline size_t index_offset(const Strides &strides, Index i, Indices...inds) {
+      return size_t(i) * strides[K] + index_offset<K + 1>(strides, inds...);
+    }
+
+    template<size_t K, typename Shape>
+    inline void check_index_bounds(const Shape &) {}
+
+    template<size_t K, typename Shape, typename Index, typename...Indices>
+    inline void check_index_bounds(const Shape &shape, Index i, Indices...inds) {
+      if (size_t(i) >= shape[K]) {
+        throw index_error(K, size_t(i), shape[K]);
+      }
+      check_index_bounds<K + 1>(shape, inds...);
+    }
+
+    template<typename...Args>
+    struct any_range : std::false_type {
+    };
+
+    template<typename Arg, typename...Args>
+    struct any_range<Arg, Args...> : std::integral_constant<bool,
+        std::is_same<typename std::decay<Arg>::type, range>::value || any_range<Args...>::value> {
+    };
+
+  }
+
+  /**
+   * Base class for lazily evaluated elementwise expressions over ndarrays (see ndarray_math.h).
+   * Derived type `E` provides `value_type`, `shape()`, `contiguous()` and `operator[]` over row-major linear index
+   * for contiguous operands, `seek(index)`/`eval(j)` for the row-wise walk over strided operands, and `overlaps(out)`
+   * to detect leaves that alias the destination of an in-place operation.
+   *
+   * @tparam E - type of the derived expression
+   */
+  template<typename E>
+  struct ndarray_expression {
+    const E &self() const {
+      return static_cast<const E &>(*this);
+    }
+
+    /**
+     * Evaluate zero-dimension expression into a scalar
+     *
+     * @tparam Scalar type of LHS argument
+     * @return value of zero-dimension expression
+     */
+    template<typename Scalar, typename = typename std::enable_if<is_scalar<Scalar>::value>::type>
+    operator Scalar() const {
+#ifndef NDEBUG
+      if (!self().shape().empty()) {
+        throw std::runtime_error("Expression is not directly castable to a scalar. Expression's dimension is " +
+                                 std::to_string(self().shape().size()));
+      }
+#endif
+      return Scalar(self()[0]);
+    }
+
+    /**
+     * Write the result of a contiguous expression into dense buffer `out` with a specialized kernel.
+     * Expression nodes that have such kernels hide this default.
+     *
+     * @param out - destination for `size` elements
+     * @param size - number of elements
+     * @return false if the expression has to be evaluated elementwise, nothing is written then
+     */
+    template<typename T>
+    bool assign_dense(T *, size_t) const {
+      return false;
+    }
+  };
+
   template<typename T>
   struct ndarray {
     static_assert(is_scalar<T>::value, "");
@@ -35,7 +210,7 @@ namespace ndarray {
     /**
      * Default constructor
      */
-    ndarray() : shape_(0), strides_(0), size_(0), offset_(0) {}
+    ndarray() : shape_(), strides_(), size_(0), offset_(0) {}
 
     /**
      * Constructor for initialization from dimensions (allocates memory for attribute data_).
@@ -54,39 +229,90 @@ namespace ndarray {
      * @param[in] shape is array while D is its dimension.
      */
     template<size_t D>
-    explicit ndarray(const std::array<size_t, D> &shape) : shape_(shape.begin(), shape.end()),
-                                                  strides_(strides_for_shape(shape)),
-                                                  size_(size_for_shape(shape)), offset_(0),
-                                                  data_(new T[size_], std::default_delete<T[]>()) {
+    explicit ndarray(const std::array<size_t, D> &shape) : ndarray(uninitialized, shape) {
       set_value(0.0);
     }
 
-    explicit ndarray(const std::vector<size_t> &shape) : shape_(shape.begin(), shape.end()),
-                                                strides_(strides_for_shape(shape)),
-                                                size_(size_for_shape(shape)), offset_(0),
-                                                data_(new T[size_], std::default_delete<T[]>()) {
+    explicit ndarray(const shape_t &shape) : ndarray(uninitialized, shape) {
       set_value(0.0);
     }
 
     /**
-     * Constructor for initialization from array of dimensions (allocates memory for attribute data_).
+     * Constructors for allocation of memory for attribute data_ without zero initialization.
+     * Content of the array is unspecified until it is written.
      *
-     * @param[in] shape is array while D is its dimension.
+     * @param[in] shape is a shape of an array.
+     */
+    template<typename...Indices>
+    ndarray(uninitialized_t, size_t d1, Indices...inds) : ndarray(uninitialized,
+        std::array<size_t, sizeof...(inds) + 1>{{d1, size_t(inds)...}}) {}
+
+    template<size_t D>
+    ndarray(uninitialized_t, const std::array<size_t, D> &shape) : shape_(shape.begin(), shape.end()),
+                                                                  strides_(strides_for_shape(shape)),
+                                                                  size_(size_for_shape(shape)), offset_(0),
+                                                                  data_(allocate(size_)) {}
+
+    ndarray(uninitialized_t, const shape_t &shape) : shape_(shape.begin(), shape.end()),
+                                                                strides_(strides_for_shape(shape)),
+                                                                size_(size_for_shape(shape)), offset_(0),
+                                                                data_(allocate(size_)) {}
+
+    /**
+     * Constructors for wrapping of an existing buffer. Content of the buffer is left untouched and
+     * the buffer is not released by ndarray, caller is responsible to keep it alive.
+     *
+     * @param[in] data is a pointer to the first element of the buffer.
+     * @param[in] shape is a shape of the buffer.
      */
     template<size_t D>
-    explicit ndarray(T* data, const std::array<size_t, D> &shape) : shape_(shape.begin(), shape.end()),
-                                                           strides_(strides_for_shape(shape)),
-                                                           size_(size_for_shape(shape)), offset_(0),
-                                                           data_(data, [](T*){}) {
-      set_value(0.0);
-    }
+    explicit ndarray(T* data, const std::array<size_t, D> &shape) : ndarray(data, shape, [](T*){}) {}
 
-    explicit ndarray(T* data, const std::vector<size_t> &shape) : shape_(shape.begin(), shape.end()),
-                                                         strides_(strides_for_shape(shape)),
-                                                         size_(size_for_shape(shape)), offset_(0),
-                                                         data_(data, [](T*){}) {
-      set_value(0.0);
-    }
+    explicit ndarray(T* data, const shape_t &shape) : ndarray(data, shape, [](T*){}) {}
+
+    /**
+     * Constructors for adoption of an existing buffer. Content of the buffer is left untouched and
+     * `deleter` is called on `data` when the last ndarray referring to the buffer is destroyed.
+     *
+     * @tparam Deleter - type of a callable object taking `T*`
+     * @param[in] data is a pointer to the first element of the buffer.
+     * @param[in] shape is a shape of the buffer.
+     * @param[in] deleter releases the buffer.
+     */
+    template<size_t D, typename Deleter>
+    ndarray(T* data, const std::array<size_t, D> &shape, Deleter deleter) : shape_(shape.begin(), shape.end()),
+                                                                          strides_(strides_for_shape(shape)),
+                                                                          size_(size_for_shape(shape)), offset_(0),
+                                                                          data_(data, deleter) {}
+
+    template<typename Deleter>
+    ndarray(T* data, const shape_t &shape, Deleter deleter) : shape_(shape.begin(), shape.end()),
+                                                                        strides_(strides_for_shape(shape)),
+                                                                        size_(size_for_shape(shape)), offset_(0),
+                                                                        data_(data, deleter) {}
+
+    /**
+     * Constructors for wrapping of a buffer owned by another object. Content of the buffer is left untouched
+     * and `owner` is kept alive as long as any ndarray refers to the buffer.
+     *
+     * @tparam Owner - type of an ownership token
+     * @param[in] owner is an object that owns the buffer.
+     * @param[in] data is a pointer to the first element of the buffer.
+     * @param[in] shape is a shape of the buffer.
+     */
+    template<typename Owner, size_t D>
+    ndarray(const std::shared_ptr<Owner> &owner, T* data, const std::array<size_t, D> &shape) :
+        shape_(shape.begin(), shape.end()),
+        strides_(strides_for_shape(shape)),
+        size_(size_for_shape(shape)), offset_(0),
+        data_(owner, data) {}
+
+    template<typename Owner>
+    ndarray(const std::shared_ptr<Owner> &owner, T* data, const shape_t &shape) :
+        shape_(shape.begin(), shape.end()),
+        strides_(strides_for_shape(shape)),
+        size_(size_for_shape(shape)), offset_(0),
+        data_(owner, data) {}
 
     /**
      * Constructor for slicing of existing instance.
@@ -108,7 +334,7 @@ namespace ndarray {
     template<typename T2=typename std::remove_const<T>::type, size_t D>
     ndarray(const ndarray<T2> &ref, const std::array<size_t, D> &inds) :
         shape_(get_shape(ref.shape(), inds)),
-        strides_(strides_for_shape(shape_)),
+        strides_(ref.strides().begin() + D, ref.strides().end()),
         size_(size_for_shape(shape_)),
         offset_(ref.offset() + compute_offset(ref.strides(), inds)),
         data_(ref.data()) {}
@@ -127,6 +353,56 @@ namespace ndarray {
                                             offset_(rhs.offset()),
                                             data_(rhs.data()) {}
 
+    /**
+     * Constructor of a view on data of an existing instance with explicit layout.
+     *
+     * @param[in] ref is existing instance that owns the data.
+     * @param[in] shape is a shape of the view.
+     * @param[in] strides are strides of the view (negative strides are stored modulo 2^64).
+     * @param[in] offset is a position of the first element of the view in data of `ref`.
+     */
+    template<typename T2=typename std::remove_const<T>::type>
+    ndarray(const ndarray<T2> &ref, const shape_t &shape, const shape_t &strides,
+            size_t offset) : shape_(shape),
+                             strides_(strides),
+                             size_(size_for_shape(shape)),
+                             offset_(offset),
+                             data_(ref.data()) {}
+
+    /**
+     * Constructor of a view on shared data with explicit layout.
+     *
+     * @tparam Shape - container type for a shape (std::vector or std::array)
+     * @tparam Strides - container type for strides
+     * @param[in] data is a shared pointer to the data.
+     * @param[in] shape is a shape of the view.
+     * @param[in] strides are strides of the view.
+     * @param[in] offset is a position of the first element of the view in `data`.
+     */
+    template<typename T2, typename Shape, typename Strides>
+    ndarray(const std::shared_ptr<T2> &data, const Shape &shape, const Strides &strides, size_t offset) :
+        shape_(shape.begin(), shape.end()),
+        strides_(strides.begin(), strides.end()),
+        size_(size_for_shape(shape)),
+        offset_(offset),
+        data_(data) {}
+
+    /**
+     * Constructor for evaluation of an elementwise expression in a single pass (allocates memory for attribute data_).
+     *
+     * @tparam E - type of an expression
+     * @param expr - expression to be evaluated
+     */
+    template<typename E, typename = typename std::enable_if<
+        std::is_convertible<typename E::value_type, T>::value>::type>
+    ndarray(const ndarray_expression<E> &expr) : ndarray(uninitialized, expr.self().shape()) {
+      if (expr.self().assign_dense(data_.get(), size_)) {
+        return;
+      }
+      detail::evaluate_expression(data_.get(), strides_, true, expr.self(),
+                                  [](T &out, const typename E::value_type &value) { out = T(value); });
+    }
+
     /**
      * Conversion into scalar type
      *
@@ -186,29 +462,34 @@ namespace ndarray {
      * @return new array that is a full copy of current array
      */
     ndarray<typename std::remove_const<T>::type> copy() const {
-      ndarray<typename std::remove_const<T>::type> ret(shape_);
-      std::copy(begin(), end(), ret.begin());
+      ndarray<typename std::remove_const<T>::type> ret(uninitialized, shape_);
+      detail::transpose_copy(shape_, strides_, data_.get() + offset_, ret.data().get());
       return ret;
     }
 
+    /**
+     * Dense version of the array. Returns the array itself if it is already contiguous,
+     * otherwise materializes it with the blocked transpose kernel.
+     *
+     * @return contiguous array
+     */
+    ndarray<T> contiguous() const {
+      if (is_contiguous()) {
+        return *this;
+      }
+      return copy();
+    }
+
     virtual ~ndarray() {
     }
 
     template<typename...Indices>
     const T *ref(Indices...inds) const {
-#ifndef NDEBUG
-      size_t num_of_inds = sizeof...(Indices);
-      check_dimensions(num_of_inds);
-#endif
       return &data_.get()[offset_ + get_index(inds...)];
     }
 
     template<typename...Indices>
     T *ref(Indices...inds) {
-#ifndef NDEBUG
-      size_t num_of_inds = sizeof...(Indices);
-      check_dimensions(num_of_inds);
-#endif
       return &data_.get()[offset_ + get_index(inds...)];
     }
 
@@ -220,7 +501,7 @@ namespace ndarray {
      * @return sub-ndarray at `inds` coordinates
      */
     template<typename...Indices>
-    ndarray<T> operator()(Indices...inds) {
+    typename std::enable_if<!detail::any_range<Indices...>::value, ndarray<T> >::type operator()(Indices...inds) {
 #ifndef NDEBUG
       size_t num_of_inds = sizeof...(Indices);
       check_dimensions(shape_, num_of_inds);
@@ -229,6 +510,45 @@ namespace ndarray {
       return res;
     };
 
+    /**
+     * Extract a strided view for a mix of indices and ranges, e.g. `array(range(), 2, range(0, 10, 2))`.
+     *
+     * @tparam Indices types of indices and ranges
+     * @param inds - indices and ranges for leading dimensions
+     * @return view that shares data with current array
+     */
+    template<typename...Indices>
+    typename std::enable_if<detail::any_range<Indices...>::value, ndarray<T> >::type operator()(Indices...inds) {
+      return slice(inds...);
+    };
+
+    /**
+     * Extract a strided view. Integer arguments select a single element along an axis (negative indices are
+     * counted from the end) and remove that axis, `range` arguments keep the axis with new extent and stride.
+     * Dimensions that are not specified are kept as is.
+     *
+     * @tparam Args types of indices and ranges
+     * @param args - indices and ranges for leading dimensions
+     * @return view that shares data with current array
+     */
+    template<typename...Args>
+    ndarray<T> slice(const Args &...args) {
+      shape_t shape;
+      shape_t strides;
+      std::array<detail::slice_argument, sizeof...(Args)> spec{{detail::slice_argument(args)...}};
+      size_t offset = slice_layout(spec, shape, strides);
+      return ndarray<T>(*this, shape, strides, offset);
+    }
+
+    template<typename...Args>
+    ndarray<const typename std::remove_const<T>::type> slice(const Args &...args) const {
+      shape_t shape;
+      shape_t strides;
+      std::array<detail::slice_argument, sizeof...(Args)> spec{{detail::slice_argument(args)...}};
+      size_t offset = slice_layout(spec, shape, strides);
+      return ndarray<const typename std::remove_const<T>::type>(*this, shape, strides, offset);
+    }
+
     /**
      * Extract a scalar data at a given coordinates `inds`
      *
@@ -240,12 +560,9 @@ namespace ndarray {
      */
     template<typename...Indices>
     const T & at(Indices...inds) const {
-#ifndef NDEBUG
-      size_t num_of_inds = sizeof...(Indices);
-      if(num_of_inds != shape_.size()) {
-        throw std::runtime_error("Number of indices (" +
-                                 std::to_string(num_of_inds) + ") is not equal to array's dimension (" +
-                                 std::to_string(shape_.size()) + ")");
+#if NDARRAY_CHECKED_ACCESS
+      if (sizeof...(Indices) != shape_.size()) {
+        throw std::invalid_argument("Number of indices is not equal to array's dimension");
       }
 #endif
       return data_.get()[offset_ + get_index(inds...)];
@@ -262,12 +579,9 @@ namespace ndarray {
      */
     template<typename...Indices>
     T & at(Indices...inds) {
-#ifndef NDEBUG
-      size_t num_of_inds = sizeof...(Indices);
-      if(num_of_inds != shape_.size()) {
-        throw std::runtime_error("Number of indices (" +
-                                 std::to_string(num_of_inds) + ") is not equal to array's dimension (" +
-                                 std::to_string(shape_.size()) + ")");
+#if NDARRAY_CHECKED_ACCESS
+      if (sizeof...(Indices) != shape_.size()) {
+        throw std::invalid_argument("Number of indices is not equal to array's dimension");
       }
 #endif
       return data_.get()[offset_ + get_index(inds...)];
@@ -281,7 +595,8 @@ namespace ndarray {
      * @return const sub-ndarray at `inds` coordinates
      */
     template<typename...Indices>
-    ndarray<const typename std::remove_const<T>::type> operator()(Indices...inds) const {
+    typename std::enable_if<!detail::any_range<Indices...>::value, ndarray<const typename std::remove_const<T>::type> >::type
+    operator()(Indices...inds) const {
 #ifndef NDEBUG
       size_t num_of_inds = sizeof...(Indices);
       check_dimensions(shape_, num_of_inds);
@@ -290,6 +605,12 @@ namespace ndarray {
       return res;
     };
 
+    template<typename...Indices>
+    typename std::enable_if<detail::any_range<Indices...>::value, ndarray<const typename std::remove_const<T>::type> >::type
+    operator()(Indices...inds) const {
+      return slice(inds...);
+    };
+
     /**
      * Set all elements of an ndarray to be `value`
      *
@@ -298,14 +619,22 @@ namespace ndarray {
      */
     template<typename T2>
     typename std::enable_if<is_scalar<T2>::value && std::is_convertible<T2, T>::value>::type set_value(T2 value) {
-      std::fill(begin(), end(), T(value));
+      T v(value);
+      T *first = data_.get() + offset_;
+      if (is_contiguous()) {
+        detail::parallel_for(size_, sizeof(T), [first, v](size_t begin, size_t end) {
+          std::fill(first + begin, first + end, v);
+        });
+      } else {
+        detail::parallel_strided_for_each(shape_, first, strides_, [v](T &x) { x = v; });
+      }
     }
 
     void set_zero() {
       set_value(0);
     }
 
-    ndarray<T> reshape(const std::vector<size_t> &shape) const {
+    ndarray<T> reshape(const shape_t &shape) const {
 #ifndef NDEBUG
       if (size_for_shape(shape) != size_)
         throw std::logic_error("new shape is not consistent with old one");
@@ -314,8 +643,8 @@ namespace ndarray {
       return result.inplace_reshape(shape);
     }
 
-    ndarray<T> inplace_reshape(const std::vector<size_t> &shape) {
-      if(offset_ != 0) {
+    ndarray<T> inplace_reshape(const shape_t &shape) {
+      if(offset_ != 0 || !is_contiguous()) {
         throw std::logic_error("new shape is not consistent with old one");
       }
       shape_ = shape;
@@ -323,20 +652,48 @@ namespace ndarray {
       return *this;
     }
 
-    // Data accessors
+    /**
+     * Check whether elements of the array are stored densely in row-major order
+     *
+     * @return true if the array is contiguous
+     */
+    bool is_contiguous() const {
+      size_t stride = 1;
+      for (size_t k = shape_.size(); k > 0; --k) {
+        if (shape_[k - 1] != 1 && strides_[k - 1] != stride) {
+          return false;
+        }
+        stride *= shape_[k - 1];
+      }
+      return true;
+    }
+
+    // Data accessors. Linear iteration is only valid for contiguous arrays.
 
     const T* begin() const {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
       return data_.get() + offset_;
     }
 
     T* begin() {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
       return data_.get() + offset_;
     }
 
     const T* end() const {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
       return data_.get() + offset_ + size_;
     }
     T* end() {
+#ifndef NDEBUG
+      check_contiguous();
+#endif
       return data_.get() + offset_ + size_;
     }
 
@@ -357,11 +714,11 @@ namespace ndarray {
       return offset_;
     }
 
-    const std::vector<size_t> &shape() const {
+    const shape_t &shape() const {
       return shape_;
     }
 
-    const std::vector<size_t> &strides() const {
+    const shape_t &strides() const {
       return strides_;
     }
 
@@ -370,30 +727,24 @@ namespace ndarray {
     }
 
   private:
-    std::vector<size_t> shape_;
-    std::vector<size_t> strides_;
+    static std::shared_ptr<T> allocate(size_t size) {
+      return detail::allocate_storage<typename std::remove_const<T>::type>(size);
+    }
+
+    shape_t shape_;
+    shape_t strides_;
     size_t size_;
     size_t offset_;
     std::shared_ptr<T> data_;
 
     template<typename ...Indices>
     size_t get_index(Indices...inds) const {
-#ifndef NDEBUG
+#if NDARRAY_CHECKED_ACCESS
       if (sizeof...(Indices) > shape_.size())
-        throw std::logic_error("wrong dimensions");
+        throw std::invalid_argument("Number of indices is larger than array's dimension");
+      detail::check_index_bounds<0>(shape_, inds...);
 #endif
-
-      std::array<size_t, sizeof...(Indices)> ind_arr{{size_t(inds)...}};
-#ifndef NDEBUG
-      for (size_t i = 0; i < ind_arr.size(); ++i) {
-        if (ind_arr[i] >= shape_[i])
-          throw std::logic_error(std::to_string(i) + "-th index is larger than its dimension.");
-      }
-#endif
-      std::transform(ind_arr.begin(), ind_arr.end(), strides_.begin(), ind_arr.begin(),
-                     std::multiplies<size_t>());
-      size_t ind = std::accumulate(ind_arr.begin(), ind_arr.end(), size_t(0), std::plus<size_t>());
-      return ind;
+      return detail::index_offset<0>(strides_, inds...);
     }
 
     template<typename Container, typename Container2>
@@ -422,7 +773,7 @@ namespace ndarray {
      * @return shape of a sub-ndarray
      */
     template<size_t D>
-    std::vector<size_t> get_shape(const std::vector<size_t> &old_shape, const std::array<size_t, D> &inds) const {
+    shape_t get_shape(const shape_t &old_shape, const std::array<size_t, D> &inds) const {
 #ifndef NDEBUG
       size_t num_of_inds = D;
       check_dimensions(old_shape, num_of_inds);
@@ -431,7 +782,7 @@ namespace ndarray {
           throw std::logic_error(std::to_string(i) + "-th index is larger than its dimension.");
       }
 #endif
-      std::vector<size_t> shape(old_shape.size() - D, 0);
+      shape_t shape(old_shape.size() - D, 0);
       std::copy(old_shape.data() + D, old_shape.data() + old_shape.size(), shape.data());
       return shape;
     }
@@ -444,8 +795,8 @@ namespace ndarray {
      * @return a vector of strides for an ndarray of given shape
      */
     template<typename Container>
-    std::vector<size_t> strides_for_shape(const Container &shape) const {
-      std::vector<size_t> str(shape.size());
+    shape_t strides_for_shape(const Container &shape) const {
+      shape_t str(shape.size());
       if (shape.size() == 0)
         return str;
       str[shape.size() - 1] = 1;
@@ -454,6 +805,61 @@ namespace ndarray {
       return str;
     }
 
+    /**
+     * Compute layout of a general slice
+     *
+     * @param args - indices and ranges for leading dimensions
+     * @param shape - shape of the slice
+     * @param strides - strides of the slice
+     * @return offset of the first element of the slice
+     */
+    template<size_t D>
+    size_t slice_layout(const std::array<detail::slice_argument, D> &args, shape_t &shape,
+                        shape_t &strides) const {
+#ifndef NDEBUG
+      check_dimensions(shape_, D);
+#endif
+      size_t offset = offset_;
+      for (size_t k = 0; k < D; ++k) {
+        std::ptrdiff_t n = std::ptrdiff_t(shape_[k]);
+        if (args[k].is_index) {
+          std::ptrdiff_t i = args[k].index < 0 ? args[k].index + n : args[k].index;
+#ifndef NDEBUG
+          if (i < 0 || i >= n)
+            throw std::logic_error(std::to_string(k) + "-th index is larger than its dimension.");
+#endif
+          offset += size_t(i) * strides_[k];
+          continue;
+        }
+        const range &r = args[k].rng;
+        if (r.step == 0) {
+          throw std::logic_error("Slice step cannot be zero.");
+        }
+        std::ptrdiff_t lo = r.step > 0 ? 0 : -1;
+        std::ptrdiff_t hi = r.step > 0 ? n : n - 1;
+        std::ptrdiff_t start = r.start == none ? (r.step > 0 ? lo : hi) : (r.start < 0 ? r.start + n : r.start);
+        std::ptrdiff_t stop = r.stop == none ? (r.step > 0 ? hi : lo) : (r.stop < 0 ? r.stop + n : r.stop);
+        start = std::min(std::max(start, lo), hi);
+        stop = std::min(std::max(stop, lo), hi);
+        std::ptrdiff_t len = r.step > 0 ? (stop - start + r.step - 1) / r.step : (start - stop - r.step - 1) / (-r.step);
+        len = std::max(len, std::ptrdiff_t(0));
+        if (len > 0) {
+          offset += size_t(start) * strides_[k];
+        }
+        shape.push_back(size_t(len));
+        strides.push_back(size_t(r.step) * strides_[k]);
+      }
+      shape.insert(shape.end(), shape_.begin() + D, shape_.end());
+      strides.insert(strides.end(), strides_.begin() + D, strides_.end());
+      return offset;
+    }
+
+    void check_contiguous() const {
+      if (!is_contiguous()) {
+        throw std::runtime_error("Linear iteration over non-contiguous array.");
+      }
+    }
+
     /**
      * Check that array is zero-dimension. Throw an exception if it's not.
      */
@@ -464,7 +870,7 @@ namespace ndarray {
       }
     }
 
-    void check_dimensions(const std::vector<size_t> &shape, size_t num_of_inds) const {
+    void check_dimensions(const shape_t &shape, size_t num_of_inds) const {
       if (num_of_inds > shape.size()) {
         throw std::runtime_error("Number of indices (" +
                                  std::to_string(num_of_inds) + ") is larger than array's dimension (" +
@@ -0,0 +1,784 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_NDARRAY_IO_H
+#define NDARRAY_NDARRAY_IO_H
+
+#include <algorithm>
+#include <cerrno>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <ndarray/ndarray.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NDARRAY_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define NDARRAY_HAVE_MMAP 0
+#endif
+
+namespace ndarray {
+
+  /**
+   * Element types of the native binary format
+   */
+  enum class dtype : uint32_t {
+    int8 = 1, uint8, int16, uint16, int32, uint32, int64, uint64, float32, float64, complex64, complex128, boolean
+  };
+
+  namespace detail {
+
+    template<typename T, typename = void>
+    struct dtype_of;
+
+    template<>
+    struct dtype_of<bool> : std::integral_constant<dtype, dtype::boolean> {
+    };
+
+    template<size_t Size, bool Signed>
+    struct integer_dtype;
+
+    template<>
+    struct integer_dtype<1, true> : std::integral_constant<dtype, dtype::int8> {
+    };
+
+    template<>
+    struct integer_dtype<1, false> : std::integral_constant<dtype, dtype::uint8> {
+    };
+
+    template<>
+    struct integer_dtype<2, true> : std::integral_constant<dtype, dtype::int16> {
+    };
+
+    template<>
+    struct integer_dtype<2, false> : std::integral_constant<dtype, dtype::uint16> {
+    };
+
+    template<>
+    struct integer_dtype<4, true> : std::integral_constant<dtype, dtype::int32> {
+    };
+
+    template<>
+    struct integer_dtype<4, false> : std::integral_constant<dtype, dtype::uint32> {
+    };
+
+    template<>
+    struct integer_dtype<8, true> : std::integral_constant<dtype, dtype::int64> {
+    };
+
+    template<>
+    struct integer_dtype<8, false> : std::integral_constant<dtype, dtype::uint64> {
+    };
+
+    template<typename T>
+    struct dtype_of<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> :
+        integer_dtype<sizeof(T), std::is_signed<T>::value> {
+    };
+
+    template<>
+    struct dtype_of<float> : std::integral_constant<dtype, dtype::float32> {
+    };
+
+    template<>
+    struct dtype_of<double> : std::integral_constant<dtype, dtype::float64> {
+    };
+
+    template<>
+    struct dtype_of<std::complex<float> > : std::integral_constant<dtype, dtype::complex64> {
+    };
+
+    template<>
+    struct dtype_of<std::complex<double> > : std::integral_constant<dtype, dtype::complex128> {
+    };
+
+    /**
+     * Fixed part of the header of the native format. It is followed by `rank` extents and `rank` strides
+     * (in elements) as 64-bit integers, the payload starts at `data_offset`, a multiple of `default_alignment`.
+     */
+    struct native_header {
+      char magic[8];
+      uint32_t version;
+      // 0x01020304 in the byte order of the writer
+      uint32_t byte_order;
+      uint32_t type;
+      uint32_t item_size;
+      uint64_t rank;
+      uint64_t data_offset;
+      uint64_t data_size;
+    };
+
+    inline const char *native_magic() {
+      return "NDARRAY";
+    }
+
+    constexpr uint32_t native_version = 1;
+    constexpr uint32_t native_byte_order = 0x01020304;
+
+    inline std::runtime_error io_error(const std::string &message, const std::string &filename) {
+      return std::runtime_error(message + " '" + filename + "': " + std::strerror(errno) + ".");
+    }
+
+    inline std::runtime_error format_error(const std::string &message, const std::string &filename) {
+      return std::runtime_error("File '" + filename + "' " + message + ".");
+    }
+
+    inline size_t aligned_size(size_t size, size_t alignment) {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+    using file_handle = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+    inline file_handle open_file(const std::string &filename, const char *mode) {
+      file_handle file(std::fopen(filename.c_str(), mode), &std::fclose);
+      if (!file) {
+        throw io_error("Cannot open file", filename);
+      }
+      return file;
+    }
+
+    /**
+     * How writes to a mapped file are handled
+     */
+    enum class mapping_mode {
+      // writes stay in memory of the process
+      copy_on_write,
+      // writes are stored to the file
+      shared
+    };
+
+    /**
+     * Expected use of a range of a mapped file
+     */
+    enum class access_hint {
+      normal,
+      sequential,
+      random,
+      // the range is going to be accessed soon, start reading it
+      will_need,
+      // the range is not going to be accessed soon, its pages can be dropped from memory
+      dont_need
+    };
+
+    /**
+     * Content of a whole file. Where `mmap` is available the file is mapped: pages are loaded on first access and
+     * can be dropped from memory by the system at any time. Elsewhere copy-on-write files are read into memory,
+     * and shared mappings are not supported.
+     */
+    class file_mapping {
+    public:
+      explicit file_mapping(const std::string &filename, mapping_mode mode = mapping_mode::copy_on_write) :
+          data_(nullptr), size_(0) {
+#if NDARRAY_HAVE_MMAP
+        bool shared = mode == mapping_mode::shared;
+        int fd = ::open(filename.c_str(), shared ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+          throw io_error("Cannot open file", filename);
+        }
+        struct stat status;
+        if (::fstat(fd, &status) != 0) {
+          ::close(fd);
+          throw io_error("Cannot get size of file", filename);
+        }
+        size_ = size_t(status.st_size);
+        if (size_ > 0) {
+          void *data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+          if (data == MAP_FAILED) {
+            ::close(fd);
+            throw io_error("Cannot map file", filename);
+          }
+          data_ = static_cast<char *>(data);
+        }
+        ::close(fd);
+#else
+        if (mode == mapping_mode::shared) {
+          throw std::runtime_error("Shared file mappings are not supported on this platform.");
+        }
+        file_handle file = open_file(filename, "rb");
+        if (std::fseek(file.get(), 0, SEEK_END) != 0) {
+          throw io_error("Cannot get size of file", filename);
+        }
+        size_ = size_t(std::ftell(file.get()));
+        std::rewind(file.get());
+        buffer_.reset(new char[size_ + 1]);
+        if (std::fread(buffer_.get(), 1, size_, file.get()) != size_) {
+          throw io_error("Cannot read file", filename);
+        }
+        data_ = buffer_.get();
+#endif
+      }
+
+      file_mapping(const file_mapping &) = delete;
+
+      file_mapping &operator=(const file_mapping &) = delete;
+
+      ~file_mapping() {
+#if NDARRAY_HAVE_MMAP
+        if (data_ != nullptr) {
+          ::munmap(data_, size_);
+        }
+#endif
+      }
+
+      char *data() const {
+        return data_;
+      }
+
+      /**
+       * Store modified pages of a shared mapping to the file
+       */
+      void sync() const {
+#if NDARRAY_HAVE_MMAP
+        if (data_ != nullptr && ::msync(data_, size_, MS_SYNC) != 0) {
+          throw std::runtime_error(std::string("Cannot store mapped data: ") + std::strerror(errno) + ".");
+        }
+#endif
+      }
+
+      /**
+       * Pass a hint on the use of bytes `[begin, end)` to the system, the range is extended to whole pages.
+       * Dropped pages of a shared mapping are read back from the file on the next access, dropped pages
+       * of a copy-on-write mapping lose their modifications.
+       */
+      void advise(size_t begin, size_t end, access_hint hint) const {
+#if NDARRAY_HAVE_MMAP
+        if (data_ == nullptr || begin >= end) {
+          return;
+        }
+        static const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+        begin = begin / page * page;
+        end = std::min(aligned_size(end, page), size_);
+        int advice = hint == access_hint::sequential ? MADV_SEQUENTIAL : hint == access_hint::random ? MADV_RANDOM :
+                     hint == access_hint::will_need ? MADV_WILLNEED : hint == access_hint::dont_need ? MADV_DONTNEED :
+                     MADV_NORMAL;
+        // hints are optional, failures are ignored
+        ::madvise(data_ + begin, end - begin, advice);
+#else
+        (void) begin;
+        (void) end;
+        (void) hint;
+#endif
+      }
+
+      size_t size() const {
+        return size_;
+      }
+
+    private:
+      char *data_;
+      size_t size_;
+#if !NDARRAY_HAVE_MMAP
+      std::unique_ptr<char[]> buffer_;
+#endif
+    };
+
+    /**
+     * Layout of an array stored in the native format
+     */
+    struct native_layout {
+      dtype type;
+      size_t item_size;
+      shape_t shape;
+      shape_t strides;
+      size_t data_offset;
+      size_t data_size;
+    };
+
+    /**
+     * Parse and validate the header of the native format at the beginning of `data` of `size` bytes
+     */
+    inline native_layout parse_native_header(const char *data, size_t size, const std::string &filename) {
+      native_header header;
+      if (size < sizeof(header)) {
+        throw format_error("is too short for an ndarray header", filename);
+      }
+      std::memcpy(&header, data, sizeof(header));
+      if (std::memcmp(header.magic, native_magic(), sizeof(header.magic)) != 0) {
+        throw format_error("is not in the ndarray format", filename);
+      }
+      if (header.version != native_version) {
+        throw format_error("has unsupported version " + std::to_string(header.version), filename);
+      }
+      if (header.byte_order != native_byte_order) {
+        throw format_error("was written with a different byte order", filename);
+      }
+      if (header.rank > (size - sizeof(header)) / (2 * sizeof(uint64_t))) {
+        throw format_error("has a truncated header", filename);
+      }
+      native_layout layout;
+      layout.type = dtype(header.type);
+      layout.item_size = size_t(header.item_size);
+      std::vector<uint64_t> dims(2 * header.rank);
+      if (header.rank != 0) {
+        std::memcpy(dims.data(), data + sizeof(header), dims.size() * sizeof(uint64_t));
+      }
+      layout.shape = shape_t(dims.begin(), dims.begin() + header.rank);
+      layout.strides = shape_t(dims.begin() + header.rank, dims.end());
+      layout.data_offset = size_t(header.data_offset);
+      layout.data_size = size_t(header.data_size);
+      if (layout.data_offset < sizeof(header) + dims.size() * sizeof(uint64_t) || layout.data_offset > size ||
+          layout.data_size > size - layout.data_offset) {
+        throw format_error("is truncated", filename);
+      }
+      if (header.item_size == 0 || layout.data_offset % header.item_size != 0) {
+        throw format_error("has misaligned data", filename);
+      }
+      size_t count = 1;
+      for (size_t extent : layout.shape) {
+        if (extent != 0 && count > SIZE_MAX / extent) {
+          throw format_error("has too many elements", filename);
+        }
+        count *= extent;
+      }
+      if (count == 0) {
+        return layout;
+      }
+      // all elements addressed by shape and strides have to be in the payload
+      size_t elements = layout.data_size / header.item_size;
+      if (elements == 0) {
+        throw format_error("has layout outside of the stored data", filename);
+      }
+      size_t last = 0;
+      for (size_t k = 0; k < layout.shape.size(); ++k) {
+        size_t stride = layout.strides[k];
+        if (stride != 0 && layout.shape[k] - 1 > (elements - 1 - last) / stride) {
+          throw format_error("has layout outside of the stored data", filename);
+        }
+        last += (layout.shape[k] - 1) * stride;
+      }
+      return layout;
+    }
+
+    /**
+     * Header of the native format for a dense array of type `T`, padded to the start of the payload
+     */
+    template<typename T>
+    std::vector<char> native_header_bytes(const shape_t &shape, const shape_t &strides) {
+      native_header header;
+      std::memcpy(header.magic, native_magic(), sizeof(header.magic));
+      header.version = native_version;
+      header.byte_order = native_byte_order;
+      header.type = uint32_t(dtype_of<T>::value);
+      header.item_size = uint32_t(sizeof(T));
+      header.rank = shape.size();
+      std::vector<uint64_t> dims(shape.begin(), shape.end());
+      dims.insert(dims.end(), strides.begin(), strides.end());
+      header.data_offset = aligned_size(sizeof(header) + dims.size() * sizeof(uint64_t), default_alignment);
+      header.data_size = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>()) * sizeof(T);
+      std::vector<char> head(header.data_offset, 0);
+      std::memcpy(head.data(), &header, sizeof(header));
+      if (!dims.empty()) {
+        std::memcpy(head.data() + sizeof(header), dims.data(), dims.size() * sizeof(uint64_t));
+      }
+      return head;
+    }
+
+    /**
+     * Header of the native format for a dense row-major array of type `T`
+     */
+    template<typename T>
+    std::vector<char> native_header_bytes(const shape_t &shape) {
+      shape_t strides(shape.size(), 1);
+      for (size_t k = shape.size(); k > 1; --k) {
+        strides[k - 2] = strides[k - 1] * shape[k - 1];
+      }
+      return native_header_bytes<T>(shape, strides);
+    }
+
+  }
+
+  namespace detail {
+
+    /**
+     * Array stored in the native format in a mapped file, referring directly to the mapping
+     */
+    template<typename T>
+    ndarray<T> native_array(const std::shared_ptr<file_mapping> &mapping, const std::string &filename) {
+      native_layout layout = parse_native_header(mapping->data(), mapping->size(), filename);
+      if (layout.type != dtype_of<typename std::remove_const<T>::type>::value) {
+        throw format_error("stores elements of a different type", filename);
+      }
+      if (layout.item_size != sizeof(T)) {
+        throw format_error("stores elements of a different size", filename);
+      }
+      std::shared_ptr<T> data(mapping, reinterpret_cast<T *>(mapping->data() + layout.data_offset));
+      return ndarray<T>(data, layout.shape, layout.strides, 0);
+    }
+
+  }
+
+  /**
+   * Store array in the self-describing native binary format: a header with the element type, shape and strides,
+   * followed by a dense row-major copy of the elements aligned to `default_alignment` bytes.
+   * The byte order of the writer is recorded and files are only read on machines with the same byte order.
+   *
+   * @param array - array to store, non-contiguous views are stored as dense arrays
+   * @param filename - path to the file, an existing file is overwritten
+   */
+  template<typename T>
+  void save(const ndarray<T> &array, const std::string &filename) {
+    using value_type = typename std::remove_const<T>::type;
+    ndarray<const value_type> dense = array.is_contiguous() ? ndarray<const value_type>(array) :
+                                      ndarray<const value_type>(array.copy());
+    std::vector<char> head = detail::native_header_bytes<value_type>(dense.shape(), dense.strides());
+    detail::file_handle file = detail::open_file(filename, "wb");
+    if (std::fwrite(head.data(), 1, head.size(), file.get()) != head.size() ||
+        std::fwrite(dense.begin(), sizeof(value_type), dense.size(), file.get()) != dense.size() ||
+        std::fflush(file.get()) != 0) {
+      throw detail::io_error("Cannot write file", filename);
+    }
+  }
+
+  /**
+   * Load array stored by `save`. The file is memory mapped and the returned array refers directly to the mapping,
+   * so opening does not depend on the size of the data: pages are read when they are first accessed.
+   * The mapping is private, modifications of the array are not written to the file. It stays alive as long as
+   * any array refers to it.
+   *
+   * @tparam T - element type, has to be the type the file was stored with
+   * @param filename - path to the file
+   * @return array with the stored shape and strides
+   */
+  template<typename T>
+  ndarray<T> load(const std::string &filename) {
+    return detail::native_array<T>(std::make_shared<detail::file_mapping>(filename), filename);
+  }
+
+  namespace detail {
+
+    /**
+     * Kind character and size of `T` in NumPy type descriptors
+     */
+    template<typename T>
+    struct npy_kind {
+      static constexpr char value = std::is_same<T, bool>::value ? 'b' : std::is_floating_point<T>::value ? 'f' :
+                                                                         std::is_signed<T>::value ? 'i' : 'u';
+    };
+
+    template<typename T>
+    struct npy_kind<std::complex<T> > {
+      static constexpr char value = 'c';
+    };
+
+    inline bool little_endian() {
+      const uint16_t probe = 1;
+      char first;
+      std::memcpy(&first, &probe, 1);
+      return first == 1;
+    }
+
+    /**
+     * NumPy type descriptor of `T` in the byte order of this machine, e.g. `<f8` for `double`
+     */
+    template<typename T>
+    std::string npy_descr() {
+      static_assert(is_scalar<T>::value, "NumPy files store arrays of arithmetic or complex types.");
+      char order = sizeof(T) == 1 ? '|' : little_endian() ? '<' : '>';
+      return std::string(1, order) + npy_kind<T>::value + std::to_string(sizeof(T));
+    }
+
+    /**
+     * Number of digits reserved for the first extent of arrays written by `npy_writer`
+     */
+    constexpr size_t npy_extent_digits = 20;
+
+    /**
+     * Complete NumPy header (magic string, version, length and dictionary) describing a C-ordered array.
+     * The dictionary is padded with spaces, so that the data starts at a multiple of 64 bytes.
+     *
+     * @param reserve - minimal width of the first extent, so that the header can be rewritten with a larger one
+     */
+    template<typename T>
+    std::string npy_header(const shape_t &shape, size_t reserve = 0) {
+      std::string dict = "{'descr': '" + npy_descr<T>() + "', 'fortran_order': False, 'shape': (";
+      for (size_t k = 0; k < shape.size(); ++k) {
+        std::string extent = std::to_string(shape[k]);
+        if (k == 0 && extent.size() < reserve) {
+          extent.insert(0, reserve - extent.size(), ' ');
+        }
+        dict += extent + (shape.size() == 1 ? "," : k + 1 < shape.size() ? ", " : "");
+      }
+      dict += "), }";
+      // version 1.0 has 10 bytes before the dictionary, version 2.0 has 12 bytes
+      size_t prefix = dict.size() + 64 < 65536 ? 10 : 12;
+      size_t length = aligned_size(prefix + dict.size() + 1, 64) - prefix;
+      dict.append(length - dict.size() - 1, ' ');
+      dict += '\n';
+      std::string header("\x93NUMPY", 6);
+      header += char(prefix == 10 ? 1 : 2);
+      header += char(0);
+      for (size_t i = 0; i < prefix - 8; ++i) {
+        header += char((length >> (8 * i)) & 0xff);
+      }
+      return header + dict;
+    }
+
+    /**
+     * Layout of an array stored in a NumPy file
+     */
+    struct npy_layout {
+      std::string descr;
+      bool fortran_order;
+      shape_t shape;
+      size_t data_offset;
+    };
+
+    inline std::string npy_value(const std::string &dict, const std::string &key, const std::string &filename) {
+      size_t position = dict.find("'" + key + "'");
+      if (position == std::string::npos) {
+        throw format_error("has no '" + key + "' in the header", filename);
+      }
+      position = dict.find(':', position);
+      if (position == std::string::npos) {
+        throw format_error("has a malformed header", filename);
+      }
+      size_t begin = dict.find_first_not_of(' ', position + 1);
+      if (begin == std::string::npos) {
+        throw format_error("has a malformed header", filename);
+      }
+      size_t end = dict[begin] == '(' ? dict.find(')', begin) + 1 :
+                   dict[begin] == '\'' ? dict.find('\'', begin + 1) + 1 : dict.find_first_of(",}", begin);
+      if (end == std::string::npos || end == 0) {
+        throw format_error("has a malformed header", filename);
+      }
+      return dict.substr(begin, end - begin);
+    }
+
+    /**
+     * Parse the header of a NumPy file at the beginning of `data` of `size` bytes
+     */
+    inline npy_layout parse_npy_header(const char *data, size_t size, const std::string &filename) {
+      if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) {
+        throw format_error("is not a NumPy array file", filename);
+      }
+      unsigned major = static_cast<unsigned char>(data[6]);
+      if (major < 1 || major > 3) {
+        throw format_error("has unsupported NumPy format version " + std::to_string(major), filename);
+      }
+      size_t prefix = major == 1 ? 10 : 12;
+      if (size < prefix) {
+        throw format_error("has a truncated header", filename);
+      }
+      size_t length = 0;
+      for (size_t i = 0; i < prefix - 8; ++i) {
+        length |= size_t(static_cast<unsigned char>(data[8 + i])) << (8 * i);
+      }
+      if (length > size - prefix) {
+        throw format_error("has a truncated header", filename);
+      }
+      std::string dict(data + prefix, length);
+      npy_layout layout;
+      std::string descr = npy_value(dict, "descr", filename);
+      if (descr.size() < 2 || descr.front() != '\'') {
+        throw format_error("stores structured elements", filename);
+      }
+      layout.descr = descr.substr(1, descr.size() - 2);
+      std::string order = npy_value(dict, "fortran_order", filename);
+      if (order != "True" && order != "False") {
+        throw format_error("has a malformed header", filename);
+      }
+      layout.fortran_order = order == "True";
+      std::string shape = npy_value(dict, "shape", filename);
+      const char *digits = "0123456789";
+      for (size_t begin = shape.find_first_of(digits), end; begin != std::string::npos;
+           begin = shape.find_first_of(digits, end)) {
+        end = shape.find_first_not_of(digits, begin);
+        layout.shape.push_back(size_t(std::stoull(shape.substr(begin, end - begin))));
+      }
+      layout.data_offset = prefix + length;
+      return layout;
+    }
+
+    /**
+     * Check that a NumPy type descriptor matches `T` in the byte order of this machine
+     */
+    template<typename T>
+    void check_npy_descr(const std::string &descr, const std::string &filename) {
+      std::string expected = npy_descr<T>();
+      if (descr.size() != expected.size() || descr.substr(1) != expected.substr(1)) {
+        throw format_error("stores elements of type '" + descr + "' instead of '" + expected + "'", filename);
+      }
+      if (descr[0] != expected[0] && descr[0] != '=' && descr[0] != '|') {
+        throw format_error("was written with a different byte order", filename);
+      }
+    }
+
+  }
+
+  /**
+   * Store array in the NumPy `.npy` format (version 1.0, or 2.0 for very long headers) in C order.
+   *
+   * @param array - array to store, non-contiguous views are stored as dense arrays
+   * @param filename - path to the file, an existing file is overwritten
+   */
+  template<typename T>
+  void save_npy(const ndarray<T> &array, const std::string &filename) {
+    using value_type = typename std::remove_const<T>::type;
+    ndarray<const value_type> dense = array.is_contiguous() ? ndarray<const value_type>(array) :
+                                      ndarray<const value_type>(array.copy());
+    std::string header = detail::npy_header<value_type>(dense.shape());
+    detail::file_handle file = detail::open_file(filename, "wb");
+    if (std::fwrite(header.data(), 1, header.size(), file.get()) != header.size() ||
+        std::fwrite(dense.begin(), sizeof(value_type), dense.size(), file.get()) != dense.size() ||
+        std::fflush(file.get()) != 0) {
+      throw detail::io_error("Cannot write file", filename);
+    }
+  }
+
+  /**
+   * Load array from a NumPy `.npy` file. As with `load` the file is mapped privately and the returned array refers
+   * directly to the mapping. Arrays in Fortran order are returned as views with column-major strides.
+   * Data that is not aligned for `T` within the file is copied.
+   *
+   * @tparam T - element type, has to match the type descriptor of the file
+   * @param filename - path to the file
+   */
+  template<typename T>
+  ndarray<T> load_npy(const std::string &filename) {
+    using value_type = typename std::remove_const<T>::type;
+    std::shared_ptr<detail::file_mapping> mapping = std::make_shared<detail::file_mapping>(filename);
+    detail::npy_layout layout = detail::parse_npy_header(mapping->data(), mapping->size(), filename);
+    detail::check_npy_descr<value_type>(layout.descr, filename);
+    size_t size = 1;
+    for (size_t extent : layout.shape) {
+      if (extent != 0 && size > SIZE_MAX / extent) {
+        throw detail::format_error("has too many elements", filename);
+      }
+      size *= extent;
+    }
+    if (size > (mapping->size() - layout.data_offset) / sizeof(value_type)) {
+      throw detail::format_error("is truncated", filename);
+    }
+    shape_t strides(layout.shape.size());
+    size_t stride = 1;
+    for (size_t k = 0; k < layout.shape.size(); ++k) {
+      size_t axis = layout.fortran_order ? k : layout.shape.size() - 1 - k;
+      strides[axis] = stride;
+      stride *= layout.shape[axis];
+    }
+    const char *payload = mapping->data() + layout.data_offset;
+    if (reinterpret_cast<uintptr_t>(payload) % alignof(value_type) == 0) {
+      std::shared_ptr<T> data(mapping, reinterpret_cast<T *>(mapping->data() + layout.data_offset));
+      return ndarray<T>(data, layout.shape, strides, 0);
+    }
+    ndarray<value_type> flat(uninitialized, shape_t(1, size));
+    std::memcpy(flat.begin(), payload, size * sizeof(value_type));
+    return ndarray<T>(flat.data(), layout.shape, strides, 0);
+  }
+
+  /**
+   * Streaming writer of a NumPy `.npy` file for arrays built incrementally along the first axis. Rows are appended
+   * to the file as they are written, and the header is updated with the final number of rows by `close`, so memory
+   * use does not depend on the size of the file.
+   *
+   * @tparam T - element type
+   */
+  template<typename T>
+  class npy_writer {
+  public:
+    /**
+     * @param filename - path to the file, an existing file is overwritten
+     * @param row_shape - shape of a row, the stored array has shape `(rows, row_shape...)`
+     */
+    npy_writer(const std::string &filename, const shape_t &row_shape) : filename_(filename),
+                                                                         file_(detail::open_file(filename, "wb")),
+                                                                         row_shape_(row_shape), rows_(0) {
+      write_header(file_.get());
+    }
+
+    npy_writer(const npy_writer &) = delete;
+
+    npy_writer &operator=(const npy_writer &) = delete;
+
+    /**
+     * Errors while closing the file in the destructor are ignored, call `close` to check them
+     */
+    ~npy_writer() {
+      try {
+        close();
+      } catch (const std::exception &) {
+      }
+    }
+
+    /**
+     * Append rows to the file
+     *
+     * @param rows - a single row of shape `row_shape`, or several rows of shape `(k, row_shape...)`
+     */
+    template<typename T2>
+    void write(const ndarray<T2> &rows) {
+      static_assert(std::is_same<typename std::remove_const<T2>::type, T>::value, "Element type mismatch.");
+      if (!file_) {
+        throw std::runtime_error("File '" + filename_ + "' is already closed.");
+      }
+      bool single = rows.shape() == row_shape_;
+      if (!single && (rows.dim() != row_shape_.size() + 1 ||
+                      !std::equal(row_shape_.begin(), row_shape_.end(), rows.shape().begin() + 1))) {
+        throw std::runtime_error("Array of shape " + detail::shape_string(rows.shape()) +
+                                 " does not consist of rows of shape " + detail::shape_string(row_shape_) + ".");
+      }
+      ndarray<const T> dense = rows.is_contiguous() ? ndarray<const T>(rows) : ndarray<const T>(rows.copy());
+      if (std::fwrite(dense.begin(), sizeof(T), dense.size(), file_.get()) != dense.size()) {
+        throw detail::io_error("Cannot write file", filename_);
+      }
+      rows_ += single ? 1 : rows.shape()[0];
+    }
+
+    /**
+     * @return number of rows written so far
+     */
+    size_t rows() const {
+      return rows_;
+    }
+
+    /**
+     * Store the final number of rows in the header and close the file. Further writes are not allowed.
+     */
+    void close() {
+      if (!file_) {
+        return;
+      }
+      detail::file_handle file(std::move(file_));
+      if (std::fseek(file.get(), 0, SEEK_SET) != 0) {
+        throw detail::io_error("Cannot write file", filename_);
+      }
+      write_header(file.get());
+      if (std::fclose(file.release()) != 0) {
+        throw detail::io_error("Cannot write file", filename_);
+      }
+    }
+
+  private:
+    std::string filename_;
+    detail::file_handle file_;
+    shape_t row_shape_;
+    size_t rows_;
+
+    void write_header(std::FILE *file) {
+      shape_t shape(1, rows_);
+      shape.insert(shape.end(), row_shape_.begin(), row_shape_.end());
+      std::string header = detail::npy_header<T>(shape, detail::npy_extent_digits);
+      if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        throw detail::io_error("Cannot write file", filename_);
+      }
+    }
+  };
+
+}
+
+#endif //NDARRAY_NDARRAY_IO_H
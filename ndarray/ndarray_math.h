@@ -6,153 +6,925 @@
 #ifndef ALPS_NDARRAY_MATH_H
 #define ALPS_NDARRAY_MATH_H
 
+#include <cstdint>
+#include <limits>
+
+#include <ndarray/gemm.h>
 #include <ndarray/ndarray.h>
+#include <ndarray/ndarray_view.h>
+#include <ndarray/plan_cache.h>
+#include <ndarray/simd.h>
+#include <ndarray/transpose_kernel.h>
 
 namespace ndarray {
 
+  // Arithmetic operations on tensors
+
   namespace detail {
+
+    /**
+     * Shape of the result of an operation between arrays of shapes `a` and `b`. Shapes are aligned at the
+     * trailing dimension, missing leading dimensions and dimensions of extent 1 are stretched to the extent of
+     * the other operand.
+     */
+    template<typename ShapeA, typename ShapeB>
+    shape_t broadcast_shape(const ShapeA &a, const ShapeB &b) {
+      size_t rank = std::max(a.size(), b.size());
+      shape_t shape(rank);
+      for (size_t k = 0; k < rank; ++k) {
+        size_t da = k + a.size() < rank ? 1 : a[k + a.size() - rank];
+        size_t db = k + b.size() < rank ? 1 : b[k + b.size() - rank];
+        if (da != db && da != 1 && db != 1) {
+          throw std::runtime_error("Arrays of shapes " + shape_string(a) + " and " + shape_string(b) +
+                                   " cannot be broadcast together.");
+        }
+        shape[k] = da == 1 ? db : da;
+      }
+      return shape;
+    }
+
+    template<typename T>
+    struct real_type {
+      using type = T;
+    };
+
     template<typename T>
-    ndarray<T> transpose_impl(const ndarray<T>& array, const std::vector<size_t> &pattern) {
-      std::vector<size_t> shape(array.shape().size());
-      for (size_t i(0); i < array.shape().size(); ++i) {
-        shape[pattern[i]] = array.shape()[i];
+    struct real_type<std::complex<T> > {
+      using type = T;
+    };
+
+    /**
+     * Type of a product of `A` and `B`, complex if any of them is complex with the precision of the wider one
+     */
+    template<typename A, typename B>
+    struct product_type {
+      using real = typename std::common_type<typename real_type<A>::type, typename real_type<B>::type>::type;
+      using type = typename std::conditional<is_complex<A>::value || is_complex<B>::value,
+                                             std::complex<real>, real>::type;
+    };
+
+    /**
+     * Array with elements of type `R`: shares data with `array` if it already stores `R`, otherwise
+     * a converted dense copy. Operands are only read through the result, so arrays of const elements are shared too.
+     */
+    template<typename R, typename T>
+    typename std::enable_if<std::is_same<typename std::remove_const<T>::type, R>::value, ndarray<R> >::type
+    cast_array(const ndarray<T> &array) {
+      return ndarray<R>(std::const_pointer_cast<R>(array.data()), array.shape(), array.strides(), array.offset());
+    }
+
+    template<typename R, typename T>
+    typename std::enable_if<!std::is_same<typename std::remove_const<T>::type, R>::value, ndarray<R> >::type
+    cast_array(const ndarray<T> &array) {
+      ndarray<R> result(uninitialized, array.shape());
+      parallel_strided_for_each(array.shape(), result.data().get(), result.strides(),
+                                array.data().get() + array.offset(), array.strides(),
+                                [](R &out, const T &in) { out = R(in); });
+      return result;
+    }
+
+    /**
+     * Operand of a matrix product: an array viewed as a matrix, whose rows run over the leading dimensions
+     * and columns over the remaining ones. The matrix is stored either row-major or transposed with leading
+     * dimension `ld`. Arrays that can not be described this way are copied into a dense array.
+     */
+    template<typename T>
+    struct matrix_operand {
+      // keeps the data alive
+      ndarray<T> array;
+      const T *data;
+      size_t rows;
+      size_t cols;
+      size_t ld;
+      bool trans;
+    };
+
+    /**
+     * Extent and stride of dimensions `[begin, end)` of `array` traversed as a single dimension.
+     *
+     * @return false if the dimensions can not be fused
+     */
+    template<typename T>
+    bool fused_dimension(const ndarray<T> &array, size_t begin, size_t end, size_t &extent, size_t &stride) {
+      extent = 1;
+      stride = 0;
+      bool first = true;
+      for (size_t d = end; d > begin; --d) {
+        size_t n = array.shape()[d - 1];
+        if (n == 1) {
+          continue;
+        }
+        if (first) {
+          stride = array.strides()[d - 1];
+          first = false;
+        } else if (array.strides()[d - 1] != stride * extent) {
+          return false;
+        }
+        extent *= n;
       }
-      ndarray<T> result(shape);
-      std::vector<size_t> indices(array.dim(), 0);
-      for (size_t i(0); i < array.size(); ++i) {
-        size_t res = i;
-        for (size_t ind(0); ind < array.dim(); ++ind) {
-          indices[pattern[array.dim() - ind - 1]] = res % array.shape()[array.dim() - ind - 1];
-          res /= array.shape()[array.dim() - ind - 1];
+      // negative strides are not supported by matrix kernels
+      return stride <= size_t(std::numeric_limits<std::ptrdiff_t>::max());
+    }
+
+    /**
+     * @param array - operand
+     * @param split - number of leading dimensions that form the rows of the matrix
+     */
+    template<typename T>
+    matrix_operand<T> make_matrix_operand(const ndarray<T> &array, size_t split) {
+      size_t rows, cols, row_stride, col_stride;
+      if (fused_dimension(array, 0, split, rows, row_stride) &&
+          fused_dimension(array, split, array.dim(), cols, col_stride)) {
+        const T *data = array.data().get() + array.offset();
+        if (rows <= 1) {
+          row_stride = std::max(cols, size_t(1));
+        }
+        if (cols <= 1) {
+          col_stride = 1;
+        }
+        if (col_stride == 1 && row_stride >= cols) {
+          return matrix_operand<T>{array, data, rows, cols, row_stride, false};
+        }
+        if (row_stride == 1 && col_stride >= rows) {
+          return matrix_operand<T>{array, data, rows, cols, col_stride, true};
         }
-        std::transform(indices.begin(), indices.end(), result.strides().begin(), indices.begin(),
-                       std::multiplies<size_t>());
-        size_t ind = std::accumulate(indices.begin(), indices.end(), size_t(0), std::plus<size_t>());
-        result.data().get()[ind] = array.data().get()[array.offset() + i];
       }
-      return result;
+      ndarray<T> dense = array.copy();
+      rows = 1;
+      for (size_t d = 0; d < split; ++d) {
+        rows *= array.shape()[d];
+      }
+      cols = rows == 0 ? 0 : dense.size() / rows;
+      return matrix_operand<T>{dense, dense.data().get(), rows, cols, std::max(cols, size_t(1)), false};
     }
+
+    /**
+     * `c = a * b` for matrix operands, `c` is dense with `b.cols` columns
+     */
+    template<typename T>
+    void matrix_product(const matrix_operand<T> &a, const matrix_operand<T> &b, T *c) {
+      gemm(a.trans, b.trans, a.rows, b.cols, a.cols, a.data, a.ld, b.data, b.ld, c, std::max(b.cols, size_t(1)));
+    }
+
   }
 
-  // Arithmetic operations on tensors
+  /**
+   * View of an array stretched to `shape` without copying: missing leading dimensions and dimensions of extent 1
+   * get stride 0. Elements of the view that map to the same element of `array` must not be written concurrently.
+   *
+   * @param array - array to be broadcast
+   * @param shape - target shape, compatible with the shape of `array`
+   * @return view of the given shape that shares data with `array`
+   */
+  template<typename T>
+  ndarray<T> broadcast_view(const ndarray<T> &array, const shape_t &shape) {
+    if (array.shape() == shape) {
+      return array;
+    }
+    if (array.dim() > shape.size()) {
+      throw std::runtime_error("Array of shape " + detail::shape_string(array.shape()) +
+                               " cannot be broadcast to shape " + detail::shape_string(shape) + ".");
+    }
+    size_t lead = shape.size() - array.dim();
+    shape_t strides(shape.size(), 0);
+    for (size_t k = 0; k < array.dim(); ++k) {
+      if (array.shape()[k] == shape[lead + k]) {
+        strides[lead + k] = array.strides()[k];
+      } else if (array.shape()[k] != 1) {
+        throw std::runtime_error("Array of shape " + detail::shape_string(array.shape()) +
+                                 " cannot be broadcast to shape " + detail::shape_string(shape) + ".");
+      }
+    }
+    return ndarray<T>(array, shape, strides, array.offset());
+  }
+
+  namespace detail {
+
+    /**
+     * Memory spanned by the elements of an array: addresses of the lowest byte, of the byte past the highest element
+     * and of the first element, and strides in bytes. Used to detect operands of in-place operations that overlap
+     * with the destination.
+     */
+    struct memory_extent {
+      uintptr_t begin;
+      uintptr_t end;
+      uintptr_t first;
+      shape_t strides;
+    };
+
+    template<typename T>
+    memory_extent extent_of(const ndarray<T> &array) {
+      uintptr_t first = reinterpret_cast<uintptr_t>(array.data().get() + array.offset());
+      memory_extent extent{first, first, first, shape_t(array.dim())};
+      if (array.size() == 0) {
+        return extent;
+      }
+      std::ptrdiff_t low = 0, high = 0;
+      for (size_t k = 0; k < array.dim(); ++k) {
+        std::ptrdiff_t step = std::ptrdiff_t(array.strides()[k]) * std::ptrdiff_t(array.shape()[k] - 1);
+        (step < 0 ? low : high) += step;
+        extent.strides[k] = array.strides()[k] * sizeof(T);
+      }
+      extent.begin = first + uintptr_t(low * std::ptrdiff_t(sizeof(T)));
+      extent.end = first + uintptr_t((high + 1) * std::ptrdiff_t(sizeof(T)));
+      return extent;
+    }
+
+    /**
+     * Check whether an operand read by an elementwise in-place operation may see elements of the destination `out`
+     * that are already updated, i.e. whether they overlap without referring to the same elements in the same order.
+     * Both extents are for the shape of the destination.
+     */
+    inline bool overlaps(const memory_extent &out, const memory_extent &in) {
+      if (out.begin == out.end || in.begin == in.end || out.end <= in.begin || in.end <= out.begin) {
+        return false;
+      }
+      return in.first != out.first || in.strides != out.strides;
+    }
+
+    /**
+     * Operand of an in-place operation on `first`: the operand itself, or its copy when it overlaps with `first`,
+     * so that the result does not depend on the order of evaluation, the instruction set or the number of threads.
+     */
+    template<typename T1, typename T2>
+    ndarray<const T2> unaliased(const ndarray<T1> &first, const ndarray<const T2> &second) {
+      if (overlaps(extent_of(first), extent_of(second))) {
+        return second.copy();
+      }
+      return second;
+    }
+
+  }
 
   // inplace operators
 
   template<typename T1, typename T2>
   typename std::enable_if<std::is_convertible<T2, T1>::value, ndarray < T1> >::type &
-  operator+=(ndarray <T1> &first, const ndarray <T2> &second) {
+  operator+=(ndarray <T1> &first, const ndarray <T2> &second_operand) {
     using result_t = decltype(T1{} + T2{});
-#ifndef NDEBUG
-    if (!std::equal(first.shape().begin(), first.shape().end(), second.shape().begin())) {
-      throw std::runtime_error("Arrays size is miss matched.");
-    }
-#endif
-    std::transform(first.begin(), first.end(),
-                   second.begin(),
-                   first.begin(), [&](const T1 f, const T2 s) {
-          return result_t(f) + result_t(s);
+    ndarray<const T2> second = detail::unaliased(first, broadcast_view(ndarray<const T2>(second_operand),
+                                                                            first.shape()));
+    if (first.is_contiguous() && second.is_contiguous()) {
+      T1 *out = first.begin();
+      const T2 *in = second.begin();
+      if (!detail::simd_apply(detail::simd::add_tag(), out, out, in, first.size())) {
+        detail::parallel_for(first.size(), sizeof(T1), [out, in](size_t begin, size_t end) {
+          std::transform(out + begin, out + end, in + begin, out + begin, [](const T1 f, const T2 s) {
+            return result_t(f) + result_t(s);
+          });
         });
+      }
+    } else {
+      detail::parallel_strided_for_each(first.shape(), first.data().get() + first.offset(), first.strides(),
+                               second.data().get() + second.offset(), second.strides(), [](T1 &f, const T2 &s) {
+            f = result_t(f) + result_t(s);
+          });
+    }
     return first;
   }
 
   template<typename T1, typename T2>
   typename std::enable_if<std::is_convertible<T2, T1>::value, ndarray < T1> >::type &
-  operator-=(ndarray <T1> &first, const ndarray <T2> &second) {
+  operator-=(ndarray <T1> &first, const ndarray <T2> &second_operand) {
     using result_t = decltype(T1{} - T2{});
-#ifndef NDEBUG
-    if (!std::equal(first.shape().begin(), first.shape().end(), second.shape().begin())) {
-      throw std::runtime_error("Arrays size is miss matched.");
-    }
-#endif
-    std::transform(first.begin(), first.end(),
-                   second.begin(),
-                   first.begin(), [&](const T1 f, const T2 s) {
-          return result_t(f) - result_t(s);
+    ndarray<const T2> second = detail::unaliased(first, broadcast_view(ndarray<const T2>(second_operand),
+                                                                            first.shape()));
+    if (first.is_contiguous() && second.is_contiguous()) {
+      T1 *out = first.begin();
+      const T2 *in = second.begin();
+      if (!detail::simd_apply(detail::simd::sub_tag(), out, out, in, first.size())) {
+        detail::parallel_for(first.size(), sizeof(T1), [out, in](size_t begin, size_t end) {
+          std::transform(out + begin, out + end, in + begin, out + begin, [](const T1 f, const T2 s) {
+            return result_t(f) - result_t(s);
+          });
         });
+      }
+    } else {
+      detail::parallel_strided_for_each(first.shape(), first.data().get() + first.offset(), first.strides(),
+                               second.data().get() + second.offset(), second.strides(), [](T1 &f, const T2 &s) {
+            f = result_t(f) - result_t(s);
+          });
+    }
     return first;
   }
 
-  // Binary operations with tensors
-  template<typename T1, typename T2>
-  ndarray<decltype(T1{} + T2{})> operator+(const ndarray <T1> &first, const ndarray <T2> &second) {
-    using result_t = decltype(T1{} + T2{});
-#ifndef NDEBUG
-    if (!std::equal(first.shape().begin(), first.shape().end(), second.shape().begin())) {
-      throw std::runtime_error("Arrays size is miss matched.");
+  namespace detail {
+
+    /**
+     * Type of a factor of `R` converted from `T`: complex only if `T` is complex, so that real factors scale
+     * complex numbers componentwise
+     */
+    template<typename R, typename T>
+    using factor_type = typename std::conditional<is_complex<T>::value, R, typename real_type<R>::type>::type;
+
+    /**
+     * Product `x` that the compiler cannot contract with a following addition into a fused multiply-add, so that
+     * fallback loops of `axpy` and `axpby` round like the SIMD kernels regardless of -ffp-contract and -march
+     */
+    template<typename T>
+    T uncontracted(const T &x) {
+      return x;
+    }
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    inline float uncontracted(float x) {
+      __asm__("" : "+x"(x));
+      return x;
+    }
+
+    inline double uncontracted(double x) {
+      __asm__("" : "+x"(x));
+      return x;
+    }
+#elif defined(__GNUC__) && defined(__aarch64__)
+    inline float uncontracted(float x) {
+      __asm__("" : "+w"(x));
+      return x;
+    }
+
+    inline double uncontracted(double x) {
+      __asm__("" : "+w"(x));
+      return x;
     }
 #endif
-    ndarray<result_t> result(first.shape());
-    std::transform(first.begin(), first.end(),
-                   second.begin(),
-                   result.begin(), [&](const T1 f, const T2 s) {
-          return result_t(f) + result_t(s);
-        });
-    return result;
-  };
 
+    template<typename F>
+    std::complex<F> uncontracted(const std::complex<F> &x) {
+      return std::complex<F>(uncontracted(x.real()), uncontracted(x.imag()));
+    }
+
+    template<typename R, typename A, typename B>
+    R apply_factor(simd::mul_tag, const A &a, const B &b) {
+      return R(a) * factor_type<R, B>(b);
+    }
+
+    template<typename R, typename A, typename B>
+    R apply_factor(simd::div_tag, const A &a, const B &b) {
+      return R(a) / factor_type<R, B>(b);
+    }
+
+    /**
+     * Elementwise `first[i] = first[i] op second[i]` computed in the product type of `T1` and `T2`
+     *
+     * @param op - `simd::mul_tag` or `simd::div_tag`
+     */
+    template<typename Op, typename T1, typename T2>
+    ndarray<T1> &multiply_inplace(Op op, ndarray<T1> &first, const ndarray<T2> &second_operand) {
+      using result_t = typename product_type<T1, T2>::type;
+      ndarray<const T2> second = unaliased(first, broadcast_view(ndarray<const T2>(second_operand), first.shape()));
+      if (first.is_contiguous() && second.is_contiguous()) {
+        T1 *out = first.begin();
+        const T2 *in = second.begin();
+        if (!simd_apply_real(op, out, out, in, first.size())) {
+          parallel_for(first.size(), sizeof(T1), [op, out, in](size_t begin, size_t end) {
+            std::transform(out + begin, out + end, in + begin, out + begin, [op](const T1 f, const T2 s) {
+              return T1(apply_factor<result_t>(op, f, s));
+            });
+          });
+        }
+      } else {
+        parallel_strided_for_each(first.shape(), first.data().get() + first.offset(), first.strides(),
+                                  second.data().get() + second.offset(), second.strides(), [op](T1 &f, const T2 &s) {
+              f = T1(apply_factor<result_t>(op, f, s));
+            });
+      }
+      return first;
+    }
+
+    /**
+     * `array[i] = array[i] op factor` with the factor converted to `factor_type<R, S>`. Real factors of the same
+     * precision as the array are applied by SIMD kernels.
+     *
+     * @param op - `simd::mul_tag` or `simd::div_tag`
+     */
+    template<typename R, typename Op, typename T, typename S>
+    ndarray<T> &scale_inplace(Op op, ndarray<T> &array, const S &factor) {
+      const factor_type<R, S> s(factor);
+      if (array.is_contiguous()) {
+        T *out = array.begin();
+        if (!simd_scale(op, out, out, s, array.size())) {
+          parallel_for(array.size(), sizeof(T), [op, out, s](size_t begin, size_t end) {
+            std::transform(out + begin, out + end, out + begin, [op, s](const T f) {
+              return T(apply_factor<R>(op, f, s));
+            });
+          });
+        }
+      } else {
+        parallel_strided_for_each(array.shape(), array.data().get() + array.offset(), array.strides(),
+                                  [op, s](T &f) { f = T(apply_factor<R>(op, f, s)); });
+      }
+      return array;
+    }
+  }
 
   template<typename T1, typename T2>
-  ndarray<decltype(T1{} - T2{})> operator-(const ndarray <T1> &first, const ndarray <T2> &second) {
-    using result_t = decltype(T1{} - T2{});
-#ifndef NDEBUG
-    if (!std::equal(first.shape().begin(), first.shape().end(), second.shape().begin())) {
-      throw std::runtime_error("Arrays size is miss matched.");
+  typename std::enable_if<std::is_convertible<T2, T1>::value, ndarray < T1> >::type &
+  operator*=(ndarray <T1> &first, const ndarray <T2> &second_operand) {
+    return detail::multiply_inplace(detail::simd::mul_tag(), first, second_operand);
+  }
+
+  template<typename T1, typename T2>
+  typename std::enable_if<std::is_convertible<T2, T1>::value, ndarray < T1> >::type &
+  operator/=(ndarray <T1> &first, const ndarray <T2> &second_operand) {
+    return detail::multiply_inplace(detail::simd::div_tag(), first, second_operand);
+  }
+
+  /**
+   * Multiply every element by a scalar in place. As for `array * value` the product is computed
+   * in the product type of the element and the scalar.
+   */
+  template<typename T, typename S>
+  typename std::enable_if<is_scalar<S>::value && std::is_convertible<S, T>::value, ndarray<T> >::type &
+  operator*=(ndarray<T> &array, const S &value) {
+    return detail::scale_inplace<typename detail::product_type<T, S>::type>(detail::simd::mul_tag(), array, value);
+  }
+
+  template<typename T, typename S>
+  typename std::enable_if<is_scalar<S>::value && std::is_convertible<S, T>::value, ndarray<T> >::type &
+  operator/=(ndarray<T> &array, const S &value) {
+    return detail::scale_inplace<typename detail::product_type<T, S>::type>(detail::simd::div_tag(), array, value);
+  }
+
+  /**
+   * Scale array in place, `y = alpha * y`. Unlike `operator*=`, `alpha` is converted to the precision of `y`.
+   *
+   * @param alpha - scaling factor
+   * @param y - array to scale
+   */
+  template<typename S, typename T>
+  typename std::enable_if<std::is_convertible<S, T>::value>::type scale(const S &alpha, ndarray<T> &y) {
+    detail::scale_inplace<T>(detail::simd::mul_tag(), y, alpha);
+  }
+
+  /**
+   * Fused `y = y + alpha * x` in a single pass over memory. `x` is broadcast to the shape of `y`, the sum is computed
+   * in the type of `x[i] + y[i]` and `alpha` is converted to its precision.
+   *
+   * @param alpha - factor of `x`
+   * @param x - array to add
+   * @param y - array to update
+   */
+  template<typename S, typename T1, typename T2>
+  typename std::enable_if<std::is_convertible<T1, T2>::value>::type
+  axpy(const S &alpha, const ndarray<T1> &x, ndarray<T2> &y) {
+    using result_t = typename detail::product_type<T2, T1>::type;
+    const detail::factor_type<result_t, S> a(alpha);
+    ndarray<const T1> xb = detail::unaliased(y, broadcast_view(ndarray<const T1>(x), y.shape()));
+    if (y.is_contiguous() && xb.is_contiguous()) {
+      T2 *out = y.begin();
+      const T1 *in = xb.begin();
+      if (!detail::simd_axpy(a, in, out, y.size())) {
+        detail::parallel_for(y.size(), sizeof(T2), [a, out, in](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            out[i] = T2(result_t(out[i]) + detail::uncontracted(a * result_t(in[i])));
+          }
+        });
+      }
+    } else {
+      detail::parallel_strided_for_each(y.shape(), y.data().get() + y.offset(), y.strides(),
+                                        xb.data().get() + xb.offset(), xb.strides(), [a](T2 &f, const T1 &s) {
+            f = T2(result_t(f) + detail::uncontracted(a * result_t(s)));
+          });
     }
-#endif
-    ndarray<result_t> result(first.shape());
-    std::transform(first.begin(), first.end(),
-                   second.begin(),
-                   result.begin(), [&](const T1 f, const T2 s) {
-          return result_t(f) - result_t(s);
+  }
+
+  /**
+   * Fused `y = alpha * x + beta * y` in a single pass over memory, with the same conversions as in `axpy`
+   *
+   * @param alpha - factor of `x`
+   * @param x - array to add
+   * @param beta - factor of `y`
+   * @param y - array to update
+   */
+  template<typename S1, typename T1, typename S2, typename T2>
+  typename std::enable_if<std::is_convertible<T1, T2>::value>::type
+  axpby(const S1 &alpha, const ndarray<T1> &x, const S2 &beta, ndarray<T2> &y) {
+    using result_t = typename detail::product_type<T2, T1>::type;
+    const detail::factor_type<result_t, S1> a(alpha);
+    const detail::factor_type<result_t, S2> b(beta);
+    ndarray<const T1> xb = detail::unaliased(y, broadcast_view(ndarray<const T1>(x), y.shape()));
+    if (y.is_contiguous() && xb.is_contiguous()) {
+      T2 *out = y.begin();
+      const T1 *in = xb.begin();
+      if (!detail::simd_axpby(a, in, b, out, y.size())) {
+        detail::parallel_for(y.size(), sizeof(T2), [a, b, out, in](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            out[i] = T2(detail::uncontracted(a * result_t(in[i])) + detail::uncontracted(b * result_t(out[i])));
+          }
         });
-    return result;
+      }
+    } else {
+      detail::parallel_strided_for_each(y.shape(), y.data().get() + y.offset(), y.strides(),
+                                        xb.data().get() + xb.offset(), xb.strides(), [a, b](T2 &f, const T1 &s) {
+            f = T2(detail::uncontracted(a * result_t(s)) + detail::uncontracted(b * result_t(f)));
+          });
+    }
+  }
+
+  namespace detail {
+
+    /**
+     * Leaf of an expression tree that refers to data of an existing ndarray
+     */
+    template<typename T>
+    struct array_operand {
+      using value_type = typename std::remove_const<T>::type;
+
+      explicit array_operand(const ndarray<T> &array) : array_(array), data_(array.data().get() + array.offset()),
+                                                        row_(data_), step_(0) {}
+
+      /**
+       * Stretch the operand to `shape` of the whole expression with a stride-0 view
+       */
+      void broadcast(const shape_t &shape) {
+        array_ = broadcast_view(array_, shape);
+      }
+
+      const shape_t &shape() const {
+        return array_.shape();
+      }
+
+      bool contiguous() const {
+        return array_.is_contiguous();
+      }
+
+      value_type operator[](size_t i) const {
+        return data_[i];
+      }
+
+      /**
+       * Move to the row at `index` (leading indices, all but the innermost one) for the strided walk
+       */
+      void seek(const size_t *index) const {
+        const shape_t &strides = array_.strides();
+        size_t inner = strides.size() - 1;
+        size_t offset = 0;
+        for (size_t k = 0; k < inner; ++k) {
+          offset += index[k] * strides[k];
+        }
+        row_ = data_ + std::ptrdiff_t(offset);
+        step_ = std::ptrdiff_t(strides[inner]);
+      }
+
+      value_type eval(size_t j) const {
+        return row_[std::ptrdiff_t(j) * step_];
+      }
+
+      /**
+       * Pointer to the first element of the referred array
+       */
+      const T *data() const {
+        return data_;
+      }
+
+      /**
+       * Check whether the operand overlaps with the destination `out` of an in-place operation, see `detail::overlaps`
+       */
+      bool overlaps(const memory_extent &out) const {
+        return detail::overlaps(out, extent_of(array_));
+      }
+
+    private:
+      ndarray<T> array_;
+      const T *data_;
+      mutable const T *row_;
+      mutable std::ptrdiff_t step_;
+    };
+
+    /**
+     * Maps an operand of arithmetic operator to the type stored in expression tree:
+     * ndarrays are stored as `array_operand`, nested expressions are stored by value.
+     */
+    template<typename E>
+    struct operand {
+      using type = E;
+
+      static const E &wrap(const E &e) {
+        return e;
+      }
+    };
+
+    template<typename T>
+    struct operand<ndarray<T> > {
+      using type = array_operand<T>;
+
+      static type wrap(const ndarray<T> &array) {
+        return type(array);
+      }
+    };
+
+    template<typename T>
+    struct operand<ndarray_view<T> > {
+      using type = array_operand<T>;
+
+      static type wrap(const ndarray_view<T> &view) {
+        return type(view.unowned_array());
+      }
+    };
+
+    template<typename E>
+    struct is_operand : std::is_base_of<ndarray_expression<E>, E> {
+    };
+
+    template<typename T>
+    struct is_operand<ndarray<T> > : std::true_type {
+    };
+
+    template<typename T>
+    struct is_operand<ndarray_view<T> > : std::true_type {
+    };
+
+    struct plus_op {
+      template<typename A, typename B>
+      using result = decltype(A{} + B{});
+
+      template<typename R, typename A, typename B>
+      static R apply(const A &a, const B &b) {
+        return R(a) + R(b);
+      }
+    };
+
+    struct minus_op {
+      template<typename A, typename B>
+      using result = decltype(A{} - B{});
+
+      template<typename R, typename A, typename B>
+      static R apply(const A &a, const B &b) {
+        return R(a) - R(b);
+      }
+    };
+
+    template<typename Op>
+    struct simd_op;
+
+    template<>
+    struct simd_op<plus_op> {
+      using type = simd::add_tag;
+    };
+
+    template<>
+    struct simd_op<minus_op> {
+      using type = simd::sub_tag;
+    };
+
+    /**
+     * Evaluate a binary operation over two contiguous operands into dense `out` with SIMD kernels.
+     * Only leaves that refer to ndarrays are supported, nested expressions are evaluated elementwise.
+     *
+     * @return false if the operation has to be evaluated elementwise
+     */
+    template<typename Op, typename T, typename L, typename R>
+    bool simd_assign(T *, size_t, const L &, const R &) {
+      return false;
+    }
+
+    template<typename Op, typename T, typename A, typename B>
+    bool simd_assign(T *out, size_t size, const array_operand<A> &lhs, const array_operand<B> &rhs) {
+      return simd_apply(typename simd_op<Op>::type(), out, lhs.data(), rhs.data(), size);
+    }
+
+    template<typename Op, typename T, typename L, typename S>
+    bool simd_assign_scalar(T *, size_t, const L &, S) {
+      return false;
+    }
+
+    template<typename Op, typename T, typename A, typename S>
+    bool simd_assign_scalar(T *out, size_t size, const array_operand<A> &lhs, S rhs) {
+      return simd_apply_scalar(typename simd_op<Op>::type(), out, lhs.data(), rhs, size);
+    }
+
+    /**
+     * Elementwise binary operation over two expressions with broadcasting of their shapes
+     */
+    template<typename Op, typename L, typename R>
+    struct binary_expression : ndarray_expression<binary_expression<Op, L, R> > {
+      using value_type = typename Op::template result<typename L::value_type, typename R::value_type>;
+
+      binary_expression(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {
+        broadcast(broadcast_shape(lhs_.shape(), rhs_.shape()));
+      }
+
+      void broadcast(const shape_t &shape) {
+        if (shape != shape_) {
+          shape_ = shape;
+          lhs_.broadcast(shape);
+          rhs_.broadcast(shape);
+        }
+      }
+
+      const shape_t &shape() const {
+        return shape_;
+      }
+
+      bool contiguous() const {
+        return lhs_.contiguous() && rhs_.contiguous();
+      }
+
+      value_type operator[](size_t i) const {
+        return Op::template apply<value_type>(lhs_[i], rhs_[i]);
+      }
+
+      void seek(const size_t *index) const {
+        lhs_.seek(index);
+        rhs_.seek(index);
+      }
+
+      value_type eval(size_t j) const {
+        return Op::template apply<value_type>(lhs_.eval(j), rhs_.eval(j));
+      }
+
+      template<typename T>
+      bool assign_dense(T *out, size_t size) const {
+        return std::is_same<T, value_type>::value && contiguous() && simd_assign<Op>(out, size, lhs_, rhs_);
+      }
+
+      bool overlaps(const memory_extent &out) const {
+        return lhs_.overlaps(out) || rhs_.overlaps(out);
+      }
+
+    private:
+      L lhs_;
+      R rhs_;
+      shape_t shape_;
+    };
+
+    /**
+     * Elementwise binary operation between an expression and a scalar
+     */
+    template<typename Op, typename L, typename S>
+    struct scalar_expression : ndarray_expression<scalar_expression<Op, L, S> > {
+      using value_type = typename Op::template result<typename L::value_type, S>;
+
+      scalar_expression(const L &lhs, S rhs) : lhs_(lhs), rhs_(rhs) {}
+
+      void broadcast(const shape_t &shape) {
+        lhs_.broadcast(shape);
+      }
+
+      const shape_t &shape() const {
+        return lhs_.shape();
+      }
+
+      bool contiguous() const {
+        return lhs_.contiguous();
+      }
+
+      value_type operator[](size_t i) const {
+        return Op::template apply<value_type>(lhs_[i], rhs_);
+      }
+
+      void seek(const size_t *index) const {
+        lhs_.seek(index);
+      }
+
+      value_type eval(size_t j) const {
+        return Op::template apply<value_type>(lhs_.eval(j), rhs_);
+      }
+
+      template<typename T>
+      bool assign_dense(T *out, size_t size) const {
+        return std::is_same<T, value_type>::value && contiguous() && simd_assign_scalar<Op>(out, size, lhs_, rhs_);
+      }
+
+      bool overlaps(const memory_extent &out) const {
+        return lhs_.overlaps(out);
+      }
+
+    private:
+      L lhs_;
+      S rhs_;
+    };
+
+    /**
+     * Elementwise negation of an expression
+     */
+    template<typename L>
+    struct negate_expression : ndarray_expression<negate_expression<L> > {
+      using value_type = typename L::value_type;
+
+      explicit negate_expression(const L &lhs) : lhs_(lhs) {}
+
+      void broadcast(const shape_t &shape) {
+        lhs_.broadcast(shape);
+      }
+
+      const shape_t &shape() const {
+        return lhs_.shape();
+      }
+
+      bool contiguous() const {
+        return lhs_.contiguous();
+      }
+
+      value_type operator[](size_t i) const {
+        return -lhs_[i];
+      }
+
+      void seek(const size_t *index) const {
+        lhs_.seek(index);
+      }
+
+      value_type eval(size_t j) const {
+        return -lhs_.eval(j);
+      }
+
+      bool overlaps(const memory_extent &out) const {
+        return lhs_.overlaps(out);
+      }
+
+    private:
+      L lhs_;
+    };
+
+    template<typename Op, typename L, typename R>
+    using binary_result = typename std::enable_if<is_operand<L>::value && is_operand<R>::value,
+        binary_expression<Op, typename operand<L>::type, typename operand<R>::type> >::type;
+
+    template<typename Op, typename L, typename S>
+    using scalar_result = typename std::enable_if<is_operand<L>::value && is_scalar<S>::value,
+        scalar_expression<Op, typename operand<L>::type, S> >::type;
+  }
+
+  template<typename T1, typename E>
+  typename std::enable_if<std::is_convertible<typename E::value_type, T1>::value, ndarray < T1> >::type &
+  operator+=(ndarray <T1> &first, const ndarray_expression<E> &second) {
+    using result_t = decltype(T1{} + typename E::value_type{});
+    E e(second.self());
+    e.broadcast(detail::broadcast_shape(first.shape(), e.shape()));
+    if (e.shape() != first.shape()) {
+      throw std::runtime_error("Expression of shape " + detail::shape_string(e.shape()) +
+                               " cannot be broadcast to shape " + detail::shape_string(first.shape()) + ".");
+    }
+    if (e.overlaps(detail::extent_of(first))) {
+      // leaves that overlap with the destination are read before any element is updated
+      return first += ndarray<typename E::value_type>(e);
+    }
+    detail::evaluate_expression(first.data().get() + first.offset(), first.strides(), first.is_contiguous(), e,
+                                [](T1 &f, const typename E::value_type &s) { f = result_t(f) + result_t(s); });
+    return first;
+  }
+
+  template<typename T1, typename E>
+  typename std::enable_if<std::is_convertible<typename E::value_type, T1>::value, ndarray < T1> >::type &
+  operator-=(ndarray <T1> &first, const ndarray_expression<E> &second) {
+    using result_t = decltype(T1{} - typename E::value_type{});
+    E e(second.self());
+    e.broadcast(detail::broadcast_shape(first.shape(), e.shape()));
+    if (e.shape() != first.shape()) {
+      throw std::runtime_error("Expression of shape " + detail::shape_string(e.shape()) +
+                               " cannot be broadcast to shape " + detail::shape_string(first.shape()) + ".");
+    }
+    if (e.overlaps(detail::extent_of(first))) {
+      // leaves that overlap with the destination are read before any element is updated
+      return first -= ndarray<typename E::value_type>(e);
+    }
+    detail::evaluate_expression(first.data().get() + first.offset(), first.strides(), first.is_contiguous(), e,
+                                [](T1 &f, const typename E::value_type &s) { f = result_t(f) - result_t(s); });
+    return first;
+  }
+
+  // Binary operations with tensors and expressions. Result is evaluated in a single pass
+  // when assigned to an ndarray. Operands of different shapes are broadcast,
+  // leaf arrays share data with the expression.
+  template<typename L, typename R>
+  detail::binary_result<detail::plus_op, L, R> operator+(const L &first, const R &second) {
+    return detail::binary_result<detail::plus_op, L, R>(detail::operand<L>::wrap(first),
+                                                        detail::operand<R>::wrap(second));
   };
 
+  template<typename L, typename R>
+  detail::binary_result<detail::minus_op, L, R> operator-(const L &first, const R &second) {
+    return detail::binary_result<detail::minus_op, L, R>(detail::operand<L>::wrap(first),
+                                                         detail::operand<R>::wrap(second));
+  };
 
   // Binary operations with scalars
-  template<typename T1, typename T2>
-  typename std::enable_if<is_scalar<T2>::value, ndarray < decltype(T1{} + T2{})> >::type
-  operator+(const ndarray <T1> &first, T2 second) {
-    using result_t = decltype(T1{} + T2{});
-    ndarray<result_t> result(first.shape());
-    std::transform(first.begin(), first.end(), result.begin(), [&](const T1 f) {
-          return result_t(f) + result_t(second);
-        });
-    return result;
+  template<typename L, typename S>
+  detail::scalar_result<detail::plus_op, L, S> operator+(const L &first, S second) {
+    return detail::scalar_result<detail::plus_op, L, S>(detail::operand<L>::wrap(first), second);
   };
 
-  template<typename T1, typename T2>
-  typename std::enable_if<is_scalar<T1>::value, ndarray < decltype(T1{} + T2{})> >::type
-  operator+(T1 first, const ndarray <T2> &second) {
+  template<typename S, typename R>
+  detail::scalar_result<detail::plus_op, R, S> operator+(S first, const R &second) {
     return second + first;
   }
 
-  template<typename T1, typename T2>
-  typename std::enable_if<is_scalar<T2>::value, ndarray < decltype(T1{} - T2{})> >::type
-  operator-(const ndarray <T1> &first, T2 second) {
-    using result_t = decltype(T1{} - T2{});
-    ndarray<result_t> result(first.shape());
-    std::transform(first.begin(), first.end(),
-                   result.begin(), [&](const T1 f) {
-          return result_t(f) - result_t(second);
-        });
-    return result;
+  template<typename L, typename S>
+  detail::scalar_result<detail::minus_op, L, S> operator-(const L &first, S second) {
+    return detail::scalar_result<detail::minus_op, L, S>(detail::operand<L>::wrap(first), second);
   };
 
-  template<typename T1, typename T2>
-  typename std::enable_if<is_scalar<T1>::value, ndarray < decltype(T1{} - T2{})> >::type
-  operator-(T1 first, const ndarray <T2> &second) {
+  template<typename S, typename R>
+  detail::scalar_result<detail::minus_op, R, S> operator-(S first, const R &second) {
     return second - first;
   }
 
   // Unary operation
 
-  template<typename T1>
-  ndarray<T1> operator-(const ndarray <T1> &first) {
-    ndarray<T1> result(first.shape());
-    std::transform(first.begin(), first.end(),
-                   result.begin(), [&](const T1 f) {return -f;});
-    return result;
+  template<typename L>
+  typename std::enable_if<detail::is_operand<L>::value, detail::negate_expression<typename detail::operand<L>::type> >::type
+  operator-(const L &first) {
+    return detail::negate_expression<typename detail::operand<L>::type>(detail::operand<L>::wrap(first));
   };
 
   // Comparisons
@@ -165,55 +937,573 @@ namespace ndarray {
       throw std::runtime_error("Arrays size is miss matched.");
     }
 #endif
-    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](T1 l, T2 r) {
-      return std::abs(result_t(l) - result_t(r))< 1e-12;
-    });
+    if (lhs.is_contiguous() && rhs.is_contiguous()) {
+      return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](T1 l, T2 r) {
+        return std::abs(result_t(l) - result_t(r))< 1e-12;
+      });
+    }
+    bool equal = true;
+    detail::strided_for_each(lhs.shape(), lhs.data().get() + lhs.offset(), lhs.strides(),
+                             rhs.data().get() + rhs.offset(), rhs.strides(), [&equal](const T1 &l, const T2 &r) {
+          equal = equal && std::abs(result_t(l) - result_t(r)) < 1e-12;
+        });
+    return equal;
   };
 
 
+  namespace detail {
+
+    /**
+     * Parse transpose pattern of the form "ijk->kji" into a permutation, where i-th source axis is moved to
+     * position `pattern[i]` of the result.
+     *
+     * @param string_pattern - transpose pattern
+     * @param dim - dimension of an array to be transposed
+     * @return permutation of axes
+     */
+    inline std::vector<size_t> transpose_pattern(const std::string &string_pattern, size_t dim) {
+      size_t find = string_pattern.find("->");
+      if (find == std::string::npos) {
+        throw std::runtime_error("Incorrect transpose_impl pattern.");
+      }
+      std::string from = trim(string_pattern.substr(0, find));
+      std::string to = trim(string_pattern.substr(find + 2, string_pattern.size() - 1));
+
+      if (from.length() != to.length()) {
+        throw std::runtime_error("Transpose source and target indices have different size.");
+      }
+      if (from.length() != dim) {
+        throw std::runtime_error("Number of transpose_impl indices and array dimension are different size.");
+      }
+      if((!all_latin(from)) || (!all_latin(to))) {
+        throw std::runtime_error("Transpose indices should be latin letters.");
+      }
+
+#ifndef NDEBUG
+      for(const auto & s1 : from) {
+        bool in = false;
+        for(const auto & s2 : to) {
+          if(s1 == s2) {
+            in = true;
+            break;
+          }
+        }
+        if(!in) {
+          throw std::runtime_error("Some LHS transpose indices are not found in RHS transpose_impl indices.");
+        }
+      }
+#endif
+
+      std::map<char, size_t> index_map;
+      for (size_t i = 0; i < to.length(); ++i) {
+        index_map[to[i]] = i;
+      }
+      std::vector<size_t> pattern(to.length());
+      for (size_t j = 0; j < from.length(); ++j) {
+        pattern[j] = index_map[from[j]];
+      }
+      return pattern;
+    }
+
+  }
+
+  /**
+   * Permuted view of an array that shares data with the original one. No data is moved. The view may be used
+   * as an operand of an in-place operation on the original array, e.g. `a += permute_view(a, {1, 0})`:
+   * overlapping operands are copied before the destination is updated.
+   *
+   * @param array - array to be permuted
+   * @param pattern - permutation of axes, i-th axis of `array` becomes `pattern[i]`-th axis of the view
+   * @return view with permuted shape and strides
+   */
   template<typename T>
-  ndarray<T> transpose(const ndarray<T>& array, const std::string &string_pattern) {
-    size_t find = string_pattern.find("->");
-    if (find == std::string::npos) {
-      throw std::runtime_error("Incorrect transpose_impl pattern.");
+  ndarray<T> permute_view(const ndarray<T>& array, const std::vector<size_t> &pattern) {
+    if (pattern.size() != array.dim()) {
+      throw std::runtime_error("Number of transpose_impl indices and array dimension are different size.");
+    }
+    shape_t shape(array.dim());
+    shape_t strides(array.dim());
+    std::vector<bool> used(array.dim(), false);
+    for (size_t i(0); i < array.dim(); ++i) {
+      if (pattern[i] >= array.dim() || used[pattern[i]]) {
+        throw std::runtime_error("Transpose pattern is not a permutation.");
+      }
+      used[pattern[i]] = true;
+      shape[pattern[i]] = array.shape()[i];
+      strides[pattern[i]] = array.strides()[i];
     }
-    std::string from = trim(string_pattern.substr(0, find));
-    std::string to = trim(string_pattern.substr(find + 2, string_pattern.size() - 1));
+    return ndarray<T>(array, shape, strides, array.offset());
+  }
 
-    if (from.length() != to.length()) {
-      throw std::runtime_error("Transpose source and target indices have different size.");
+  /**
+   * Precompiled transpose of arrays with a fixed shape and strides. The pattern is parsed and validated once,
+   * the permutation, the fused layout of the copy and the tiled dimensions are computed in the constructor,
+   * so that `execute` on a preallocated destination does no parsing and no allocation. Arrays with the same
+   * layout but different data or offset, e.g. blocks of a larger array, can share one plan.
+   */
+  class transpose_plan {
+  public:
+    /**
+     * @param pattern - transpose pattern, e.g. "ijk->kji"
+     * @param shape - shape of the source arrays
+     * @param strides - strides of the source arrays
+     */
+    transpose_plan(const std::string &pattern, const shape_t &shape, const shape_t &strides) :
+        permutation_(detail::transpose_pattern(pattern, shape.size())), source_shape_(shape),
+        source_strides_(strides), shape_(shape.size()) {
+      shape_t src_strides(shape.size());
+      std::vector<bool> used(shape.size(), false);
+      for (size_t i = 0; i < shape.size(); ++i) {
+        if (permutation_[i] >= shape.size() || used[permutation_[i]]) {
+          throw std::runtime_error("Transpose pattern is not a permutation.");
+        }
+        used[permutation_[i]] = true;
+        shape_[permutation_[i]] = shape[i];
+        src_strides[permutation_[i]] = strides[i];
+      }
+      layout_ = detail::make_transpose_layout(shape_, src_strides);
     }
-    if (from.length() != array.dim()) {
-      throw std::runtime_error("Number of transpose_impl indices and array dimension are different size.");
+
+    /**
+     * @return permutation of axes, i-th source axis becomes `permutation()[i]`-th axis of the result
+     */
+    const std::vector<size_t> &permutation() const {
+      return permutation_;
     }
-    if((!all_latin(from)) || (!all_latin(to))) {
-      throw std::runtime_error("Transpose indices should be latin letters.");
+
+    /**
+     * @return shape of the transposed array
+     */
+    const shape_t &shape() const {
+      return shape_;
     }
 
-#ifndef NDEBUG
-    for(const auto & s1 : from) {
-      bool in = false;
-      for(const auto & s2 : to) {
-        if(s1 == s2) {
-          in = true;
-          break;
+    /**
+     * Transpose `array` into a newly allocated dense array.
+     */
+    template<typename T>
+    ndarray<typename std::remove_const<T>::type> execute(const ndarray<T> &array) const {
+      ndarray<typename std::remove_const<T>::type> result(uninitialized, shape_);
+      execute(array, result);
+      return result;
+    }
+
+    /**
+     * Transpose `array` into preallocated dense array `out` of shape `shape()`.
+     */
+    template<typename T>
+    void execute(const ndarray<T> &array, ndarray<typename std::remove_const<T>::type> &out) const {
+      if (array.shape() != source_shape_ || array.strides() != source_strides_) {
+        throw std::runtime_error("Array layout does not match transpose plan.");
+      }
+      if (out.shape() != shape_ || !out.is_contiguous()) {
+        throw std::runtime_error("Transpose destination should be a dense array of the transposed shape.");
+      }
+      execute(array.data().get() + array.offset(), out.data().get() + out.offset());
+    }
+
+    /**
+     * Transpose raw data laid out as described by the plan into dense `dst`.
+     *
+     * @param src - pointer to the first element of the source
+     * @param dst - pointer to the first element of the dense destination
+     */
+    template<typename T>
+    void execute(const T *src, T *dst) const {
+      if (get_num_threads() <= 1 || layout_.size * sizeof(T) < get_parallel_threshold()) {
+        detail::transpose_execute(layout_, src, dst);
+        return;
+      }
+      // threads copy blocks of the fused destination with the precomputed strides
+      const detail::transpose_layout &layout = layout_;
+      detail::parallel_blocks(layout.shape, sizeof(T), [&layout, src, dst](const shape_type &first,
+                                                                           const shape_type &block) {
+        std::ptrdiff_t src_offset = 0;
+        std::ptrdiff_t dst_offset = 0;
+        for (size_t k = 0; k < first.size(); ++k) {
+          src_offset += std::ptrdiff_t(first[k]) * layout.src_strides[k];
+          dst_offset += std::ptrdiff_t(first[k]) * layout.dst_strides[k];
         }
+        detail::transpose_execute(detail::block_layout(layout, block), src + src_offset, dst + dst_offset);
+      });
+    }
+
+  private:
+    using shape_type = decltype(detail::transpose_layout::shape);
+
+    std::vector<size_t> permutation_;
+    shape_t source_shape_;
+    shape_t source_strides_;
+    shape_t shape_;
+    detail::transpose_layout layout_;
+  };
+
+  namespace detail {
+
+    inline plan_cache<transpose_plan> &transpose_plans() {
+      static plan_cache<transpose_plan> cache;
+      return cache;
+    }
+
+  }
+
+  /**
+   * Transpose plan for `pattern` and the layout of `array` from a global thread-safe cache. The plan is built on
+   * the first request and reused afterwards. Hot loops, such as thousands of transposes of equally shaped blocks,
+   * should get the plan once, hold on to it and call `execute` directly, which skips the lookup.
+   *
+   * @param pattern - transpose pattern
+   * @param array - array with the layout of the source arrays
+   * @return shared plan
+   */
+  template<typename T>
+  std::shared_ptr<const transpose_plan> get_transpose_plan(const std::string &pattern, const ndarray<T> &array) {
+    detail::plan_layout layout(array.shape().begin(), array.shape().end());
+    layout.insert(layout.end(), array.strides().begin(), array.strides().end());
+    return detail::transpose_plans().get(pattern, layout, [&]() {
+      return transpose_plan(pattern, array.shape(), array.strides());
+    });
+  }
+
+  /**
+   * Transposed view of an array that shares data with the original one, e.g. `transpose_view(a, "ijk->kji")`.
+   * Use `contiguous()` on the result to get a dense array when needed. In-place operations such as
+   * `a += transpose_view(a, "ij->ji")` copy the view first, since it overlaps with the destination.
+   *
+   * @param array - array to be transposed
+   * @param string_pattern - transpose pattern
+   * @return view with permuted shape and strides
+   */
+  template<typename T>
+  ndarray<T> transpose_view(const ndarray<T>& array, const std::string &string_pattern) {
+    return permute_view(array, get_transpose_plan(string_pattern, array)->permutation());
+  }
+
+  /**
+   * Transpose an array into a newly allocated dense array, e.g. `transpose(a, "ijk->kji")`.
+   *
+   * @param array - array to be transposed
+   * @param string_pattern - transpose pattern
+   * @return transposed array
+   */
+  template<typename T>
+  ndarray<T> transpose(const ndarray<T>& array, const std::string &string_pattern) {
+    return get_transpose_plan(string_pattern, array)->execute(array);
+  }
+
+  /**
+   * Matrix product with NumPy `matmul` semantics. 2D operands are multiplied as matrices. Operands with more
+   * dimensions are stacks of matrices in the last two dimensions, with the leading dimensions broadcast.
+   * A 1D first (second) operand is a row (column) vector, and the corresponding dimension is removed from the result.
+   * Operands whose strides describe row-major or transposed matrices are used without copying.
+   *
+   * @param a, b - operands
+   * @return newly allocated dense array
+   */
+  template<typename T1, typename T2>
+  ndarray<typename detail::product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type>
+  matmul(const ndarray<T1> &a, const ndarray<T2> &b) {
+    using R = typename detail::product_type<typename std::remove_const<T1>::type,
+                                            typename std::remove_const<T2>::type>::type;
+    if (a.dim() == 0 || b.dim() == 0) {
+      throw std::runtime_error("Operands of matmul should have at least one dimension.");
+    }
+    ndarray<R> x = detail::cast_array<R>(a);
+    ndarray<R> y = detail::cast_array<R>(b);
+    bool row_vector = x.dim() == 1;
+    bool column_vector = y.dim() == 1;
+    if (row_vector) {
+      x = ndarray<R>(x, shape_t{1, x.shape()[0]}, shape_t{x.shape()[0] * x.strides()[0], x.strides()[0]}, x.offset());
+    }
+    if (column_vector) {
+      y = ndarray<R>(y, shape_t{y.shape()[0], 1}, shape_t{y.strides()[0], 1}, y.offset());
+    }
+    size_t m = x.shape()[x.dim() - 2];
+    size_t k = x.shape()[x.dim() - 1];
+    size_t n = y.shape()[y.dim() - 1];
+    if (y.shape()[y.dim() - 2] != k) {
+      throw std::runtime_error("Arrays of shapes " + detail::shape_string(a.shape()) + " and " +
+                               detail::shape_string(b.shape()) + " cannot be multiplied.");
+    }
+    shape_t batch = detail::broadcast_shape(shape_t(x.shape().begin(), x.shape().end() - 2),
+                                            shape_t(y.shape().begin(), y.shape().end() - 2));
+    shape_t shape_x(batch), shape_y(batch), shape(batch);
+    shape_x.push_back(m);
+    shape_x.push_back(k);
+    shape_y.push_back(k);
+    shape_y.push_back(n);
+    shape.push_back(m);
+    shape.push_back(n);
+    x = broadcast_view(x, shape_x);
+    y = broadcast_view(y, shape_y);
+    ndarray<R> result(uninitialized, shape);
+    size_t count = result.size() / std::max(m * n, size_t(1));
+    size_t rank = batch.size();
+    detail::parallel_for(count, sizeof(R) * m * n * std::max(k, size_t(1)), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        size_t offset_x = x.offset(), offset_y = y.offset();
+        for (size_t d = rank, rest = i; d > 0; --d) {
+          size_t index = rest % batch[d - 1];
+          rest /= batch[d - 1];
+          offset_x += index * x.strides()[d - 1];
+          offset_y += index * y.strides()[d - 1];
+        }
+        ndarray<R> xi(x, shape_t{m, k}, shape_t{x.strides()[rank], x.strides()[rank + 1]}, offset_x);
+        ndarray<R> yi(y, shape_t{k, n}, shape_t{y.strides()[rank], y.strides()[rank + 1]}, offset_y);
+        detail::matrix_product(detail::make_matrix_operand(xi, 1), detail::make_matrix_operand(yi, 1),
+                               result.data().get() + i * m * n);
       }
-      if(!in) {
-        throw std::runtime_error("Some LHS transpose indices are not found in RHS transpose_impl indices.");
+    });
+    if (row_vector || column_vector) {
+      shape_t reduced(batch);
+      if (!row_vector) {
+        reduced.push_back(m);
       }
+      if (!column_vector) {
+        reduced.push_back(n);
+      }
+      result.inplace_reshape(reduced);
     }
-#endif
+    return result;
+  }
 
-    std::map<char, size_t> index_map;
-    for (size_t i = 0; i < to.length(); ++i) {
-      index_map[to[i]] = i;
+  /**
+   * Contraction of `axes_a` of `a` with `axes_b` of `b`, as NumPy `tensordot`. Dimensions of the result are
+   * the remaining dimensions of `a` followed by the remaining dimensions of `b`. The contraction is done by
+   * a single matrix product. Operands are transposed into matrices with strides when possible, otherwise copied.
+   *
+   * @param a, b - operands
+   * @param axes_a, axes_b - contracted axes, `axes_a[i]` of `a` is contracted with `axes_b[i]` of `b`
+   * @return newly allocated dense array
+   */
+  template<typename T1, typename T2>
+  ndarray<typename detail::product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type>
+  tensordot(const ndarray<T1> &a, const ndarray<T2> &b, const std::vector<size_t> &axes_a,
+            const std::vector<size_t> &axes_b) {
+    using R = typename detail::product_type<typename std::remove_const<T1>::type,
+                                            typename std::remove_const<T2>::type>::type;
+    if (axes_a.size() != axes_b.size()) {
+      throw std::runtime_error("Numbers of contracted axes of tensordot operands are different.");
+    }
+    std::vector<bool> contracted_a(a.dim(), false), contracted_b(b.dim(), false);
+    for (size_t i = 0; i < axes_a.size(); ++i) {
+      if (axes_a[i] >= a.dim() || axes_b[i] >= b.dim() || contracted_a[axes_a[i]] || contracted_b[axes_b[i]]) {
+        throw std::runtime_error("Incorrect tensordot axes.");
+      }
+      if (a.shape()[axes_a[i]] != b.shape()[axes_b[i]]) {
+        throw std::runtime_error("Contracted axes of tensordot operands have different extents.");
+      }
+      contracted_a[axes_a[i]] = true;
+      contracted_b[axes_b[i]] = true;
     }
-    std::vector<size_t> pattern(to.length());
-    for (size_t j = 0; j < from.length(); ++j) {
-      pattern[j] = index_map[from[j]];
+    // `a` is permuted to (free, contracted) and `b` to (contracted, free)
+    std::vector<size_t> pattern_a(a.dim()), pattern_b(b.dim());
+    shape_t shape;
+    size_t free_a = 0;
+    for (size_t d = 0; d < a.dim(); ++d) {
+      if (!contracted_a[d]) {
+        shape.push_back(a.shape()[d]);
+        pattern_a[d] = free_a++;
+      }
     }
-    return detail::transpose_impl(array, pattern);
+    for (size_t i = 0; i < axes_a.size(); ++i) {
+      pattern_a[axes_a[i]] = free_a + i;
+      pattern_b[axes_b[i]] = i;
+    }
+    for (size_t d = 0, free_b = 0; d < b.dim(); ++d) {
+      if (!contracted_b[d]) {
+        shape.push_back(b.shape()[d]);
+        pattern_b[d] = axes_b.size() + free_b++;
+      }
+    }
+    detail::matrix_operand<R> x = detail::make_matrix_operand(permute_view(detail::cast_array<R>(a), pattern_a),
+                                                              free_a);
+    detail::matrix_operand<R> y = detail::make_matrix_operand(permute_view(detail::cast_array<R>(b), pattern_b),
+                                                              axes_b.size());
+    ndarray<R> result(uninitialized, shape);
+    detail::matrix_product(x, y, result.data().get());
+    return result;
+  }
+
+  /**
+   * Contraction of the last `axes` dimensions of `a` with the first `axes` dimensions of `b`,
+   * e.g. `tensordot(a, b, 1)` is a matrix product for 2D operands.
+   */
+  template<typename T1, typename T2>
+  ndarray<typename detail::product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type>
+  tensordot(const ndarray<T1> &a, const ndarray<T2> &b, size_t axes) {
+    if (axes > a.dim() || axes > b.dim()) {
+      throw std::runtime_error("Number of contracted axes is larger than array's dimension.");
+    }
+    std::vector<size_t> axes_a(axes), axes_b(axes);
+    for (size_t i = 0; i < axes; ++i) {
+      axes_a[i] = a.dim() - axes + i;
+      axes_b[i] = i;
+    }
+    return tensordot(a, b, axes_a, axes_b);
+  }
+
+  // Overloads for non-owning views. Views are converted into ndarrays that do not own the data, so that neither
+  // the conversion nor the evaluation touches a reference count, and the functions on ndarrays are called.
+
+  template<typename T>
+  ndarray_view<T> broadcast_view(const ndarray_view<T> &view, const shape_t &shape) {
+    return broadcast_view(view.unowned_array(), shape);
+  }
+
+  template<typename T, typename R>
+  typename std::enable_if<!is_scalar<R>::value, const ndarray_view<T> >::type &
+  operator+=(const ndarray_view<T> &first, const R &second) {
+    ndarray<T> array = first.unowned_array();
+    array += detail::view_to_array(second);
+    return first;
+  }
+
+  template<typename T, typename R>
+  typename std::enable_if<!is_scalar<R>::value, const ndarray_view<T> >::type &
+  operator-=(const ndarray_view<T> &first, const R &second) {
+    ndarray<T> array = first.unowned_array();
+    array -= detail::view_to_array(second);
+    return first;
+  }
+
+  template<typename T, typename R>
+  const ndarray_view<T> &operator*=(const ndarray_view<T> &first, const R &second) {
+    ndarray<T> array = first.unowned_array();
+    array *= detail::view_to_array(second);
+    return first;
+  }
+
+  template<typename T, typename R>
+  const ndarray_view<T> &operator/=(const ndarray_view<T> &first, const R &second) {
+    ndarray<T> array = first.unowned_array();
+    array /= detail::view_to_array(second);
+    return first;
+  }
+
+  template<typename T1, typename T2>
+  ndarray<T1> &operator+=(ndarray<T1> &first, const ndarray_view<T2> &second) {
+    return first += second.unowned_array();
+  }
+
+  template<typename T1, typename T2>
+  ndarray<T1> &operator-=(ndarray<T1> &first, const ndarray_view<T2> &second) {
+    return first -= second.unowned_array();
+  }
+
+  template<typename T1, typename T2>
+  ndarray<T1> &operator*=(ndarray<T1> &first, const ndarray_view<T2> &second) {
+    return first *= second.unowned_array();
+  }
+
+  template<typename T1, typename T2>
+  ndarray<T1> &operator/=(ndarray<T1> &first, const ndarray_view<T2> &second) {
+    return first /= second.unowned_array();
+  }
+
+  template<typename S, typename T>
+  void scale(const S &alpha, const ndarray_view<T> &y) {
+    ndarray<T> array = y.unowned_array();
+    scale(alpha, array);
+  }
+
+  template<typename S, typename T1, typename T2>
+  void axpy(const S &alpha, const ndarray_view<T1> &x, ndarray<T2> &y) {
+    axpy(alpha, x.unowned_array(), y);
+  }
+
+  template<typename S, typename X, typename T2, typename = typename std::enable_if<detail::is_array<X>::value>::type>
+  void axpy(const S &alpha, const X &x, const ndarray_view<T2> &y) {
+    ndarray<T2> array = y.unowned_array();
+    axpy(alpha, detail::view_to_array(x), array);
+  }
+
+  template<typename S1, typename T1, typename S2, typename T2>
+  void axpby(const S1 &alpha, const ndarray_view<T1> &x, const S2 &beta, ndarray<T2> &y) {
+    axpby(alpha, x.unowned_array(), beta, y);
+  }
+
+  template<typename S1, typename X, typename S2, typename T2,
+      typename = typename std::enable_if<detail::is_array<X>::value>::type>
+  void axpby(const S1 &alpha, const X &x, const S2 &beta, const ndarray_view<T2> &y) {
+    ndarray<T2> array = y.unowned_array();
+    axpby(alpha, detail::view_to_array(x), beta, array);
+  }
+
+  // Overloads for temporary destinations, such as slices in `x(range(1, 16)) += x(range(0, 15))`. A temporary
+  // ndarray shares the data of the array it was sliced from, so it is updated like a named one. Without them the
+  // expression would bind through the scalar conversion and fail at runtime for arrays of nonzero rank.
+
+  template<typename T1, typename R>
+  typename std::enable_if<!is_scalar<R>::value, ndarray<T1> >::type &operator+=(ndarray<T1> &&first, const R &second) {
+    return first += second;
+  }
+
+  template<typename T1, typename R>
+  typename std::enable_if<!is_scalar<R>::value, ndarray<T1> >::type &operator-=(ndarray<T1> &&first, const R &second) {
+    return first -= second;
+  }
+
+  template<typename T1, typename R>
+  ndarray<T1> &operator*=(ndarray<T1> &&first, const R &second) {
+    return first *= second;
+  }
+
+  template<typename T1, typename R>
+  ndarray<T1> &operator/=(ndarray<T1> &&first, const R &second) {
+    return first /= second;
+  }
+
+  template<typename S, typename T>
+  void scale(const S &alpha, ndarray<T> &&y) {
+    scale(alpha, y);
+  }
+
+  template<typename S, typename X, typename T2>
+  void axpy(const S &alpha, const X &x, ndarray<T2> &&y) {
+    axpy(alpha, x, y);
+  }
+
+  template<typename S1, typename X, typename S2, typename T2>
+  void axpby(const S1 &alpha, const X &x, const S2 &beta, ndarray<T2> &&y) {
+    axpby(alpha, x, beta, y);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  bool operator==(const A &lhs, const B &rhs) {
+    return detail::view_to_array(lhs) == detail::view_to_array(rhs);
+  }
+
+  template<typename T>
+  ndarray_view<T> permute_view(const ndarray_view<T> &view, const std::vector<size_t> &pattern) {
+    return permute_view(view.unowned_array(), pattern);
+  }
+
+  template<typename T>
+  ndarray_view<T> transpose_view(const ndarray_view<T> &view, const std::string &string_pattern) {
+    return transpose_view(view.unowned_array(), string_pattern);
+  }
+
+  template<typename T>
+  ndarray<T> transpose(const ndarray_view<T> &view, const std::string &string_pattern) {
+    return transpose(view.unowned_array(), string_pattern);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto matmul(const A &a, const B &b) -> decltype(matmul(detail::view_to_array(a), detail::view_to_array(b))) {
+    return matmul(detail::view_to_array(a), detail::view_to_array(b));
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto tensordot(const A &a, const B &b, const std::vector<size_t> &axes_a, const std::vector<size_t> &axes_b)
+  -> decltype(tensordot(detail::view_to_array(a), detail::view_to_array(b), axes_a, axes_b)) {
+    return tensordot(detail::view_to_array(a), detail::view_to_array(b), axes_a, axes_b);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto tensordot(const A &a, const B &b, size_t axes) -> decltype(tensordot(detail::view_to_array(a),
+                                                                            detail::view_to_array(b), axes)) {
+    return tensordot(detail::view_to_array(a), detail::view_to_array(b), axes);
   }
 
 }
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_NDARRAY_VIEW_H
+#define NDARRAY_NDARRAY_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <ndarray/ndarray.h>
+
+namespace ndarray {
+
+  /**
+   * Non-owning view of elements of an array: a raw pointer to the first element with shape and strides stored
+   * inline. Unlike `ndarray<T>`, copying and slicing of a view do not touch a shared reference count and the view
+   * has no virtual destructor, so it is trivially copyable and can be passed around freely, e.g. by threads slicing
+   * the same array. The view does not keep the data alive, the array it refers to has to outlive it.
+   *
+   * Views are created from `ndarray<T>` implicitly without allocation and are accepted by the arithmetic operators,
+   * reductions, transposes and contractions. Functions that return views of their operand return `ndarray_view`
+   * for views, functions that allocate their result return `ndarray`. Rank of a view is limited
+   * by NDARRAY_INLINE_RANK.
+   *
+   * @tparam T - type of an element
+   */
+  template<typename T>
+  struct ndarray_view {
+    static_assert(is_scalar<T>::value, "");
+
+    /**
+     * Empty view
+     */
+    ndarray_view() : data_(nullptr), dim_(0), size_(0), shape_(), strides_() {}
+
+    /**
+     * View of all elements of an array with the same layout
+     *
+     * @param array - array the view refers to
+     */
+    template<typename T2=typename std::remove_const<T>::type>
+    ndarray_view(const ndarray<T2> &array) : ndarray_view(array.data().get() + array.offset(), array.shape(),
+                                                          array.strides()) {
+      size_ = array.size();
+    }
+
+    template<typename T2=typename std::remove_const<T>::type>
+    ndarray_view(const ndarray_view<T2> &rhs) : data_(rhs.data_), dim_(rhs.dim_), size_(rhs.size_) {
+      std::copy(rhs.shape_, rhs.shape_ + dim_, shape_);
+      std::copy(rhs.strides_, rhs.strides_ + dim_, strides_);
+    }
+
+    /**
+     * View of an existing buffer in row-major order
+     *
+     * @param data - pointer to the first element
+     * @param shape - shape of the view
+     */
+    ndarray_view(T *data, const shape_t &shape) : ndarray_view(data, shape, dense_strides(shape)) {}
+
+    /**
+     * View of an existing buffer with explicit layout
+     *
+     * @param data - pointer to the first element
+     * @param shape - shape of the view
+     * @param strides - strides of the view (negative strides are stored modulo 2^64)
+     */
+    ndarray_view(T *data, const shape_t &shape, const shape_t &strides) : data_(data), dim_(shape.size()),
+                                                                          shape_(), strides_() {
+      if (shape.size() > NDARRAY_INLINE_RANK || strides.size() != shape.size()) {
+        throw std::runtime_error("Array of dimension " + std::to_string(shape.size()) +
+                                 " cannot be viewed, views are limited to dimension " +
+                                 std::to_string(NDARRAY_INLINE_RANK) + ".");
+      }
+      std::copy(shape.begin(), shape.end(), shape_);
+      std::copy(strides.begin(), strides.end(), strides_);
+      size_ = std::accumulate(shape_, shape_ + dim_, size_t(1), std::multiplies<size_t>());
+    }
+
+    /**
+     * Conversion into an ndarray that refers to the same elements without owning them. The result does not
+     * take part in reference counting either, it is valid as long as the viewed data is.
+     */
+    explicit operator ndarray<T>() const {
+      return unowned_array();
+    }
+
+    /**
+     * Array that refers to the viewed elements without owning them, see the conversion into `ndarray<T>`
+     */
+    ndarray<T> unowned_array() const {
+      if (data_ == nullptr) {
+        return ndarray<T>();
+      }
+      // the base is the lowest element of the view, so that offsets of all elements are non-negative
+      std::ptrdiff_t low = 0;
+      for (size_t k = 0; k < dim_; ++k) {
+        if (std::ptrdiff_t(strides_[k]) < 0 && shape_[k] > 0) {
+          low += std::ptrdiff_t(strides_[k]) * std::ptrdiff_t(shape_[k] - 1);
+        }
+      }
+      T *base = size_ == 0 ? data_ : data_ + low;
+      return ndarray<T>(std::shared_ptr<T>(std::shared_ptr<T>(), base), shape(), strides(), size_t(data_ - base));
+    }
+
+    /**
+     * Dense copy of the viewed elements
+     *
+     * @return new array that owns its data
+     */
+    ndarray<typename std::remove_const<T>::type> copy() const {
+      return unowned_array().copy();
+    }
+
+    /**
+     * Access element at given coordinates
+     *
+     * @param inds - coordinates of an element, exactly `dim()` indices
+     * @return reference to the element
+     */
+    template<typename...Indices>
+    T &at(Indices...inds) const {
+#if NDARRAY_CHECKED_ACCESS
+      if (sizeof...(Indices) != dim_) {
+        throw std::invalid_argument("Number of indices is not equal to array's dimension");
+      }
+#endif
+      return data_[index(inds...)];
+    }
+
+    /**
+     * Extract a sub-view at given leading coordinates
+     *
+     * @param inds - leading coordinates
+     * @return view of rank `dim() - sizeof...(inds)`
+     */
+    template<typename...Indices>
+    typename std::enable_if<!detail::any_range<Indices...>::value, ndarray_view<T> >::type
+    operator()(Indices...inds) const {
+#ifndef NDEBUG
+      if (sizeof...(Indices) > dim_) {
+        throw std::runtime_error("Number of indices (" + std::to_string(sizeof...(Indices)) +
+                                 ") is larger than array's dimension (" + std::to_string(dim_) + ")");
+      }
+#endif
+      const size_t lead = sizeof...(Indices);
+      ndarray_view<T> view;
+      view.data_ = data_ + index(inds...);
+      view.dim_ = dim_ - lead;
+      view.size_ = 1;
+      for (size_t k = lead; k < dim_; ++k) {
+        view.shape_[k - lead] = shape_[k];
+        view.strides_[k - lead] = strides_[k];
+        view.size_ *= shape_[k];
+      }
+      return view;
+    }
+
+    /**
+     * Extract a strided view for a mix of indices and ranges, see `ndarray<T>::slice`
+     */
+    template<typename...Indices>
+    typename std::enable_if<detail::any_range<Indices...>::value, ndarray_view<T> >::type
+    operator()(Indices...inds) const {
+      return slice(inds...);
+    }
+
+    template<typename...Args>
+    ndarray_view<T> slice(const Args &...args) const {
+      return unowned_array().slice(args...);
+    }
+
+    /**
+     * Set all viewed elements to be `value`
+     */
+    template<typename T2>
+    typename std::enable_if<is_scalar<T2>::value && std::is_convertible<T2, T>::value>::type
+    set_value(T2 value) const {
+      unowned_array().set_value(value);
+    }
+
+    bool is_contiguous() const {
+      size_t stride = 1;
+      for (size_t k = dim_; k > 0; --k) {
+        if (shape_[k - 1] != 1 && strides_[k - 1] != stride) {
+          return false;
+        }
+        stride *= shape_[k - 1];
+      }
+      return true;
+    }
+
+    // Linear iteration is only valid for contiguous views.
+
+    T *begin() const {
+      return data_;
+    }
+
+    T *end() const {
+      return data_ + size_;
+    }
+
+    /**
+     * @return pointer to the first element of the view
+     */
+    T *data() const {
+      return data_;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    size_t dim() const {
+      return dim_;
+    }
+
+    shape_t shape() const {
+      return shape_t(shape_, shape_ + dim_);
+    }
+
+    shape_t strides() const {
+      return shape_t(strides_, strides_ + dim_);
+    }
+
+  private:
+    template<typename>
+    friend struct ndarray_view;
+
+    T *data_;
+    size_t dim_;
+    size_t size_;
+    size_t shape_[NDARRAY_INLINE_RANK];
+    size_t strides_[NDARRAY_INLINE_RANK];
+
+    template<typename...Indices>
+    std::ptrdiff_t index(Indices...inds) const {
+#if NDARRAY_CHECKED_ACCESS
+      if (sizeof...(Indices) > dim_) {
+        throw std::invalid_argument("Number of indices is larger than array's dimension");
+      }
+      detail::check_index_bounds<0>(shape_, inds...);
+#endif
+      return std::ptrdiff_t(detail::index_offset<0>(strides_, inds...));
+    }
+
+    static shape_t dense_strides(const shape_t &shape) {
+      shape_t strides(shape.size());
+      size_t stride = 1;
+      for (size_t k = shape.size(); k > 0; --k) {
+        strides[k - 1] = stride;
+        stride *= shape[k - 1];
+      }
+      return strides;
+    }
+  };
+
+  static_assert(std::is_trivially_copyable<ndarray_view<double> >::value, "");
+
+  namespace detail {
+
+    template<typename A>
+    struct is_view : std::false_type {
+    };
+
+    template<typename T>
+    struct is_view<ndarray_view<T> > : std::true_type {
+    };
+
+    template<typename A>
+    struct is_array : is_view<A> {
+    };
+
+    template<typename T>
+    struct is_array<ndarray<T> > : std::true_type {
+    };
+
+    template<typename...As>
+    struct all_arrays : std::true_type {
+    };
+
+    template<typename A, typename...As>
+    struct all_arrays<A, As...> : std::integral_constant<bool, is_array<A>::value && all_arrays<As...>::value> {
+    };
+
+    template<typename...As>
+    struct any_view : std::false_type {
+    };
+
+    template<typename A, typename...As>
+    struct any_view<A, As...> : std::integral_constant<bool, is_view<A>::value || any_view<As...>::value> {
+    };
+
+    /**
+     * True if all arguments are arrays or views and at least one of them is a view. Selects overloads
+     * that convert views into ndarrays and forward to the functions on ndarrays.
+     */
+    template<typename...As>
+    struct view_arguments : std::integral_constant<bool, all_arrays<As...>::value && any_view<As...>::value> {
+    };
+
+    /**
+     * Views are converted into non-owning ndarrays, other arguments are passed through
+     */
+    template<typename E>
+    const E &view_to_array(const E &e) {
+      return e;
+    }
+
+    template<typename T>
+    ndarray<T> view_to_array(const ndarray_view<T> &view) {
+      return view.unowned_array();
+    }
+
+  }
+
+}
+
+#endif //NDARRAY_NDARRAY_VIEW_H
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_PARALLEL_H
+#define NDARRAY_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ndarray {
+
+  /**
+   * Size of a cache line in bytes. Work is split between threads at cache line boundaries,
+   * so that no two threads write into the same line.
+   */
+  constexpr size_t cache_line_size = 64;
+
+  namespace detail {
+
+    /**
+     * Fixed set of worker threads that execute a batch of tasks. Task `i` of a batch is always executed by
+     * the `i`-th thread (task 0 by the calling thread), so memory first touched by a task during allocation
+     * is later processed by the same thread, which keeps pages local to the NUMA node of that thread.
+     */
+    class thread_pool {
+    public:
+      explicit thread_pool(size_t threads) : generation_(0), tasks_(0), pending_(0), stop_(false),
+                                             invoke_(nullptr), context_(nullptr) {
+        for (size_t i = 1; i < threads; ++i) {
+          workers_.emplace_back([this, i]() { work(i); });
+        }
+      }
+
+      ~thread_pool() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread &worker : workers_) {
+          worker.join();
+        }
+      }
+
+      thread_pool(const thread_pool &) = delete;
+
+      thread_pool &operator=(const thread_pool &) = delete;
+
+      /**
+       * @return number of threads including the calling one
+       */
+      size_t size() const {
+        return workers_.size() + 1;
+      }
+
+      /**
+       * Execute `f(i)` for `i` in `[0, tasks)` and wait for completion. Runs serially if the pool is busy
+       * with another batch or when called from a worker thread. If tasks throw, all tasks still run to completion
+       * and the first exception is rethrown to the caller, preferring the one thrown by the calling thread.
+       *
+       * @param tasks - number of tasks, not larger than `size()`
+       * @param f - callable taking task index
+       */
+      template<typename F>
+      void run(size_t tasks, F &f) {
+        std::unique_lock<std::mutex> busy(run_mutex_, std::try_to_lock);
+        if (!busy.owns_lock() || in_worker()) {
+          for (size_t i = 0; i < tasks; ++i) {
+            f(i);
+          }
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          invoke_ = [](void *context, size_t i) { (*static_cast<F *>(context))(i); };
+          context_ = &f;
+          tasks_ = tasks;
+          pending_ = tasks - 1;
+          error_ = nullptr;
+          ++generation_;
+        }
+        start_.notify_all();
+        // workers refer to `f` until they are done, so wait for them even if the calling thread's task throws
+        std::exception_ptr error;
+        try {
+          f(0);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          done_.wait(lock, [this]() { return pending_ == 0; });
+          if (!error) {
+            error = error_;
+          }
+          error_ = nullptr;
+        }
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      }
+
+    private:
+      static bool &in_worker() {
+        static thread_local bool flag = false;
+        return flag;
+      }
+
+      void work(size_t index) {
+        in_worker() = true;
+        size_t seen = 0;
+        while (true) {
+          void (*invoke)(void *, size_t);
+          void *context;
+          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+            if (stop_) {
+              return;
+            }
+            seen = generation_;
+            if (index >= tasks_) {
+              continue;
+            }
+            invoke = invoke_;
+            context = context_;
+          }
+          std::exception_ptr error;
+          try {
+            invoke(context, index);
+          } catch (...) {
+            error = std::current_exception();
+          }
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error && !error_) {
+              error_ = error;
+            }
+            --pending_;
+          }
+          done_.notify_one();
+        }
+      }
+
+      std::vector<std::thread> workers_;
+      std::mutex mutex_;
+      std::mutex run_mutex_;
+      std::condition_variable start_;
+      std::condition_variable done_;
+      size_t generation_;
+      size_t tasks_;
+      size_t pending_;
+      bool stop_;
+      void (*invoke_)(void *, size_t);
+      void *context_;
+      std::exception_ptr error_;
+    };
+
+    inline size_t default_num_threads() {
+      const char *env = std::getenv("NDARRAY_NUM_THREADS");
+      if (env != nullptr && std::atoi(env) > 0) {
+        return size_t(std::atoi(env));
+      }
+      size_t threads = std::thread::hardware_concurrency();
+      return threads == 0 ? 1 : threads;
+    }
+
+    struct parallel_state {
+      std::mutex mutex;
+      std::shared_ptr<thread_pool> pool;
+      std::atomic<size_t> num_threads{default_num_threads()};
+      std::atomic<size_t> threshold{size_t(1) << 20};
+    };
+
+    inline parallel_state &parallel() {
+      static parallel_state state;
+      return state;
+    }
+
+    inline std::shared_ptr<thread_pool> get_pool() {
+      parallel_state &state = parallel();
+      std::lock_guard<std::mutex> lock(state.mutex);
+      if (!state.pool || state.pool->size() != state.num_threads) {
+        state.pool = std::make_shared<thread_pool>(state.num_threads);
+      }
+      return state.pool;
+    }
+
+  }
+
+  /**
+   * @return number of threads used by array operations
+   */
+  inline size_t get_num_threads() {
+    return detail::parallel().num_threads.load();
+  }
+
+  /**
+   * Set number of threads used by array operations. Default is the number of hardware threads or
+   * the value of NDARRAY_NUM_THREADS environment variable. Threads are started on the first parallel operation.
+   *
+   * @param threads - number of threads, 1 disables multithreading
+   * @return previous number of threads
+   */
+  inline size_t set_num_threads(size_t threads) {
+    return detail::parallel().num_threads.exchange(threads == 0 ? 1 : threads);
+  }
+
+  /**
+   * @return size in bytes below which array operations run serially
+   */
+  inline size_t get_parallel_threshold() {
+    return detail::parallel().threshold.load();
+  }
+
+  /**
+   * Set size in bytes of the data written by an operation below which it runs serially. Default is 1 MiB.
+   *
+   * @param bytes - new threshold
+   * @return previous threshold
+   */
+  inline size_t set_parallel_threshold(size_t bytes) {
+    return detail::parallel().threshold.exchange(bytes);
+  }
+
+  namespace detail {
+
+    /**
+     * Split `[0, n)` into contiguous chunks, one per thread, and call `f(begin, end)` for each of them.
+     * Chunk boundaries are multiples of a cache line worth of items. Runs `f(0, n)` on the calling thread
+     * when the amount of data is below the parallel threshold.
+     *
+     * @param n - number of items
+     * @param item_bytes - number of bytes written per item
+     * @param f - callable taking a range of items
+     */
+    template<typename F>
+    void parallel_for(size_t n, size_t item_bytes, F f) {
+      size_t bytes = n * item_bytes;
+      size_t threads = get_num_threads();
+      if (threads <= 1 || n <= 1 || bytes < get_parallel_threshold()) {
+        f(size_t(0), n);
+        return;
+      }
+      // the pool is taken before chunking, the number of threads may change concurrently
+      std::shared_ptr<thread_pool> pool = get_pool();
+      // chunks are not made smaller than 64 KiB
+      size_t chunks = std::min(pool->size(), std::max(size_t(1), bytes / (size_t(1) << 16)));
+      chunks = std::min(chunks, n);
+      size_t grain = item_bytes >= cache_line_size ? 1 : cache_line_size / std::max(item_bytes, size_t(1));
+      size_t chunk = (n + chunks - 1) / chunks;
+      chunk = (chunk + grain - 1) / grain * grain;
+      chunks = (n + chunk - 1) / chunk;
+      if (chunks <= 1) {
+        f(size_t(0), n);
+        return;
+      }
+      auto task = [&f, chunk, n](size_t i) {
+        size_t begin = i * chunk;
+        f(begin, std::min(n, begin + chunk));
+      };
+      pool->run(chunks, task);
+    }
+
+    /**
+     * Split an array of `shape` into rectangular blocks and call `f(first, block)` for each of them, where `first`
+     * is the index of the first element of the block and `block` its shape, both of the rank of `shape`. Leading
+     * dimensions are fused until there are at least as many rows as threads, so arrays with a small leading extent
+     * are still split between all threads, and the rows are chunked as in `parallel_for`. Zero-dimension arrays
+     * are processed as a single block.
+     *
+     * @param shape - shape of the array
+     * @param element_bytes - number of bytes written per element
+     * @param f - callable taking index of the first element and the shape of a block
+     */
+    template<typename Shape, typename F>
+    void parallel_blocks(const Shape &shape, size_t element_bytes, F f) {
+      if (shape.size() == 0) {
+        f(shape, shape);
+        return;
+      }
+      size_t threads = get_num_threads();
+      size_t axis = 0;
+      size_t rows = shape[0];
+      while (rows < threads && axis + 1 < shape.size()) {
+        rows *= shape[++axis];
+      }
+      size_t row = element_bytes;
+      for (size_t k = axis + 1; k < shape.size(); ++k) {
+        row *= shape[k];
+      }
+      parallel_for(rows, row, [&shape, &f, axis](size_t begin, size_t end) {
+        Shape first(shape);
+        Shape block(shape);
+        for (size_t k = 0; k < shape.size(); ++k) {
+          first[k] = 0;
+          block[k] = k < axis ? 1 : shape[k];
+        }
+        // a chunk of fused rows is a sequence of blocks, each within a single index of the leading dimensions
+        while (begin < end) {
+          size_t position = begin;
+          for (size_t k = axis + 1; k > 0; --k) {
+            first[k - 1] = position % shape[k - 1];
+            position /= shape[k - 1];
+          }
+          block[axis] = std::min(end - begin, shape[axis] - first[axis]);
+          f(static_cast<const Shape &>(first), static_cast<const Shape &>(block));
+          begin += block[axis];
+        }
+      });
+    }
+
+  }
+}
+
+#endif //NDARRAY_PARALLEL_H
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_PLAN_CACHE_H
+#define NDARRAY_PLAN_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <ndarray/small_vector.h>
+
+namespace ndarray {
+
+  namespace detail {
+
+    /**
+     * Layout numbers (shapes, strides) a plan was built for. Shape and strides of a transposed array fit
+     * without allocation.
+     */
+    using plan_layout = small_vector<size_t, 2 * NDARRAY_INLINE_RANK>;
+
+    /**
+     * Key of a cached plan: the index pattern and the layout it was built for
+     */
+    struct plan_key {
+      std::string pattern;
+      plan_layout layout;
+
+      bool operator==(const plan_key &rhs) const {
+        return pattern == rhs.pattern && layout == rhs.layout;
+      }
+    };
+
+    struct plan_key_hash {
+      size_t operator()(const plan_key &key) const {
+        size_t h = std::hash<std::string>()(key.pattern);
+        for (size_t v : key.layout) {
+          h ^= std::hash<size_t>()(v) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        }
+        return h;
+      }
+    };
+
+    /**
+     * Process-wide source of plan cache ids, so that a cache never matches front cache entries of another one,
+     * even if it is built at the address of a destroyed cache
+     */
+    inline size_t next_plan_cache_id() {
+      static std::atomic<size_t> ids(0);
+      return ids.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /**
+     * Thread-safe cache of immutable plans. Plans are shared between callers and stay valid after they are evicted.
+     * When the cache is full it is emptied, which keeps the bookkeeping trivial for the usual case of a small
+     * working set of patterns. Every thread keeps the plans it used last in a small front cache that is searched
+     * without locking, so threads that request the same few plans over and over do not contend for the mutex.
+     *
+     * @tparam Plan - type of a plan
+     */
+    template<typename Plan>
+    class plan_cache {
+    public:
+      explicit plan_cache(size_t capacity = 1024) : capacity_(capacity), id_(next_plan_cache_id()), generation_(0) {}
+
+      /**
+       * Find plan for `pattern` and `layout` or build it with `make()` and store it. Hits in the front cache
+       * neither lock nor allocate, the owning key is only built on a miss.
+       *
+       * @param pattern - index pattern of the plan
+       * @param layout - layout the plan is built for
+       * @param make - callable that returns a new plan, exceptions thrown by it are propagated
+       * @return shared immutable plan
+       */
+      template<typename Make>
+      std::shared_ptr<const Plan> get(const std::string &pattern, const plan_layout &layout, Make make) {
+        front_cache &front = local_front();
+        size_t generation = generation_.load(std::memory_order_acquire);
+        for (front_entry &entry : front.entries) {
+          if (entry.owner != id_ || !entry.plan) {
+            continue;
+          }
+          if (entry.generation != generation) {
+            // cleared since the entry was stored, release the plan
+            entry.plan.reset();
+            continue;
+          }
+          if (entry.key.layout == layout && entry.key.pattern == pattern) {
+            return entry.plan;
+          }
+        }
+        plan_key key{pattern, layout};
+        std::shared_ptr<const Plan> plan = get_shared(key, make);
+        front_entry &entry = front.entries[front.next];
+        front.next = (front.next + 1) % front.entries.size();
+        entry.owner = id_;
+        entry.generation = generation;
+        entry.key = std::move(key);
+        entry.plan = plan;
+        return plan;
+      }
+
+      /**
+       * Remove all plans, including those in the front caches of all threads. Other threads release the plans
+       * in their front caches on their next lookup.
+       */
+      void clear() {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          plans_.clear();
+          generation_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        for (front_entry &entry : local_front().entries) {
+          if (entry.owner == id_) {
+            entry.plan.reset();
+          }
+        }
+      }
+
+      size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return plans_.size();
+      }
+
+    private:
+      struct front_entry {
+        size_t owner = 0;
+        size_t generation = 0;
+        plan_key key;
+        std::shared_ptr<const Plan> plan;
+      };
+
+      struct front_cache {
+        std::array<front_entry, 8> entries;
+        size_t next = 0;
+      };
+
+      static front_cache &local_front() {
+        static thread_local front_cache front;
+        return front;
+      }
+
+      template<typename Make>
+      std::shared_ptr<const Plan> get_shared(const plan_key &key, Make make) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = plans_.find(key);
+        if (it != plans_.end()) {
+          return it->second;
+        }
+        std::shared_ptr<const Plan> plan = std::make_shared<const Plan>(make());
+        if (plans_.size() >= capacity_) {
+          plans_.clear();
+        }
+        plans_.emplace(key, plan);
+        return plan;
+      }
+
+      size_t capacity_;
+      size_t id_;
+      std::atomic<size_t> generation_;
+      std::mutex mutex_;
+      std::unordered_map<plan_key, std::shared_ptr<const Plan>, plan_key_hash> plans_;
+    };
+
+  }
+}
+
+#endif //NDARRAY_PLAN_CACHE_H
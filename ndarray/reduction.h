@@ -0,0 +1,891 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_REDUCTION_H
+#define NDARRAY_REDUCTION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ndarray/ndarray_math.h>
+#include <ndarray/simd.h>
+
+namespace ndarray {
+
+  /**
+   * Accumulation mode of sums. In compensated mode every partial sum carries its rounding error (Kahan summation)
+   * and partial sums are merged with exact two-sum, so the error does not grow with the size of the array.
+   * Compensated sums take about four times more arithmetic.
+   */
+  enum class summation {
+    standard,
+    compensated
+  };
+
+  // Reductions split elements into blocks of a fixed size. A block is reduced by SIMD kernels into a fixed number
+  // of lanes, and partial results of blocks are merged in a pairwise tree. The order of operations depends neither
+  // on the number of threads nor on the instruction set, so results are reproducible bit for bit.
+
+  namespace detail {
+
+    constexpr size_t reduce_block = 8192;
+
+    /**
+     * Elements of a strided array in row-major order
+     */
+    template<typename T>
+    struct strided_elements {
+      const T *data;
+      shape_t shape;
+      shape_t strides;
+      bool dense;
+
+      size_t size() const {
+        size_t size = 1;
+        for (size_t extent : shape) {
+          size *= extent;
+        }
+        return size;
+      }
+    };
+
+    template<typename T>
+    strided_elements<T> make_strided_elements(const T *data, const shape_t &shape, const shape_t &strides) {
+      bool dense = true;
+      size_t stride = 1;
+      for (size_t k = shape.size(); k > 0; --k) {
+        if (shape[k - 1] != 1 && strides[k - 1] != stride) {
+          dense = false;
+        }
+        stride *= shape[k - 1];
+      }
+      return strided_elements<T>{data, shape, strides, dense};
+    }
+
+    template<typename T>
+    strided_elements<typename std::remove_const<T>::type> elements_of(const ndarray<T> &array) {
+      return make_strided_elements<typename std::remove_const<T>::type>(array.data().get() + array.offset(),
+                                                                        array.shape(), array.strides());
+    }
+
+    /**
+     * Row-major walk over non-empty strided dimensions starting from the flat index `start`
+     */
+    struct flat_walker {
+      const shape_t &shape;
+      const shape_t &strides;
+      shape_t index;
+      size_t offset;
+
+      flat_walker(const shape_t &shape, const shape_t &strides, size_t start) :
+          shape(shape), strides(strides), index(shape.size(), 0), offset(0) {
+        for (size_t d = shape.size(); d > 0; --d) {
+          index[d - 1] = start % shape[d - 1];
+          start /= shape[d - 1];
+          offset += index[d - 1] * strides[d - 1];
+        }
+      }
+
+      void next() {
+        for (size_t d = shape.size(); d > 0; --d) {
+          offset += strides[d - 1];
+          if (++index[d - 1] < shape[d - 1]) {
+            return;
+          }
+          offset -= strides[d - 1] * shape[d - 1];
+          index[d - 1] = 0;
+        }
+      }
+    };
+
+    /**
+     * Elements `[begin, end)` of `x` in row-major order: a pointer into `x` if it is dense, otherwise the elements
+     * are gathered into `buffer`.
+     */
+    template<typename T>
+    const T *flat_elements(const strided_elements<T> &x, size_t begin, size_t end, std::vector<T> &buffer) {
+      if (x.dense) {
+        return x.data + begin;
+      }
+      buffer.resize(end - begin);
+      flat_walker walker(x.shape, x.strides, begin);
+      for (size_t i = 0; i < end - begin; ++i, walker.next()) {
+        buffer[i] = x.data[walker.offset];
+      }
+      return buffer.data();
+    }
+
+    template<typename T>
+    struct reduce_scratch {
+      std::vector<T> first;
+      std::vector<T> second;
+    };
+
+    /**
+     * Reduce `n` items split into blocks of `reduce_block` items between threads. Partial results of blocks
+     * are merged in a pairwise tree.
+     *
+     * @param item_bytes - number of bytes read per item
+     * @param identity - result for no items
+     * @param block - callable `block(begin, end, scratch)` returning partial result of items `[begin, end)`
+     * @param merge - callable `merge(left, right)` returning merged partial result
+     */
+    template<typename P, typename Scratch, typename Block, typename Merge>
+    P reduce_blocks(size_t n, size_t item_bytes, const P &identity, Block block, Merge merge) {
+      size_t count = (n + reduce_block - 1) / reduce_block;
+      if (count <= 1) {
+        Scratch scratch;
+        return count == 0 ? identity : block(size_t(0), n, scratch);
+      }
+      std::vector<P> partials(count, identity);
+      parallel_for(count, item_bytes * reduce_block, [&](size_t begin, size_t end) {
+        Scratch scratch;
+        for (size_t i = begin; i < end; ++i) {
+          partials[i] = block(i * reduce_block, std::min(n, (i + 1) * reduce_block), scratch);
+        }
+      });
+      for (size_t width = 1; width < count; width *= 2) {
+        for (size_t i = 0; i + width < count; i += 2 * width) {
+          partials[i] = merge(partials[i], partials[i + width]);
+        }
+      }
+      return partials[0];
+    }
+
+    /**
+     * Partial sum `value + error`, `error` is the accumulated rounding error in compensated mode and zero otherwise
+     */
+    template<typename R>
+    struct sum_partial {
+      R value;
+      R error;
+    };
+
+    template<typename R>
+    sum_partial<R> merge_sums(const sum_partial<R> &a, const sum_partial<R> &b, summation mode) {
+      if (mode == summation::standard) {
+        return sum_partial<R>{a.value + b.value, R(0)};
+      }
+      // two-sum: `s + e` is exactly `a.value + b.value`
+      R s = a.value + b.value;
+      R v = s - a.value;
+      R e = (a.value - (s - v)) + (b.value - v);
+      return sum_partial<R>{s, a.error + b.error + e};
+    }
+
+    template<typename R>
+    sum_partial<R> negate(const sum_partial<R> &a) {
+      return sum_partial<R>{-a.value, -a.error};
+    }
+
+    /**
+     * Kahan step `p += x`
+     */
+    template<typename R>
+    void add_term(sum_partial<R> &p, const R &x, summation mode) {
+      if (mode == summation::standard) {
+        p.value += x;
+        return;
+      }
+      R y = x + p.error;
+      R t = p.value + y;
+      p.error = y - (t - p.value);
+      p.value = t;
+    }
+
+    /**
+     * Sum `term(i)` over `n` real components with SIMD kernels. Lanes are merged pairwise down to `components`
+     * partial sums, so that lane `l` ends in `out[l % components]`.
+     */
+    template<typename F, typename Term>
+    void lane_sums(Term term, const F *a, const F *b, size_t n, summation mode, size_t components,
+                   sum_partial<F> *out) {
+      const size_t lanes_count = simd::reduce_lanes<F>();
+      F lanes[simd::reduce_lanes<F>()] = {};
+      F carry[simd::reduce_lanes<F>()] = {};
+      if (mode == summation::compensated) {
+        simd::accumulate_compensated(term, a, b, n, lanes, carry);
+      } else {
+        simd::accumulate(term, a, b, n, lanes);
+      }
+      sum_partial<F> parts[simd::reduce_lanes<F>()];
+      for (size_t l = 0; l < lanes_count; ++l) {
+        parts[l] = sum_partial<F>{lanes[l], -carry[l]};
+      }
+      for (size_t width = lanes_count; width > components; width /= 2) {
+        for (size_t l = 0; l < width / 2; ++l) {
+          parts[l] = merge_sums(parts[l], parts[l + width / 2], mode);
+        }
+      }
+      std::copy(parts, parts + components, out);
+    }
+
+    template<typename T>
+    typename std::enable_if<!is_complex<T>::value, sum_partial<T> >::type
+    join_components(const sum_partial<T> *parts) {
+      return parts[0];
+    }
+
+    template<typename T>
+    typename std::enable_if<is_complex<T>::value, sum_partial<T> >::type
+    join_components(const sum_partial<typename T::value_type> *parts) {
+      return sum_partial<T>{T(parts[0].value, parts[1].value), T(parts[0].error, parts[1].error)};
+    }
+
+    template<typename T>
+    typename std::enable_if<!simd_element<T>::supported, sum_partial<T> >::type
+    sum_block(const T *a, size_t n, summation mode) {
+      sum_partial<T> p{T(0), T(0)};
+      for (size_t i = 0; i < n; ++i) {
+        add_term(p, a[i], mode);
+      }
+      return p;
+    }
+
+    template<typename T>
+    typename std::enable_if<simd_element<T>::supported, sum_partial<T> >::type
+    sum_block(const T *a, size_t n, summation mode) {
+      using F = typename simd_element<T>::real;
+      const size_t components = simd_element<T>::components;
+      const F *x = reinterpret_cast<const F *>(a);
+      sum_partial<F> parts[components];
+      lane_sums(simd::value_term(), x, x, n * components, mode, components, parts);
+      return join_components<T>(parts);
+    }
+
+    /**
+     * Type of norms of arrays of `T`, integers are promoted to `double`
+     */
+    template<typename T>
+    struct norm_type {
+      using real = typename real_type<T>::type;
+      using type = typename std::conditional<std::is_integral<real>::value, double, real>::type;
+    };
+
+    template<typename R, typename T>
+    R squared_magnitude(const T &x) {
+      return R(x) * R(x);
+    }
+
+    template<typename R, typename T>
+    R squared_magnitude(const std::complex<T> &x) {
+      return R(x.real()) * R(x.real()) + R(x.imag()) * R(x.imag());
+    }
+
+    template<typename T>
+    typename std::enable_if<!simd_element<T>::supported, sum_partial<typename norm_type<T>::type> >::type
+    squares_block(const T *a, size_t n, summation mode) {
+      using R = typename norm_type<T>::type;
+      sum_partial<R> p{R(0), R(0)};
+      for (size_t i = 0; i < n; ++i) {
+        add_term(p, squared_magnitude<R>(a[i]), mode);
+      }
+      return p;
+    }
+
+    template<typename T>
+    typename std::enable_if<simd_element<T>::supported, sum_partial<typename norm_type<T>::type> >::type
+    squares_block(const T *a, size_t n, summation mode) {
+      using F = typename simd_element<T>::real;
+      const F *x = reinterpret_cast<const F *>(a);
+      sum_partial<F> p;
+      lane_sums(simd::square_term(), x, x, n * simd_element<T>::components, mode, 1, &p);
+      return p;
+    }
+
+    template<typename T>
+    typename real_type<T>::type magnitude(const T &x) {
+      return x < T(0) ? T(-x) : x;
+    }
+
+    template<typename T>
+    T magnitude(const std::complex<T> &x) {
+      return std::abs(x);
+    }
+
+    /**
+     * `|x - y|`, also for unsigned types
+     */
+    template<typename T>
+    typename real_type<T>::type distance(const T &x, const T &y) {
+      return x > y ? T(x - y) : T(y - x);
+    }
+
+    template<typename T>
+    T distance(const std::complex<T> &x, const std::complex<T> &y) {
+      return std::abs(x - y);
+    }
+
+    template<typename T>
+    typename real_type<T>::type magnitude_of(simd::value_term, const T *a, const T *, size_t i) {
+      return magnitude(a[i]);
+    }
+
+    template<typename T>
+    typename real_type<T>::type magnitude_of(simd::difference_term, const T *a, const T *b, size_t i) {
+      return distance(a[i], b[i]);
+    }
+
+    /**
+     * `m = max(m, x)` where NaN wins over any number
+     */
+    template<typename R>
+    void max_step(R &m, const R &x) {
+      if (x > m || x != x) {
+        m = x;
+      }
+    }
+
+    /**
+     * Largest absolute value of `term(i)` for `i` in `[0, n)`, where term is `a[i]` or `a[i] - b[i]`
+     */
+    template<typename Term, typename T>
+    typename std::enable_if<!(simd_element<T>::supported && !is_complex<T>::value), typename real_type<T>::type>::type
+    max_abs_block(Term term, const T *a, const T *b, size_t n) {
+      typename real_type<T>::type m(0);
+      for (size_t i = 0; i < n; ++i) {
+        max_step(m, magnitude_of(term, a, b, i));
+      }
+      return m;
+    }
+
+    template<typename Term, typename T>
+    typename std::enable_if<simd_element<T>::supported && !is_complex<T>::value, T>::type
+    max_abs_block(Term term, const T *a, const T *b, size_t n) {
+      T lanes[simd::reduce_lanes<T>()] = {};
+      T check[simd::reduce_lanes<T>()] = {};
+      simd::max_abs(term, a, b, n, lanes, check);
+      T m(0);
+      bool finite = true;
+      for (size_t l = 0; l < simd::reduce_lanes<T>(); ++l) {
+        max_step(m, lanes[l]);
+        finite = finite && check[l] == check[l];
+      }
+      if (!finite) {
+        // the kernels skip NaN, look for it when the block has infinities or NaN
+        for (size_t i = 0; i < n; ++i) {
+          T x = simd::scalar_term(term, a, b, i);
+          if (x != x) {
+            return x;
+          }
+        }
+      }
+      return m;
+    }
+
+    // Reducers of elements of type `T`: `identity()` is the result for no elements, `block(a, n)` reduces dense
+    // elements into a partial result, `add(p, x)` adds one element to a partial result, `merge(a, b)` merges two
+    // partial results and `finish(p)` converts a partial result into the final one.
+
+    template<typename T>
+    struct sum_reducer {
+      using partial = sum_partial<T>;
+      using result = T;
+      summation mode;
+
+      partial identity() const { return partial{T(0), T(0)}; }
+
+      partial block(const T *a, size_t n) const { return sum_block(a, n, mode); }
+
+      void add(partial &p, const T &x) const { add_term(p, x, mode); }
+
+      partial merge(const partial &a, const partial &b) const { return merge_sums(a, b, mode); }
+
+      result finish(const partial &p) const { return p.value + p.error; }
+    };
+
+    template<typename T>
+    struct norm_reducer {
+      using result = typename norm_type<T>::type;
+      using partial = sum_partial<result>;
+      summation mode;
+
+      partial identity() const { return partial{result(0), result(0)}; }
+
+      partial block(const T *a, size_t n) const { return squares_block(a, n, mode); }
+
+      void add(partial &p, const T &x) const { add_term(p, squared_magnitude<result>(x), mode); }
+
+      partial merge(const partial &a, const partial &b) const { return merge_sums(a, b, mode); }
+
+      result finish(const partial &p) const { return std::sqrt(p.value + p.error); }
+    };
+
+    template<typename T>
+    struct prod_reducer {
+      using partial = T;
+      using result = T;
+
+      partial identity() const { return T(1); }
+
+      partial block(const T *a, size_t n) const {
+        T p(1);
+        for (size_t i = 0; i < n; ++i) {
+          p *= a[i];
+        }
+        return p;
+      }
+
+      void add(partial &p, const T &x) const { p *= x; }
+
+      partial merge(const partial &a, const partial &b) const { return a * b; }
+
+      result finish(const partial &p) const { return p; }
+    };
+
+    template<typename T>
+    struct max_abs_reducer {
+      using partial = typename real_type<T>::type;
+      using result = partial;
+
+      partial identity() const { return partial(0); }
+
+      partial block(const T *a, size_t n) const { return max_abs_block(simd::value_term(), a, a, n); }
+
+      void add(partial &p, const T &x) const { max_step(p, magnitude(x)); }
+
+      partial merge(const partial &a, const partial &b) const {
+        partial m = a;
+        max_step(m, b);
+        return m;
+      }
+
+      result finish(const partial &p) const { return p; }
+    };
+
+    template<typename Op, typename T>
+    typename Op::result reduce_all(const Op &op, const strided_elements<T> &x) {
+      using P = typename Op::partial;
+      return op.finish(reduce_blocks<P, reduce_scratch<T> >(
+          x.size(), sizeof(T), op.identity(),
+          [&](size_t begin, size_t end, reduce_scratch<T> &scratch) {
+            return op.block(flat_elements(x, begin, end, scratch.first), end - begin);
+          },
+          [&](const P &a, const P &b) { return op.merge(a, b); }));
+    }
+
+    /**
+     * Reduce `x` along `axes`. When the innermost dimension is reduced every element of the result is a reduction
+     * of its own sub-array, computed exactly as a reduction of a whole array. Otherwise rows of the remaining
+     * dimensions are accumulated element by element in the order of the reduced indices.
+     */
+    template<typename Op, typename T>
+    ndarray<typename Op::result> reduce_axes(const Op &op, const strided_elements<T> &x,
+                                             const std::vector<size_t> &axes) {
+      using R = typename Op::result;
+      using P = typename Op::partial;
+      size_t dim = x.shape.size();
+      std::vector<bool> reduced(dim, false);
+      for (size_t axis : axes) {
+        if (axis >= dim || reduced[axis]) {
+          throw std::runtime_error("Incorrect reduction axes.");
+        }
+        reduced[axis] = true;
+      }
+      shape_t kept_shape, kept_strides, inner_shape, inner_strides;
+      for (size_t d = 0; d < dim; ++d) {
+        (reduced[d] ? inner_shape : kept_shape).push_back(x.shape[d]);
+        (reduced[d] ? inner_strides : kept_strides).push_back(x.strides[d]);
+      }
+      ndarray<R> result(uninitialized, kept_shape);
+      R *out = result.data().get();
+      size_t count = result.size();
+      strided_elements<T> inner = make_strided_elements(x.data, inner_shape, inner_strides);
+      size_t length = inner.size();
+      if (count == 0) {
+        return result;
+      }
+      if (length == 0) {
+        std::fill(out, out + count, op.finish(op.identity()));
+        return result;
+      }
+      if (dim > 0 && !reduced[dim - 1]) {
+        parallel_for(count, sizeof(T) * length, [&](size_t begin, size_t end) {
+          std::vector<size_t> offsets(end - begin);
+          flat_walker kept(kept_shape, kept_strides, begin);
+          for (size_t j = 0; j < end - begin; ++j, kept.next()) {
+            offsets[j] = kept.offset;
+          }
+          std::vector<P> partials(end - begin, op.identity());
+          flat_walker walker(inner_shape, inner_strides, 0);
+          for (size_t i = 0; i < length; ++i, walker.next()) {
+            const T *row = x.data + walker.offset;
+            for (size_t j = 0; j < end - begin; ++j) {
+              op.add(partials[j], row[offsets[j]]);
+            }
+          }
+          for (size_t j = 0; j < end - begin; ++j) {
+            out[begin + j] = op.finish(partials[j]);
+          }
+        });
+        return result;
+      }
+      auto reduce_range = [&](size_t begin, size_t end) {
+        flat_walker kept(kept_shape, kept_strides, begin);
+        strided_elements<T> sub = inner;
+        for (size_t j = begin; j < end; ++j, kept.next()) {
+          sub.data = x.data + kept.offset;
+          out[j] = reduce_all(op, sub);
+        }
+      };
+      if (count >= get_num_threads()) {
+        // inner reductions run serially inside of the threads
+        parallel_for(count, sizeof(T) * length, reduce_range);
+      } else {
+        reduce_range(0, count);
+      }
+      return result;
+    }
+
+    template<typename T>
+    T conjugate(const T &x) {
+      return x;
+    }
+
+    template<typename T>
+    std::complex<T> conjugate(const std::complex<T> &x) {
+      return std::conj(x);
+    }
+
+    template<typename R, bool Conjugate>
+    typename std::enable_if<!simd_element<R>::supported, sum_partial<R> >::type
+    dot_block(const R *a, const R *b, size_t n, summation mode) {
+      sum_partial<R> p{R(0), R(0)};
+      for (size_t i = 0; i < n; ++i) {
+        add_term(p, R((Conjugate ? conjugate(a[i]) : a[i]) * b[i]), mode);
+      }
+      return p;
+    }
+
+    template<typename R, bool Conjugate>
+    typename std::enable_if<simd_element<R>::supported && !is_complex<R>::value, sum_partial<R> >::type
+    dot_block(const R *a, const R *b, size_t n, summation mode) {
+      sum_partial<R> p;
+      lane_sums(simd::product_term(), a, b, n, mode, 1, &p);
+      return p;
+    }
+
+    template<typename R, bool Conjugate>
+    typename std::enable_if<simd_element<R>::supported && is_complex<R>::value, sum_partial<R> >::type
+    dot_block(const R *a, const R *b, size_t n, summation mode) {
+      using F = typename R::value_type;
+      const F *x = reinterpret_cast<const F *>(a);
+      const F *y = reinterpret_cast<const F *>(b);
+      // p = (sum re(a) re(b), sum im(a) im(b)) and q = (sum re(a) im(b), sum im(a) re(b))
+      sum_partial<F> p[2], q[2], parts[2];
+      lane_sums(simd::product_term(), x, y, 2 * n, mode, 2, p);
+      lane_sums(simd::swapped_product_term(), x, y, 2 * n, mode, 2, q);
+      parts[0] = merge_sums(p[0], Conjugate ? p[1] : negate(p[1]), mode);
+      parts[1] = merge_sums(q[0], Conjugate ? negate(q[1]) : q[1], mode);
+      return join_components<R>(parts);
+    }
+
+    template<bool Conjugate, typename T1, typename T2>
+    typename product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type
+    dot_product(const ndarray<T1> &a, const ndarray<T2> &b, summation mode) {
+      using R = typename product_type<typename std::remove_const<T1>::type,
+                                      typename std::remove_const<T2>::type>::type;
+      if (a.shape() != b.shape()) {
+        throw std::runtime_error("Arrays of shapes " + shape_string(a.shape()) + " and " +
+                                 shape_string(b.shape()) + " have different shapes in dot product.");
+      }
+      ndarray<R> x_array = cast_array<R>(a);
+      ndarray<R> y_array = cast_array<R>(b);
+      strided_elements<R> x = elements_of(x_array);
+      strided_elements<R> y = elements_of(y_array);
+      sum_partial<R> p = reduce_blocks<sum_partial<R>, reduce_scratch<R> >(
+          x.size(), 2 * sizeof(R), sum_partial<R>{R(0), R(0)},
+          [&](size_t begin, size_t end, reduce_scratch<R> &scratch) {
+            return dot_block<R, Conjugate>(flat_elements(x, begin, end, scratch.first),
+                                           flat_elements(y, begin, end, scratch.second), end - begin, mode);
+          },
+          [&](const sum_partial<R> &l, const sum_partial<R> &r) { return merge_sums(l, r, mode); });
+      return p.value + p.error;
+    }
+
+    /**
+     * Operands of an elementwise comparison, converted to the common type `R` and broadcast to the common shape
+     */
+    template<typename R, typename T1, typename T2>
+    std::pair<ndarray<R>, ndarray<R> > comparison_operands(const ndarray<T1> &a, const ndarray<T2> &b) {
+      shape_t shape = broadcast_shape(a.shape(), b.shape());
+      return std::make_pair(broadcast_view(cast_array<R>(a), shape), broadcast_view(cast_array<R>(b), shape));
+    }
+
+    template<typename T>
+    typename std::enable_if<!(simd_element<T>::supported && !is_complex<T>::value), bool>::type
+    close_block(const T *a, const T *b, size_t n, double rtol, double atol) {
+      using R = typename std::common_type<typename real_type<T>::type, double>::type;
+      for (size_t i = 0; i < n; ++i) {
+        R y = R(magnitude(b[i]));
+        if (!(std::isfinite(y) ? R(distance(a[i], b[i])) <= R(atol) + R(rtol) * y : a[i] == b[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    template<typename T>
+    typename std::enable_if<simd_element<T>::supported && !is_complex<T>::value, bool>::type
+    close_block(const T *a, const T *b, size_t n, double rtol, double atol) {
+      return simd::close(a, b, n, T(rtol), T(atol));
+    }
+
+  }
+
+  /**
+   * Sum of all elements of an array
+   *
+   * @param array - array to sum
+   * @param mode - standard or compensated summation
+   * @return sum of the elements, zero for an empty array
+   */
+  template<typename T>
+  typename std::remove_const<T>::type sum(const ndarray<T> &array, summation mode = summation::standard) {
+    return detail::reduce_all(detail::sum_reducer<typename std::remove_const<T>::type>{mode},
+                              detail::elements_of(array));
+  }
+
+  /**
+   * Sum of elements along `axes`, NumPy `sum(array, axis=axes)`
+   *
+   * @param array - array to sum
+   * @param axes - reduced dimensions
+   * @param mode - standard or compensated summation
+   * @return new array with the remaining dimensions
+   */
+  template<typename T>
+  ndarray<typename std::remove_const<T>::type> sum(const ndarray<T> &array, const std::vector<size_t> &axes,
+                                                   summation mode = summation::standard) {
+    return detail::reduce_axes(detail::sum_reducer<typename std::remove_const<T>::type>{mode},
+                               detail::elements_of(array), axes);
+  }
+
+  /**
+   * Product of all elements of an array, one for an empty array
+   */
+  template<typename T>
+  typename std::remove_const<T>::type prod(const ndarray<T> &array) {
+    return detail::reduce_all(detail::prod_reducer<typename std::remove_const<T>::type>(), detail::elements_of(array));
+  }
+
+  /**
+   * Product of elements along `axes`
+   */
+  template<typename T>
+  ndarray<typename std::remove_const<T>::type> prod(const ndarray<T> &array, const std::vector<size_t> &axes) {
+    return detail::reduce_axes(detail::prod_reducer<typename std::remove_const<T>::type>(),
+                               detail::elements_of(array), axes);
+  }
+
+  /**
+   * Largest absolute value of the elements of an array, zero for an empty array. NaN elements give NaN.
+   */
+  template<typename T>
+  typename detail::real_type<typename std::remove_const<T>::type>::type max_abs(const ndarray<T> &array) {
+    return detail::reduce_all(detail::max_abs_reducer<typename std::remove_const<T>::type>(),
+                              detail::elements_of(array));
+  }
+
+  /**
+   * Largest absolute value of the elements along `axes`
+   */
+  template<typename T>
+  ndarray<typename detail::real_type<typename std::remove_const<T>::type>::type>
+  max_abs(const ndarray<T> &array, const std::vector<size_t> &axes) {
+    return detail::reduce_axes(detail::max_abs_reducer<typename std::remove_const<T>::type>(),
+                               detail::elements_of(array), axes);
+  }
+
+  /**
+   * Euclidean (Frobenius) norm of an array: square root of the sum of squared absolute values of the elements
+   *
+   * @param array - array
+   * @param mode - standard or compensated summation of the squares
+   */
+  template<typename T>
+  typename detail::norm_type<typename std::remove_const<T>::type>::type
+  norm(const ndarray<T> &array, summation mode = summation::standard) {
+    return detail::reduce_all(detail::norm_reducer<typename std::remove_const<T>::type>{mode},
+                              detail::elements_of(array));
+  }
+
+  /**
+   * Euclidean norms of the sub-arrays along `axes`
+   */
+  template<typename T>
+  ndarray<typename detail::norm_type<typename std::remove_const<T>::type>::type>
+  norm(const ndarray<T> &array, const std::vector<size_t> &axes, summation mode = summation::standard) {
+    return detail::reduce_axes(detail::norm_reducer<typename std::remove_const<T>::type>{mode},
+                               detail::elements_of(array), axes);
+  }
+
+  /**
+   * Sum of products of the corresponding elements of two arrays of the same shape, `sum(a[i] * b[i])`.
+   * Use `tensordot` to contract along some of the axes.
+   *
+   * @param a, b - arrays of the same shape
+   * @param mode - standard or compensated summation
+   */
+  template<typename T1, typename T2>
+  typename detail::product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type
+  dot(const ndarray<T1> &a, const ndarray<T2> &b, summation mode = summation::standard) {
+    return detail::dot_product<false>(a, b, mode);
+  }
+
+  /**
+   * Dot product with complex conjugation of the first array, `sum(conj(a[i]) * b[i])`
+   *
+   * @param a, b - arrays of the same shape
+   * @param mode - standard or compensated summation
+   */
+  template<typename T1, typename T2>
+  typename detail::product_type<typename std::remove_const<T1>::type, typename std::remove_const<T2>::type>::type
+  vdot(const ndarray<T1> &a, const ndarray<T2> &b, summation mode = summation::standard) {
+    return detail::dot_product<true>(a, b, mode);
+  }
+
+  /**
+   * Largest absolute difference of the corresponding elements of two arrays. Arrays are broadcast to a common shape.
+   *
+   * @param a, b - arrays
+   * @return `max |a[i] - b[i]|`, zero for empty arrays and NaN if any difference is NaN
+   */
+  template<typename T1, typename T2>
+  typename detail::real_type<typename detail::product_type<typename std::remove_const<T1>::type,
+                                                           typename std::remove_const<T2>::type>::type>::type
+  max_abs_diff(const ndarray<T1> &a, const ndarray<T2> &b) {
+    using R = typename detail::product_type<typename std::remove_const<T1>::type,
+                                            typename std::remove_const<T2>::type>::type;
+    using P = typename detail::real_type<R>::type;
+    std::pair<ndarray<R>, ndarray<R> > operands = detail::comparison_operands<R>(a, b);
+    detail::strided_elements<R> x = detail::elements_of(operands.first);
+    detail::strided_elements<R> y = detail::elements_of(operands.second);
+    return detail::reduce_blocks<P, detail::reduce_scratch<R> >(
+        x.size(), 2 * sizeof(R), P(0),
+        [&](size_t begin, size_t end, detail::reduce_scratch<R> &scratch) {
+          const R *xb = detail::flat_elements(x, begin, end, scratch.first);
+          const R *yb = detail::flat_elements(y, begin, end, scratch.second);
+          return detail::max_abs_block(detail::simd::difference_term(), xb, yb, end - begin);
+        },
+        [](const P &l, const P &r) {
+          P m = l;
+          detail::max_step(m, r);
+          return m;
+        });
+  }
+
+  /**
+   * Check that all elements of two arrays are close, as NumPy `allclose`: `|a[i] - b[i]| <= atol + rtol * |b[i]|`.
+   * Infinities are only close to equal infinities and NaN is not close to anything. Arrays are broadcast to a common shape.
+   * Blocks of elements are compared by several threads, and the comparison stops at the first block with
+   * a mismatch.
+   *
+   * @param a, b - arrays
+   * @param rtol - relative tolerance, with respect to the elements of `b`
+   * @param atol - absolute tolerance
+   */
+  template<typename T1, typename T2>
+  bool allclose(const ndarray<T1> &a, const ndarray<T2> &b, double rtol = 1e-5, double atol = 1e-8) {
+    using R = typename detail::product_type<typename std::remove_const<T1>::type,
+                                            typename std::remove_const<T2>::type>::type;
+    std::pair<ndarray<R>, ndarray<R> > operands = detail::comparison_operands<R>(a, b);
+    detail::strided_elements<R> x = detail::elements_of(operands.first);
+    detail::strided_elements<R> y = detail::elements_of(operands.second);
+    size_t n = x.size();
+    size_t blocks = (n + detail::reduce_block - 1) / detail::reduce_block;
+    std::atomic<bool> close(true);
+    detail::parallel_for(blocks, 2 * sizeof(R) * detail::reduce_block, [&](size_t begin, size_t end) {
+      detail::reduce_scratch<R> scratch;
+      for (size_t i = begin; i < end && close.load(std::memory_order_relaxed); ++i) {
+        size_t first = i * detail::reduce_block;
+        size_t last = std::min(n, first + detail::reduce_block);
+        const R *xb = detail::flat_elements(x, first, last, scratch.first);
+        const R *yb = detail::flat_elements(y, first, last, scratch.second);
+        if (!detail::close_block(xb, yb, last - first, rtol, atol)) {
+          close.store(false, std::memory_order_relaxed);
+        }
+      }
+    });
+    return close.load();
+  }
+
+  // Overloads for non-owning views, see ndarray_math.h
+
+  template<typename T>
+  auto sum(const ndarray_view<T> &view, summation mode = summation::standard) -> decltype(sum(ndarray<T>(), mode)) {
+    return sum(view.unowned_array(), mode);
+  }
+
+  template<typename T>
+  auto sum(const ndarray_view<T> &view, const std::vector<size_t> &axes, summation mode = summation::standard)
+  -> decltype(sum(ndarray<T>(), axes, mode)) {
+    return sum(view.unowned_array(), axes, mode);
+  }
+
+  template<typename T>
+  auto prod(const ndarray_view<T> &view) -> decltype(prod(ndarray<T>())) {
+    return prod(view.unowned_array());
+  }
+
+  template<typename T>
+  auto prod(const ndarray_view<T> &view, const std::vector<size_t> &axes) -> decltype(prod(ndarray<T>(), axes)) {
+    return prod(view.unowned_array(), axes);
+  }
+
+  template<typename T>
+  auto max_abs(const ndarray_view<T> &view) -> decltype(max_abs(ndarray<T>())) {
+    return max_abs(view.unowned_array());
+  }
+
+  template<typename T>
+  auto max_abs(const ndarray_view<T> &view, const std::vector<size_t> &axes) -> decltype(max_abs(ndarray<T>(), axes)) {
+    return max_abs(view.unowned_array(), axes);
+  }
+
+  template<typename T>
+  auto norm(const ndarray_view<T> &view, summation mode = summation::standard) -> decltype(norm(ndarray<T>(), mode)) {
+    return norm(view.unowned_array(), mode);
+  }
+
+  template<typename T>
+  auto norm(const ndarray_view<T> &view, const std::vector<size_t> &axes, summation mode = summation::standard)
+  -> decltype(norm(ndarray<T>(), axes, mode)) {
+    return norm(view.unowned_array(), axes, mode);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto dot(const A &a, const B &b, summation mode = summation::standard)
+  -> decltype(dot(detail::view_to_array(a), detail::view_to_array(b), mode)) {
+    return dot(detail::view_to_array(a), detail::view_to_array(b), mode);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto vdot(const A &a, const B &b, summation mode = summation::standard)
+  -> decltype(vdot(detail::view_to_array(a), detail::view_to_array(b), mode)) {
+    return vdot(detail::view_to_array(a), detail::view_to_array(b), mode);
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  auto max_abs_diff(const A &a, const B &b) -> decltype(max_abs_diff(detail::view_to_array(a),
+                                                                     detail::view_to_array(b))) {
+    return max_abs_diff(detail::view_to_array(a), detail::view_to_array(b));
+  }
+
+  template<typename A, typename B, typename = typename std::enable_if<detail::view_arguments<A, B>::value>::type>
+  bool allclose(const A &a, const B &b, double rtol = 1e-5, double atol = 1e-8) {
+    return allclose(detail::view_to_array(a), detail::view_to_array(b), rtol, atol);
+  }
+
+}
+
+#endif //NDARRAY_REDUCTION_H
@@ -0,0 +1,886 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_SIMD_H
+#define NDARRAY_SIMD_H
+
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include <ndarray/parallel.h>
+
+/**
+ * Explicit SIMD kernels are compiled for x86-64 with GCC, where every instruction set is enabled only
+ * for its own kernels and the one to use is selected at runtime. Other platforms use the scalar kernels.
+ * Define NDARRAY_NO_SIMD to disable SIMD kernels completely.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && !defined(NDARRAY_NO_SIMD)
+#define NDARRAY_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define NDARRAY_SIMD_X86 0
+#endif
+
+namespace ndarray {
+
+  /**
+   * Instruction set used by elementwise kernels
+   */
+  enum class simd_level {
+    scalar = 0,
+    sse2 = 1,
+    avx2 = 2,
+    avx512 = 3
+  };
+
+  namespace detail {
+
+    inline simd_level detect_simd_level() {
+#if NDARRAY_SIMD_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")) {
+        return simd_level::avx512;
+      }
+      if (__builtin_cpu_supports("avx2")) {
+        return simd_level::avx2;
+      }
+      return simd_level::sse2;
+#else
+      return simd_level::scalar;
+#endif
+    }
+
+    inline std::atomic<simd_level> &current_simd_level() {
+      static std::atomic<simd_level> level(detect_simd_level());
+      return level;
+    }
+
+  }
+
+  /**
+   * @return instruction set currently used by elementwise kernels
+   */
+  inline simd_level get_simd_level() {
+    return detail::current_simd_level().load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Change instruction set used by elementwise kernels. Levels that are not supported by the CPU are
+   * lowered to the best supported one.
+   *
+   * @param level - requested instruction set
+   * @return previous instruction set
+   */
+  inline simd_level set_simd_level(simd_level level) {
+    simd_level supported = detail::detect_simd_level();
+    return detail::current_simd_level().exchange(int(level) > int(supported) ? supported : level);
+  }
+
+  namespace detail {
+
+    /**
+     * Kernels for elementwise arithmetic over buffers of `float` or `double`. Complex numbers
+     * are processed as interleaved pairs of real numbers. Every kernel computes exactly the same IEEE operations
+     * as the scalar code (`R(a) op R(b)` with real operands promoted to complex with zero imaginary part),
+     * so results do not depend on the instruction set. Reduction kernels accumulate sums of values, squares or
+     * products, and maxima of absolute values into a fixed number of partial results for the same reason.
+     */
+    namespace simd {
+
+      struct add_tag {
+      };
+
+      struct sub_tag {
+      };
+
+      struct mul_tag {
+      };
+
+      struct div_tag {
+      };
+
+      template<typename F>
+      inline F scalar_op(add_tag, F a, F b) {
+        return a + b;
+      }
+
+      template<typename F>
+      inline F scalar_op(sub_tag, F a, F b) {
+        return a - b;
+      }
+
+      template<typename F>
+      inline F scalar_op(mul_tag, F a, F b) {
+        return a * b;
+      }
+
+      template<typename F>
+      inline F scalar_op(div_tag, F a, F b) {
+        return a / b;
+      }
+
+      /**
+       * Terms of reductions over the components of buffers `a` and `b`: `a[i]`, `a[i] * a[i]`, `a[i] * b[i]`,
+       * `a[i] * b[i ^ 1]`, where the last one multiplies with swapped real and imaginary parts of `b`,
+       * and `a[i] - b[i]`
+       */
+      struct value_term {
+      };
+
+      struct square_term {
+      };
+
+      struct product_term {
+      };
+
+      struct swapped_product_term {
+      };
+
+      struct difference_term {
+      };
+
+      template<typename F>
+      inline F scalar_term(value_term, const F *a, const F *, size_t i) {
+        return a[i];
+      }
+
+      template<typename F>
+      inline F scalar_term(square_term, const F *a, const F *, size_t i) {
+        return a[i] * a[i];
+      }
+
+      template<typename F>
+      inline F scalar_term(product_term, const F *a, const F *b, size_t i) {
+        return a[i] * b[i];
+      }
+
+      template<typename F>
+      inline F scalar_term(swapped_product_term, const F *a, const F *b, size_t i) {
+        return a[i] * b[i ^ 1];
+      }
+
+      template<typename F>
+      inline F scalar_term(difference_term, const F *a, const F *b, size_t i) {
+        return a[i] - b[i];
+      }
+
+      /**
+       * Number of partial results kept by reduction kernels: component `i` is accumulated into lane
+       * `i % reduce_lanes<F>()`. The number does not depend on the instruction set, so every kernel performs
+       * the same IEEE operations in the same order and results are identical for all instruction sets.
+       */
+      template<typename F>
+      constexpr size_t reduce_lanes() {
+        return 128 / sizeof(F);
+      }
+
+// Products must not be contracted into fused multiply-adds (e.g. with -march=native), so that every instruction
+// set produces the same results as the scalar kernels
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+      /**
+       * NumPy `isclose` condition `|x - y| <= atol + rtol * |y|` for finite `y`. Infinities are only close to equal
+       * infinities and NaN is not close to anything.
+       */
+      template<typename F>
+      inline bool close_element(F x, F y, F rtol, F atol) {
+        return std::isfinite(y) ? std::fabs(x - y) <= atol + rtol * std::fabs(y) : x == y;
+      }
+
+      namespace scalar {
+
+        /**
+         * `out[i] = a[i] op b[i]` for `i` in `[start, n)`
+         */
+        template<typename F, typename Op>
+        void binary(Op op, const F *a, const F *b, F *out, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            out[i] = scalar_op(op, a[i], b[i]);
+          }
+        }
+
+        /**
+         * `out[i] = a[i] op p[i % 2]`, where `p = {p0, p1}`, for `i` in `[start, n)`. `start` has to be even.
+         */
+        template<typename F, typename Op>
+        void pattern(Op op, const F *a, F p0, F p1, F *out, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            out[i] = scalar_op(op, a[i], (i & 1) ? p1 : p0);
+          }
+        }
+
+        /**
+         * Real `a` and complex `b` of `n` elements: `out[2i] = a[i] op b[2i]`, `out[2i+1] = 0 op b[2i+1]`
+         */
+        template<typename F, typename Op>
+        void widen_left(Op op, const F *a, const F *b, F *out, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            out[2 * i] = scalar_op(op, a[i], b[2 * i]);
+            out[2 * i + 1] = scalar_op(op, F(0), b[2 * i + 1]);
+          }
+        }
+
+        /**
+         * Complex `a` and real `b` of `n` elements: `out[2i] = a[2i] op b[i]`, `out[2i+1] = a[2i+1] op 0`
+         */
+        template<typename F, typename Op>
+        void widen_right(Op op, const F *a, const F *b, F *out, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            out[2 * i] = scalar_op(op, a[2 * i], b[i]);
+            out[2 * i + 1] = scalar_op(op, a[2 * i + 1], F(0));
+          }
+        }
+
+        /**
+         * Real `a` of `n` elements and complex scalar `p`: `out[2i] = a[i] op p0`, `out[2i+1] = 0 op p1`
+         */
+        template<typename F, typename Op>
+        void widen_pattern(Op op, const F *a, F p0, F p1, F *out, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            out[2 * i] = scalar_op(op, a[i], p0);
+            out[2 * i + 1] = scalar_op(op, F(0), p1);
+          }
+        }
+
+        template<typename F>
+        void axpy(F alpha, const F *x, F *y, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            y[i] = y[i] + alpha * x[i];
+          }
+        }
+
+        template<typename F>
+        void axpby(F alpha, const F *x, F beta, F *y, size_t n, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            y[i] = alpha * x[i] + beta * y[i];
+          }
+        }
+
+        /**
+         * `lanes[i % L] += term(i)` for `i` in `[start, n)`, `start` has to be a multiple of `L = reduce_lanes<F>()`
+         */
+        template<typename F, typename Term>
+        void accumulate(Term term, const F *a, const F *b, size_t n, F *lanes, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            lanes[i % reduce_lanes<F>()] += scalar_term(term, a, b, i);
+          }
+        }
+
+        /**
+         * Kahan summation of `term(i)` into `lanes[i % L]` with compensations in `carry[i % L]`
+         */
+        template<typename F, typename Term>
+        void accumulate_compensated(Term term, const F *a, const F *b, size_t n, F *lanes, F *carry,
+                                    size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            size_t l = i % reduce_lanes<F>();
+            F y = scalar_term(term, a, b, i) - carry[l];
+            F t = lanes[l] + y;
+            carry[l] = (t - lanes[l]) - y;
+            lanes[l] = t;
+          }
+        }
+
+        /**
+         * `lanes[i % L] = max(lanes[i % L], |term(i)|)` for `i` in `[start, n)`. The maximum skips NaN like the SIMD
+         * instructions do, instead `check[i % L] += term(i) - term(i)` becomes NaN when NaN or infinity is met.
+         */
+        template<typename F, typename Term>
+        void max_abs(Term term, const F *a, const F *b, size_t n, F *lanes, F *check, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            size_t l = i % reduce_lanes<F>();
+            F t = scalar_term(term, a, b, i);
+            F x = std::fabs(t);
+            lanes[l] = lanes[l] > x ? lanes[l] : x;
+            check[l] += t - t;
+          }
+        }
+
+        /**
+         * @return whether `close_element(a[i], b[i], rtol, atol)` holds for all `i` in `[start, n)`
+         */
+        template<typename F>
+        bool close(const F *a, const F *b, size_t n, F rtol, F atol, size_t start = 0) {
+          for (size_t i = start; i < n; ++i) {
+            if (!close_element(a[i], b[i], rtol, atol)) {
+              return false;
+            }
+          }
+          return true;
+        }
+
+      }
+
+#if NDARRAY_SIMD_X86
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+      namespace sse2 {
+
+        template<typename F>
+        struct vector_traits;
+
+        template<>
+        struct vector_traits<double> {
+          using reg = __m128d;
+          static constexpr size_t width = 2;
+
+          static reg load(const double *p) { return _mm_loadu_pd(p); }
+
+          static void store(double *p, reg x) { _mm_storeu_pd(p, x); }
+
+          static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+
+          static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+
+          static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+
+          static reg abs(reg x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+
+          static reg swap_pairs(reg x) { return _mm_shuffle_pd(x, x, 1); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm_movemask_pd(_mm_cmple_pd(a, b))); }
+
+          static reg pattern(double p0, double p1) { return _mm_set_pd(p1, p0); }
+
+          static reg widen_lo(reg x) { return _mm_unpacklo_pd(x, _mm_setzero_pd()); }
+
+          static reg widen_hi(reg x) { return _mm_unpackhi_pd(x, _mm_setzero_pd()); }
+        };
+
+        template<>
+        struct vector_traits<float> {
+          using reg = __m128;
+          static constexpr size_t width = 4;
+
+          static reg load(const float *p) { return _mm_loadu_ps(p); }
+
+          static void store(float *p, reg x) { _mm_storeu_ps(p, x); }
+
+          static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+
+          static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+
+          static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+
+          static reg abs(reg x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+
+          static reg swap_pairs(reg x) { return _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+
+          static reg pattern(float p0, float p1) { return _mm_set_ps(p1, p0, p1, p0); }
+
+          static reg widen_lo(reg x) { return _mm_unpacklo_ps(x, _mm_setzero_ps()); }
+
+          static reg widen_hi(reg x) { return _mm_unpackhi_ps(x, _mm_setzero_ps()); }
+        };
+
+#include <ndarray/simd_kernels.h>
+
+      }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+      namespace avx2 {
+
+        template<typename F>
+        struct vector_traits;
+
+        template<>
+        struct vector_traits<double> {
+          using reg = __m256d;
+          static constexpr size_t width = 4;
+
+          static reg load(const double *p) { return _mm256_loadu_pd(p); }
+
+          static void store(double *p, reg x) { _mm256_storeu_pd(p, x); }
+
+          static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+
+          static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+
+          static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+
+          static reg abs(reg x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+
+          static reg swap_pairs(reg x) { return _mm256_permute_pd(x, 0x5); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ))); }
+
+          static reg pattern(double p0, double p1) { return _mm256_set_pd(p1, p0, p1, p0); }
+
+          // unpack works within 128-bit lanes, so the halves are brought into the lanes first
+          static reg widen_lo(reg x) {
+            return _mm256_unpacklo_pd(_mm256_permute4x64_pd(x, 0xD8), _mm256_setzero_pd());
+          }
+
+          static reg widen_hi(reg x) {
+            return _mm256_unpackhi_pd(_mm256_permute4x64_pd(x, 0xD8), _mm256_setzero_pd());
+          }
+        };
+
+        template<>
+        struct vector_traits<float> {
+          using reg = __m256;
+          static constexpr size_t width = 8;
+
+          static reg load(const float *p) { return _mm256_loadu_ps(p); }
+
+          static void store(float *p, reg x) { _mm256_storeu_ps(p, x); }
+
+          static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+
+          static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+
+          static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+
+          static reg abs(reg x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+
+          static reg swap_pairs(reg x) { return _mm256_permute_ps(x, 0xB1); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ))); }
+
+          static reg pattern(float p0, float p1) { return _mm256_set_ps(p1, p0, p1, p0, p1, p0, p1, p0); }
+
+          static reg widen_lo(reg x) {
+            return _mm256_unpacklo_ps(lanes(x), _mm256_setzero_ps());
+          }
+
+          static reg widen_hi(reg x) {
+            return _mm256_unpackhi_ps(lanes(x), _mm256_setzero_ps());
+          }
+
+        private:
+          static reg lanes(reg x) {
+            return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), 0xD8));
+          }
+        };
+
+#include <ndarray/simd_kernels.h>
+
+      }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+      namespace avx512 {
+
+        template<typename F>
+        struct vector_traits;
+
+        // Unmasked forms of some intrinsics take an undefined source register that GCC reports as possibly
+        // uninitialized, zero-masked forms with a full mask compile to the same instructions.
+        template<>
+        struct vector_traits<double> {
+          using reg = __m512d;
+          static constexpr size_t width = 8;
+
+          static reg load(const double *p) { return _mm512_loadu_pd(p); }
+
+          static void store(double *p, reg x) { _mm512_storeu_pd(p, x); }
+
+          static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+
+          static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+
+          static reg max(reg a, reg b) { return _mm512_maskz_max_pd(0xFF, a, b); }
+
+          static reg abs(reg x) { return _mm512_abs_pd(x); }
+
+          static reg swap_pairs(reg x) { return _mm512_maskz_permute_pd(0xFF, x, 0x55); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm512_cmp_pd_mask(a, b, _CMP_LE_OQ)); }
+
+          static reg pattern(double p0, double p1) { return _mm512_set4_pd(p1, p0, p1, p0); }
+
+          // expand places consecutive elements into even positions and zeroes the odd ones
+          static reg widen_lo(reg x) { return _mm512_maskz_expand_pd(0x55, x); }
+
+          static reg widen_hi(reg x) {
+            reg hi = _mm512_maskz_shuffle_f64x2(0xFF, x, x, _MM_SHUFFLE(3, 2, 3, 2));
+            return _mm512_maskz_expand_pd(0x55, hi);
+          }
+        };
+
+        template<>
+        struct vector_traits<float> {
+          using reg = __m512;
+          static constexpr size_t width = 16;
+
+          static reg load(const float *p) { return _mm512_loadu_ps(p); }
+
+          static void store(float *p, reg x) { _mm512_storeu_ps(p, x); }
+
+          static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+
+          static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+
+          static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+
+          static reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+
+          static reg max(reg a, reg b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+
+          static reg abs(reg x) { return _mm512_abs_ps(x); }
+
+          static reg swap_pairs(reg x) { return _mm512_maskz_permute_ps(0xFFFF, x, 0xB1); }
+
+          // bit `j` is set when `a[j] <= b[j]`
+          static unsigned le_mask(reg a, reg b) { return unsigned(_mm512_cmp_ps_mask(a, b, _CMP_LE_OQ)); }
+
+          static reg pattern(float p0, float p1) { return _mm512_set4_ps(p1, p0, p1, p0); }
+
+          static reg widen_lo(reg x) { return _mm512_maskz_expand_ps(0x5555, x); }
+
+          static reg widen_hi(reg x) {
+            reg hi = _mm512_maskz_shuffle_f32x4(0xFFFF, x, x, _MM_SHUFFLE(3, 2, 3, 2));
+            return _mm512_maskz_expand_ps(0x5555, hi);
+          }
+        };
+
+#include <ndarray/simd_kernels.h>
+
+      }
+#pragma GCC pop_options
+
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+// Dispatch of a kernel to the instruction set selected by set_simd_level
+#if NDARRAY_SIMD_X86
+#define NDARRAY_SIMD_DISPATCH(kernel, ...)                 \
+      switch (get_simd_level()) {                          \
+        case simd_level::avx512:                           \
+          return avx512::kernel(__VA_ARGS__);              \
+        case simd_level::avx2:                             \
+          return avx2::kernel(__VA_ARGS__);                \
+        case simd_level::sse2:                             \
+          return sse2::kernel(__VA_ARGS__);                \
+        default:                                           \
+          return scalar::kernel(__VA_ARGS__);              \
+      }
+#else
+#define NDARRAY_SIMD_DISPATCH(kernel, ...) return scalar::kernel(__VA_ARGS__);
+#endif
+
+      template<typename F, typename Op>
+      void binary(Op op, const F *a, const F *b, F *out, size_t n) {
+        NDARRAY_SIMD_DISPATCH(binary, op, a, b, out, n)
+      }
+
+      template<typename F, typename Op>
+      void pattern(Op op, const F *a, F p0, F p1, F *out, size_t n) {
+        NDARRAY_SIMD_DISPATCH(pattern, op, a, p0, p1, out, n)
+      }
+
+      template<typename F, typename Op>
+      void widen_left(Op op, const F *a, const F *b, F *out, size_t n) {
+        NDARRAY_SIMD_DISPATCH(widen_left, op, a, b, out, n)
+      }
+
+      template<typename F, typename Op>
+      void widen_right(Op op, const F *a, const F *b, F *out, size_t n) {
+        NDARRAY_SIMD_DISPATCH(widen_right, op, a, b, out, n)
+      }
+
+      template<typename F, typename Op>
+      void widen_pattern(Op op, const F *a, F p0, F p1, F *out, size_t n) {
+        NDARRAY_SIMD_DISPATCH(widen_pattern, op, a, p0, p1, out, n)
+      }
+
+      template<typename F>
+      void axpy(F alpha, const F *x, F *y, size_t n) {
+        NDARRAY_SIMD_DISPATCH(axpy, alpha, x, y, n)
+      }
+
+      template<typename F>
+      void axpby(F alpha, const F *x, F beta, F *y, size_t n) {
+        NDARRAY_SIMD_DISPATCH(axpby, alpha, x, beta, y, n)
+      }
+
+      template<typename F, typename Term>
+      void accumulate(Term term, const F *a, const F *b, size_t n, F *lanes) {
+        NDARRAY_SIMD_DISPATCH(accumulate, term, a, b, n, lanes)
+      }
+
+      template<typename F, typename Term>
+      void accumulate_compensated(Term term, const F *a, const F *b, size_t n, F *lanes, F *carry) {
+        NDARRAY_SIMD_DISPATCH(accumulate_compensated, term, a, b, n, lanes, carry)
+      }
+
+      template<typename F, typename Term>
+      void max_abs(Term term, const F *a, const F *b, size_t n, F *lanes, F *check) {
+        NDARRAY_SIMD_DISPATCH(max_abs, term, a, b, n, lanes, check)
+      }
+
+      template<typename F>
+      bool close(const F *a, const F *b, size_t n, F rtol, F atol) {
+        NDARRAY_SIMD_DISPATCH(close, a, b, n, rtol, atol)
+      }
+
+#undef NDARRAY_SIMD_DISPATCH
+
+    }
+
+    /**
+     * Real type and number of real components of element types supported by SIMD kernels
+     */
+    template<typename T>
+    struct simd_element {
+      static constexpr bool supported = false;
+      using real = void;
+      static constexpr size_t components = 0;
+    };
+
+    template<typename F>
+    struct simd_real_element {
+      static constexpr bool supported = true;
+      using real = F;
+      static constexpr size_t components = 1;
+    };
+
+    template<typename F>
+    struct simd_complex_element {
+      static constexpr bool supported = true;
+      using real = F;
+      static constexpr size_t components = 2;
+    };
+
+    template<>
+    struct simd_element<float> : simd_real_element<float> {
+    };
+
+    template<>
+    struct simd_element<double> : simd_real_element<double> {
+    };
+
+    template<>
+    struct simd_element<std::complex<float> > : simd_complex_element<float> {
+    };
+
+    template<>
+    struct simd_element<std::complex<double> > : simd_complex_element<double> {
+    };
+
+    /**
+     * Whether `R(a) op R(b)` for elements of types `A` and `B` can be computed by SIMD kernels
+     */
+    template<typename R, typename A, typename B>
+    using simd_compatible = std::integral_constant<bool,
+        simd_element<R>::supported && simd_element<A>::supported && simd_element<B>::supported &&
+        std::is_same<typename simd_element<A>::real, typename simd_element<R>::real>::value &&
+        std::is_same<typename simd_element<B>::real, typename simd_element<R>::real>::value &&
+        simd_element<R>::components == (simd_element<A>::components > simd_element<B>::components ?
+                                        simd_element<A>::components : simd_element<B>::components)>;
+
+    /**
+     * Compute `out[i] = R(a[i]) op R(b[i])` for `n` dense elements with SIMD kernels, large arrays are split
+     * between threads. `out` may coincide with `a` or `b`.
+     *
+     * @param op - `simd::add_tag` or `simd::sub_tag`, or `simd::mul_tag` and `simd::div_tag` for real elements
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename Op, typename R, typename A, typename B>
+    typename std::enable_if<!simd_compatible<R, A, B>::value, bool>::type
+    simd_apply(Op, R *, const A *, const B *, size_t) {
+      return false;
+    }
+
+    template<typename Op, typename R, typename A, typename B>
+    typename std::enable_if<simd_compatible<R, A, B>::value, bool>::type
+    simd_apply(Op op, R *out, const A *a, const B *b, size_t n) {
+      using F = typename simd_element<R>::real;
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        const F *fa = reinterpret_cast<const F *>(a + begin);
+        const F *fb = reinterpret_cast<const F *>(b + begin);
+        F *fout = reinterpret_cast<F *>(out + begin);
+        if (simd_element<A>::components == simd_element<B>::components) {
+          simd::binary(op, fa, fb, fout, (end - begin) * simd_element<R>::components);
+        } else if (simd_element<A>::components == 1) {
+          simd::widen_left(op, fa, fb, fout, end - begin);
+        } else {
+          simd::widen_right(op, fa, fb, fout, end - begin);
+        }
+      });
+      return true;
+    }
+
+    template<typename F>
+    inline void simd_components(F value, F &p0, F &p1) {
+      p0 = value;
+      p1 = value;
+    }
+
+    template<typename F>
+    inline void simd_components(const std::complex<F> &value, F &p0, F &p1) {
+      p0 = value.real();
+      p1 = value.imag();
+    }
+
+    /**
+     * Compute `out[i] = R(a[i]) op R(s)` for `n` dense elements with SIMD kernels. `out` may coincide with `a`.
+     *
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename Op, typename R, typename A, typename S>
+    typename std::enable_if<!simd_compatible<R, A, R>::value, bool>::type
+    simd_apply_scalar(Op, R *, const A *, S, size_t) {
+      return false;
+    }
+
+    template<typename Op, typename R, typename A, typename S>
+    typename std::enable_if<simd_compatible<R, A, R>::value, bool>::type
+    simd_apply_scalar(Op op, R *out, const A *a, S s, size_t n) {
+      using F = typename simd_element<R>::real;
+      F p0, p1;
+      simd_components(R(s), p0, p1);
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        const F *fa = reinterpret_cast<const F *>(a + begin);
+        F *fout = reinterpret_cast<F *>(out + begin);
+        if (simd_element<A>::components == simd_element<R>::components) {
+          simd::pattern(op, fa, p0, p1, fout, (end - begin) * simd_element<R>::components);
+        } else {
+          simd::widen_pattern(op, fa, p0, p1, fout, end - begin);
+        }
+      });
+      return true;
+    }
+
+    /**
+     * Compute `out[i] = a[i] op b[i]` for `n` dense real elements of the same type with SIMD kernels, large arrays
+     * are split between threads. `out` may coincide with `a` or `b`.
+     *
+     * @param op - `simd::mul_tag` or `simd::div_tag`
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename Op, typename R, typename A, typename B>
+    typename std::enable_if<!(simd_element<R>::components == 1 && std::is_same<R, A>::value &&
+                              std::is_same<R, B>::value), bool>::type
+    simd_apply_real(Op, R *, const A *, const B *, size_t) {
+      return false;
+    }
+
+    template<typename Op, typename R, typename A, typename B>
+    typename std::enable_if<simd_element<R>::components == 1 && std::is_same<R, A>::value &&
+                            std::is_same<R, B>::value, bool>::type
+    simd_apply_real(Op op, R *out, const A *a, const B *b, size_t n) {
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        simd::binary(op, a + begin, b + begin, out + begin, end - begin);
+      });
+      return true;
+    }
+
+    /**
+     * Whether a real factor of type `S` scales elements of type `R` in their own precision
+     */
+    template<typename R, typename S>
+    using simd_factor = std::integral_constant<bool, simd_element<R>::supported &&
+                                                     std::is_same<S, typename simd_element<R>::real>::value>;
+
+    /**
+     * Compute `out[i] = a[i] op s` for `n` dense elements and a real factor `s` with SIMD kernels, complex elements
+     * are scaled componentwise. `out` may coincide with `a`.
+     *
+     * @param op - `simd::mul_tag` or `simd::div_tag`
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename Op, typename R, typename S>
+    typename std::enable_if<!simd_factor<R, S>::value, bool>::type
+    simd_scale(Op, R *, const R *, S, size_t) {
+      return false;
+    }
+
+    template<typename Op, typename R, typename S>
+    typename std::enable_if<simd_factor<R, S>::value, bool>::type
+    simd_scale(Op op, R *out, const R *a, S s, size_t n) {
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        simd::pattern(op, reinterpret_cast<const S *>(a + begin), s, s, reinterpret_cast<S *>(out + begin),
+                      (end - begin) * simd_element<R>::components);
+      });
+      return true;
+    }
+
+    /**
+     * Compute `y[i] = y[i] + alpha * x[i]` for `n` dense elements with SIMD kernels
+     *
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename R, typename X, typename S>
+    typename std::enable_if<!(simd_factor<R, S>::value && std::is_same<R, X>::value), bool>::type
+    simd_axpy(S, const X *, R *, size_t) {
+      return false;
+    }
+
+    template<typename R, typename X, typename S>
+    typename std::enable_if<simd_factor<R, S>::value && std::is_same<R, X>::value, bool>::type
+    simd_axpy(S alpha, const X *x, R *y, size_t n) {
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        simd::axpy(alpha, reinterpret_cast<const S *>(x + begin), reinterpret_cast<S *>(y + begin),
+                   (end - begin) * simd_element<R>::components);
+      });
+      return true;
+    }
+
+    /**
+     * Compute `y[i] = alpha * x[i] + beta * y[i]` for `n` dense elements with SIMD kernels
+     *
+     * @return false if the combination of types is not supported by the kernels, nothing is written then
+     */
+    template<typename R, typename X, typename S1, typename S2>
+    typename std::enable_if<!(simd_factor<R, S1>::value && std::is_same<S1, S2>::value &&
+                              std::is_same<R, X>::value), bool>::type
+    simd_axpby(S1, const X *, S2, R *, size_t) {
+      return false;
+    }
+
+    template<typename R, typename X, typename S>
+    typename std::enable_if<simd_factor<R, S>::value && std::is_same<R, X>::value, bool>::type
+    simd_axpby(S alpha, const X *x, S beta, R *y, size_t n) {
+      parallel_for(n, sizeof(R), [=](size_t begin, size_t end) {
+        simd::axpby(alpha, reinterpret_cast<const S *>(x + begin), beta, reinterpret_cast<S *>(y + begin),
+                    (end - begin) * simd_element<R>::components);
+      });
+      return true;
+    }
+  }
+}
+
+#endif //NDARRAY_SIMD_H
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+// Body of SIMD kernels shared by all instruction sets. This file has no include guard: it is included by simd.h
+// once per instruction set, inside a namespace that defines `vector_traits<F>` for `float` and `double`
+// and under the matching target options.
+
+template<typename V>
+inline typename V::reg vector_op(add_tag, typename V::reg a, typename V::reg b) {
+  return V::add(a, b);
+}
+
+template<typename V>
+inline typename V::reg vector_op(sub_tag, typename V::reg a, typename V::reg b) {
+  return V::sub(a, b);
+}
+
+template<typename V>
+inline typename V::reg vector_op(mul_tag, typename V::reg a, typename V::reg b) {
+  return V::mul(a, b);
+}
+
+template<typename V>
+inline typename V::reg vector_op(div_tag, typename V::reg a, typename V::reg b) {
+  return V::div(a, b);
+}
+
+template<typename F, typename Op>
+void binary(Op op, const F *a, const F *b, F *out, size_t n) {
+  using V = vector_traits<F>;
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    V::store(out + i, vector_op<V>(op, V::load(a + i), V::load(b + i)));
+  }
+  scalar::binary(op, a, b, out, n, i);
+}
+
+template<typename F, typename Op>
+void pattern(Op op, const F *a, F p0, F p1, F *out, size_t n) {
+  using V = vector_traits<F>;
+  typename V::reg p = V::pattern(p0, p1);
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    V::store(out + i, vector_op<V>(op, V::load(a + i), p));
+  }
+  scalar::pattern(op, a, p0, p1, out, n, i);
+}
+
+template<typename F, typename Op>
+void widen_left(Op op, const F *a, const F *b, F *out, size_t n) {
+  using V = vector_traits<F>;
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    typename V::reg x = V::load(a + i);
+    V::store(out + 2 * i, vector_op<V>(op, V::widen_lo(x), V::load(b + 2 * i)));
+    V::store(out + 2 * i + V::width, vector_op<V>(op, V::widen_hi(x), V::load(b + 2 * i + V::width)));
+  }
+  scalar::widen_left(op, a, b, out, n, i);
+}
+
+template<typename F, typename Op>
+void widen_right(Op op, const F *a, const F *b, F *out, size_t n) {
+  using V = vector_traits<F>;
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    typename V::reg y = V::load(b + i);
+    typename V::reg lo = vector_op<V>(op, V::load(a + 2 * i), V::widen_lo(y));
+    typename V::reg hi = vector_op<V>(op, V::load(a + 2 * i + V::width), V::widen_hi(y));
+    V::store(out + 2 * i, lo);
+    V::store(out + 2 * i + V::width, hi);
+  }
+  scalar::widen_right(op, a, b, out, n, i);
+}
+
+template<typename F, typename Op>
+void widen_pattern(Op op, const F *a, F p0, F p1, F *out, size_t n) {
+  using V = vector_traits<F>;
+  typename V::reg p = V::pattern(p0, p1);
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    typename V::reg x = V::load(a + i);
+    V::store(out + 2 * i, vector_op<V>(op, V::widen_lo(x), p));
+    V::store(out + 2 * i + V::width, vector_op<V>(op, V::widen_hi(x), p));
+  }
+  scalar::widen_pattern(op, a, p0, p1, out, n, i);
+}
+
+template<typename F>
+void axpy(F alpha, const F *x, F *y, size_t n) {
+  using V = vector_traits<F>;
+  typename V::reg a = V::pattern(alpha, alpha);
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    V::store(y + i, V::add(V::load(y + i), V::mul(a, V::load(x + i))));
+  }
+  scalar::axpy(alpha, x, y, n, i);
+}
+
+template<typename F>
+void axpby(F alpha, const F *x, F beta, F *y, size_t n) {
+  using V = vector_traits<F>;
+  typename V::reg a = V::pattern(alpha, alpha);
+  typename V::reg b = V::pattern(beta, beta);
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    V::store(y + i, V::add(V::mul(a, V::load(x + i)), V::mul(b, V::load(y + i))));
+  }
+  scalar::axpby(alpha, x, beta, y, n, i);
+}
+
+template<typename F>
+inline typename vector_traits<F>::reg vector_term(value_term, const F *a, const F *, size_t i) {
+  return vector_traits<F>::load(a + i);
+}
+
+template<typename F>
+inline typename vector_traits<F>::reg vector_term(square_term, const F *a, const F *, size_t i) {
+  using V = vector_traits<F>;
+  typename V::reg x = V::load(a + i);
+  return V::mul(x, x);
+}
+
+template<typename F>
+inline typename vector_traits<F>::reg vector_term(product_term, const F *a, const F *b, size_t i) {
+  using V = vector_traits<F>;
+  return V::mul(V::load(a + i), V::load(b + i));
+}
+
+template<typename F>
+inline typename vector_traits<F>::reg vector_term(swapped_product_term, const F *a, const F *b, size_t i) {
+  using V = vector_traits<F>;
+  return V::mul(V::load(a + i), V::swap_pairs(V::load(b + i)));
+}
+
+template<typename F>
+inline typename vector_traits<F>::reg vector_term(difference_term, const F *a, const F *b, size_t i) {
+  using V = vector_traits<F>;
+  return V::sub(V::load(a + i), V::load(b + i));
+}
+
+// Reduction kernels keep `reduce_lanes<F>()` partial results in several registers.
+
+template<typename F, typename Term>
+void accumulate(Term term, const F *a, const F *b, size_t n, F *lanes) {
+  using V = vector_traits<F>;
+  constexpr size_t lanes_count = reduce_lanes<F>();
+  constexpr size_t regs = lanes_count / V::width;
+  typename V::reg acc[regs];
+  for (size_t r = 0; r < regs; ++r) {
+    acc[r] = V::load(lanes + r * V::width);
+  }
+  size_t i = 0;
+  for (; i + lanes_count <= n; i += lanes_count) {
+    for (size_t r = 0; r < regs; ++r) {
+      acc[r] = V::add(acc[r], vector_term(term, a, b, i + r * V::width));
+    }
+  }
+  for (size_t r = 0; r < regs; ++r) {
+    V::store(lanes + r * V::width, acc[r]);
+  }
+  scalar::accumulate(term, a, b, n, lanes, i);
+}
+
+template<typename F, typename Term>
+void accumulate_compensated(Term term, const F *a, const F *b, size_t n, F *lanes, F *carry) {
+  using V = vector_traits<F>;
+  constexpr size_t lanes_count = reduce_lanes<F>();
+  constexpr size_t regs = lanes_count / V::width;
+  typename V::reg acc[regs], comp[regs];
+  for (size_t r = 0; r < regs; ++r) {
+    acc[r] = V::load(lanes + r * V::width);
+    comp[r] = V::load(carry + r * V::width);
+  }
+  size_t i = 0;
+  for (; i + lanes_count <= n; i += lanes_count) {
+    for (size_t r = 0; r < regs; ++r) {
+      typename V::reg y = V::sub(vector_term(term, a, b, i + r * V::width), comp[r]);
+      typename V::reg t = V::add(acc[r], y);
+      comp[r] = V::sub(V::sub(t, acc[r]), y);
+      acc[r] = t;
+    }
+  }
+  for (size_t r = 0; r < regs; ++r) {
+    V::store(lanes + r * V::width, acc[r]);
+    V::store(carry + r * V::width, comp[r]);
+  }
+  scalar::accumulate_compensated(term, a, b, n, lanes, carry, i);
+}
+
+template<typename F, typename Term>
+void max_abs(Term term, const F *a, const F *b, size_t n, F *lanes, F *check) {
+  using V = vector_traits<F>;
+  constexpr size_t lanes_count = reduce_lanes<F>();
+  constexpr size_t regs = lanes_count / V::width;
+  typename V::reg acc[regs], nan[regs];
+  for (size_t r = 0; r < regs; ++r) {
+    acc[r] = V::load(lanes + r * V::width);
+    nan[r] = V::load(check + r * V::width);
+  }
+  size_t i = 0;
+  for (; i + lanes_count <= n; i += lanes_count) {
+    for (size_t r = 0; r < regs; ++r) {
+      typename V::reg x = vector_term(term, a, b, i + r * V::width);
+      acc[r] = V::max(acc[r], V::abs(x));
+      nan[r] = V::add(nan[r], V::sub(x, x));
+    }
+  }
+  for (size_t r = 0; r < regs; ++r) {
+    V::store(lanes + r * V::width, acc[r]);
+    V::store(check + r * V::width, nan[r]);
+  }
+  scalar::max_abs(term, a, b, n, lanes, check, i);
+}
+
+template<typename F>
+bool close(const F *a, const F *b, size_t n, F rtol, F atol) {
+  using V = vector_traits<F>;
+  const unsigned all = (1u << V::width) - 1;
+  typename V::reg r = V::pattern(rtol, rtol);
+  typename V::reg t = V::pattern(atol, atol);
+  typename V::reg largest = V::pattern(std::numeric_limits<F>::max(), std::numeric_limits<F>::max());
+  size_t i = 0;
+  for (; i + V::width <= n; i += V::width) {
+    typename V::reg x = V::load(a + i);
+    typename V::reg y = V::load(b + i);
+    typename V::reg y_abs = V::abs(y);
+    typename V::reg limit = V::add(t, V::mul(r, y_abs));
+    // vectors with failed comparisons or with infinite `y` are checked element by element
+    if ((V::le_mask(V::abs(V::sub(x, y)), limit) & V::le_mask(y_abs, largest)) != all &&
+        !scalar::close(a, b, i + V::width, rtol, atol, i)) {
+      return false;
+    }
+  }
+  return scalar::close(a, b, n, rtol, atol, i);
+}
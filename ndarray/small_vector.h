@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_SMALL_VECTOR_H
+#define NDARRAY_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Rank up to which shape and strides of ndarray are stored inline, larger ranks fall back to the heap
+ */
+#ifndef NDARRAY_INLINE_RANK
+#define NDARRAY_INLINE_RANK 8
+#endif
+
+namespace ndarray {
+
+  /**
+   * Vector of trivially copyable elements that keeps up to `N` elements inline and only allocates
+   * when it grows beyond that. Used for shape and strides metadata.
+   *
+   * @tparam T - type of an element
+   * @tparam N - number of inline elements
+   */
+  template<typename T, size_t N>
+  class small_vector {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+  public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    small_vector() : size_(0), capacity_(N), data_(inline_) {}
+
+    explicit small_vector(size_t n, const T &value = T()) : small_vector() {
+      resize(n, value);
+    }
+
+    template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+    small_vector(InputIt first, InputIt last) : small_vector() {
+      assign(first, last);
+    }
+
+    small_vector(std::initializer_list<T> list) : small_vector() {
+      assign(list.begin(), list.end());
+    }
+
+    small_vector(const std::vector<T> &rhs) : small_vector() {
+      assign(rhs.begin(), rhs.end());
+    }
+
+    small_vector(const small_vector &rhs) : small_vector() {
+      assign(rhs.begin(), rhs.end());
+    }
+
+    small_vector(small_vector &&rhs) noexcept : small_vector() {
+      if (rhs.data_ == rhs.inline_) {
+        std::copy(rhs.begin(), rhs.end(), inline_);
+      } else {
+        data_ = rhs.data_;
+        capacity_ = rhs.capacity_;
+        rhs.data_ = rhs.inline_;
+        rhs.capacity_ = N;
+      }
+      size_ = rhs.size_;
+      rhs.size_ = 0;
+    }
+
+    small_vector &operator=(const small_vector &rhs) {
+      if (this != &rhs) {
+        assign(rhs.begin(), rhs.end());
+      }
+      return *this;
+    }
+
+    small_vector &operator=(small_vector &&rhs) noexcept {
+      if (this != &rhs) {
+        release();
+        if (rhs.data_ == rhs.inline_) {
+          std::copy(rhs.begin(), rhs.end(), inline_);
+        } else {
+          data_ = rhs.data_;
+          capacity_ = rhs.capacity_;
+          rhs.data_ = rhs.inline_;
+          rhs.capacity_ = N;
+        }
+        size_ = rhs.size_;
+        rhs.size_ = 0;
+      }
+      return *this;
+    }
+
+    ~small_vector() {
+      release();
+    }
+
+    /**
+     * Conversion into std::vector
+     */
+    operator std::vector<T>() const {
+      return std::vector<T>(begin(), end());
+    }
+
+    template<typename InputIt>
+    void assign(InputIt first, InputIt last) {
+      size_t n = size_t(std::distance(first, last));
+      size_ = 0;
+      reserve(n);
+      std::copy(first, last, data_);
+      size_ = n;
+    }
+
+    void reserve(size_t n) {
+      if (n <= capacity_) {
+        return;
+      }
+      T *data = new T[n];
+      std::copy(begin(), end(), data);
+      release();
+      data_ = data;
+      capacity_ = n;
+    }
+
+    void resize(size_t n, const T &value = T()) {
+      // `value` may refer to an element that is freed by the reallocation
+      T copy = value;
+      reserve(n);
+      if (n > size_) {
+        std::fill(data_ + size_, data_ + n, copy);
+      }
+      size_ = n;
+    }
+
+    void push_back(const T &value) {
+      T copy = value;
+      if (size_ == capacity_) {
+        reserve(2 * capacity_);
+      }
+      data_[size_++] = copy;
+    }
+
+    void pop_back() {
+      --size_;
+    }
+
+    template<typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+      size_t at = size_t(pos - data_);
+      // the range may point into this vector, it is copied before elements are moved or reallocated
+      small_vector values(first, last);
+      size_t n = values.size();
+      reserve(size_ + n);
+      std::copy_backward(data_ + at, data_ + size_, data_ + size_ + n);
+      std::copy(values.begin(), values.end(), data_ + at);
+      size_ += n;
+      return data_ + at;
+    }
+
+    void clear() {
+      size_ = 0;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    T *data() {
+      return data_;
+    }
+
+    const T *data() const {
+      return data_;
+    }
+
+    iterator begin() {
+      return data_;
+    }
+
+    const_iterator begin() const {
+      return data_;
+    }
+
+    iterator end() {
+      return data_ + size_;
+    }
+
+    const_iterator end() const {
+      return data_ + size_;
+    }
+
+    T &operator[](size_t i) {
+      return data_[i];
+    }
+
+    const T &operator[](size_t i) const {
+      return data_[i];
+    }
+
+    T &front() {
+      return data_[0];
+    }
+
+    const T &front() const {
+      return data_[0];
+    }
+
+    T &back() {
+      return data_[size_ - 1];
+    }
+
+    const T &back() const {
+      return data_[size_ - 1];
+    }
+
+  private:
+    void release() {
+      if (data_ != inline_) {
+        delete[] data_;
+        data_ = inline_;
+        capacity_ = N;
+      }
+    }
+
+    size_t size_;
+    size_t capacity_;
+    T *data_;
+    T inline_[N];
+  };
+
+  template<typename T, size_t N, typename Container>
+  bool operator==(const small_vector<T, N> &lhs, const Container &rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+
+  template<typename T, size_t N>
+  bool operator==(const std::vector<T> &lhs, const small_vector<T, N> &rhs) {
+    return rhs == lhs;
+  }
+
+  template<typename T, size_t N, typename Container>
+  bool operator!=(const small_vector<T, N> &lhs, const Container &rhs) {
+    return !(lhs == rhs);
+  }
+
+  template<typename T, size_t N>
+  bool operator!=(const std::vector<T> &lhs, const small_vector<T, N> &rhs) {
+    return !(rhs == lhs);
+  }
+
+  /**
+   * Container for shape and strides of ndarray
+   */
+  using shape_t = small_vector<size_t, NDARRAY_INLINE_RANK>;
+
+}
+
+#endif //NDARRAY_SMALL_VECTOR_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_STRIDED_LOOP_H
+#define NDARRAY_STRIDED_LOOP_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include <ndarray/parallel.h>
+#include <ndarray/small_vector.h>
+
+namespace ndarray {
+
+  namespace detail {
+
+    /**
+     * Odometer over a set of dimensions shared by two strided operands. Offsets of both operands
+     * are updated incrementally, so no division is needed while walking.
+     */
+    struct strided_counter {
+      small_vector<size_t, NDARRAY_INLINE_RANK> extents;
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> strides_a;
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> strides_b;
+      small_vector<size_t, NDARRAY_INLINE_RANK> index;
+      std::ptrdiff_t offset_a = 0;
+      std::ptrdiff_t offset_b = 0;
+
+      void add(size_t extent, std::ptrdiff_t stride_a, std::ptrdiff_t stride_b) {
+        extents.push_back(extent);
+        strides_a.push_back(stride_a);
+        strides_b.push_back(stride_b);
+        index.push_back(0);
+      }
+
+      size_t count() const {
+        size_t c = 1;
+        for (size_t e : extents) c *= e;
+        return c;
+      }
+
+      /**
+       * Move to the `position`-th index in row-major order
+       */
+      void seek(size_t position) {
+        offset_a = 0;
+        offset_b = 0;
+        for (size_t k = extents.size(); k > 0; --k) {
+          size_t d = k - 1;
+          index[d] = position % extents[d];
+          position /= extents[d];
+          offset_a += strides_a[d] * std::ptrdiff_t(index[d]);
+          offset_b += strides_b[d] * std::ptrdiff_t(index[d]);
+        }
+      }
+
+      void next() {
+        for (size_t k = extents.size(); k > 0; --k) {
+          size_t d = k - 1;
+          offset_a += strides_a[d];
+          offset_b += strides_b[d];
+          if (++index[d] < extents[d]) {
+            return;
+          }
+          offset_a -= strides_a[d] * std::ptrdiff_t(extents[d]);
+          offset_b -= strides_b[d] * std::ptrdiff_t(extents[d]);
+          index[d] = 0;
+        }
+      }
+    };
+
+    /**
+     * Walk over all elements of two operands of the same `shape` in row-major order and call `f(a_i, b_i)`.
+     * Dimensions that are contiguous in both operands are fused, innermost dimension is walked by a plain loop.
+     *
+     * @param shape - shape of both operands
+     * @param a - pointer to the first element of the first operand
+     * @param sa - strides of the first operand (in elements, negative strides are stored modulo 2^64)
+     * @param b - pointer to the first element of the second operand
+     * @param sb - strides of the second operand
+     * @param f - binary callable
+     */
+    template<typename Shape, typename StridesA, typename StridesB, typename A, typename B, typename F>
+    void strided_for_each(const Shape &shape, A *a, const StridesA &sa, B *b, const StridesB &sb, F f) {
+      small_vector<size_t, NDARRAY_INLINE_RANK> extents;
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> da;
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> db;
+      for (size_t k = 0; k < shape.size(); ++k) {
+        size_t n = shape[k];
+        if (n == 0) {
+          return;
+        }
+        if (n == 1) {
+          continue;
+        }
+        std::ptrdiff_t ska = std::ptrdiff_t(sa[k]);
+        std::ptrdiff_t skb = std::ptrdiff_t(sb[k]);
+        if (!extents.empty() && da.back() == ska * std::ptrdiff_t(n) && db.back() == skb * std::ptrdiff_t(n)) {
+          extents.back() *= n;
+          da.back() = ska;
+          db.back() = skb;
+        } else {
+          extents.push_back(n);
+          da.push_back(ska);
+          db.push_back(skb);
+        }
+      }
+      if (extents.empty()) {
+        f(*a, *b);
+        return;
+      }
+      size_t inner = extents.size() - 1;
+      size_t n = extents[inner];
+      std::ptrdiff_t ia = da[inner];
+      std::ptrdiff_t ib = db[inner];
+      strided_counter counter;
+      for (size_t d = 0; d < inner; ++d) {
+        counter.add(extents[d], da[d], db[d]);
+      }
+      for (size_t it = 0, rows = counter.count(); it < rows; ++it, counter.next()) {
+        A *pa = a + counter.offset_a;
+        B *pb = b + counter.offset_b;
+        if (ia == 1 && ib == 1) {
+          for (size_t j = 0; j < n; ++j) {
+            f(pa[j], pb[j]);
+          }
+        } else {
+          for (size_t j = 0; j < n; ++j) {
+            f(pa[std::ptrdiff_t(j) * ia], pb[std::ptrdiff_t(j) * ib]);
+          }
+        }
+      }
+    }
+
+    /**
+     * Walk over all elements of a strided operand in row-major order and call `f(a_i)`.
+     */
+    template<typename Shape, typename Strides, typename A, typename F>
+    void strided_for_each(const Shape &shape, A *a, const Strides &sa, F f) {
+      strided_for_each(shape, a, sa, a, sa, [&f](A &x, A &) { f(x); });
+    }
+
+    /**
+     * Multithreaded version of `strided_for_each`, operands are split into blocks by `parallel_blocks`.
+     * `f` is copied for every block and has to be safe to call concurrently for different elements.
+     */
+    template<typename Shape, typename StridesA, typename StridesB, typename A, typename B, typename F>
+    void parallel_strided_for_each(const Shape &shape, A *a, const StridesA &sa, B *b, const StridesB &sb, F f) {
+      parallel_blocks(shape, sizeof(A), [&](const Shape &first, const Shape &block) {
+        std::ptrdiff_t da = 0;
+        std::ptrdiff_t db = 0;
+        for (size_t k = 0; k < first.size(); ++k) {
+          da += std::ptrdiff_t(first[k]) * std::ptrdiff_t(sa[k]);
+          db += std::ptrdiff_t(first[k]) * std::ptrdiff_t(sb[k]);
+        }
+        strided_for_each(block, a + da, sa, b + db, sb, f);
+      });
+    }
+
+    template<typename Shape, typename Strides, typename A, typename F>
+    void parallel_strided_for_each(const Shape &shape, A *a, const Strides &sa, F f) {
+      parallel_strided_for_each(shape, a, sa, a, sa, [f](A &x, A &) { f(x); });
+    }
+
+    /**
+     * Evaluate an elementwise expression into a strided destination, calling `f(out_i, value_i)` for every element.
+     * Expression has to provide `shape()`, `contiguous()` and `operator[]` for the linear walk, and `seek(index)`,
+     * `eval(j)` for the row-wise walk over non-contiguous operands. Large expressions are evaluated by several
+     * threads, every thread walks its own copy of the expression.
+     *
+     * @param out - pointer to the first element of the destination
+     * @param out_strides - strides of the destination
+     * @param out_contiguous - whether destination is dense row-major
+     * @param e - expression
+     * @param f - binary callable
+     */
+    template<typename T, typename Strides, typename E, typename F>
+    void evaluate_expression(T *out, const Strides &out_strides, bool out_contiguous, const E &e, F f) {
+      const auto &shape = e.shape();
+      size_t size = 1;
+      for (size_t k = 0; k < shape.size(); ++k) {
+        size *= shape[k];
+      }
+      if (size == 0) {
+        return;
+      }
+      if (shape.empty() || (out_contiguous && e.contiguous())) {
+        parallel_for(size, sizeof(T), [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            f(out[i], e[i]);
+          }
+        });
+        return;
+      }
+      size_t inner = shape.size() - 1;
+      size_t n = shape[inner];
+      std::ptrdiff_t step = std::ptrdiff_t(out_strides[inner]);
+      if (inner == 0) {
+        parallel_for(n, sizeof(T), [&](size_t begin, size_t end) {
+          E local(e);
+          local.seek(nullptr);
+          for (size_t j = begin; j < end; ++j) {
+            f(out[std::ptrdiff_t(j) * step], local.eval(j));
+          }
+        });
+        return;
+      }
+      // rows are chunked in the flattened index space, so that all threads are used for any leading extent
+      parallel_for(size, sizeof(T), [&](size_t begin, size_t end) {
+        E local(e);
+        strided_counter counter;
+        for (size_t d = 0; d < inner; ++d) {
+          counter.add(shape[d], std::ptrdiff_t(out_strides[d]), 0);
+        }
+        counter.seek(begin / n);
+        for (size_t j0 = begin % n; begin < end; j0 = 0, counter.next()) {
+          size_t j1 = std::min(n, j0 + (end - begin));
+          local.seek(counter.index.data());
+          T *row = out + counter.offset_a;
+          for (size_t j = j0; j < j1; ++j) {
+            f(row[std::ptrdiff_t(j) * step], local.eval(j));
+          }
+          begin += j1 - j0;
+        }
+      });
+    }
+
+  }
+}
+
+#endif //NDARRAY_STRIDED_LOOP_H
@@ -33,5 +33,21 @@ namespace ndarray {
     return !std::regex_search(s, m, non_latin);
   }
 
+  namespace detail {
+
+    /**
+     * Text representation of a shape for error messages, e.g. "(2, 3, 4)"
+     */
+    template<typename Shape>
+    std::string shape_string(const Shape &shape) {
+      std::string result = "(";
+      for (size_t k = 0; k < shape.size(); ++k) {
+        result += (k == 0 ? "" : ", ") + std::to_string(shape[k]);
+      }
+      return result + ")";
+    }
+
+  }
+
 }
 #endif //NDARRAY_STRING_UTILS_H
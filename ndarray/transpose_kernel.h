@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#ifndef NDARRAY_TRANSPOSE_KERNEL_H
+#define NDARRAY_TRANSPOSE_KERNEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+#include <ndarray/strided_loop.h>
+
+namespace ndarray {
+
+  namespace detail {
+
+    /**
+     * Side of a square tile (in elements) used by the blocked transpose. Chosen so that
+     * a source and a destination tile together stay well inside L1 cache.
+     *
+     * @tparam T - type of an element
+     */
+    template<typename T>
+    constexpr size_t transpose_tile() {
+      return sizeof(T) <= 4 ? 64 : (sizeof(T) <= 8 ? 32 : 16);
+    }
+
+    /**
+     * Layout of a permuted copy. Destination is always dense row-major, source is described by
+     * an arbitrary stride for every destination dimension. Unit dimensions are dropped and
+     * neighbouring dimensions that are contiguous in both source and destination are fused,
+     * so that "ijkl->jikl" is executed as a rank-3 problem.
+     */
+    struct transpose_layout {
+      // fused destination shape
+      small_vector<size_t, NDARRAY_INLINE_RANK> shape;
+      // source stride for every fused destination dimension
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> src_strides;
+      // destination strides of fused dimensions
+      small_vector<std::ptrdiff_t, NDARRAY_INLINE_RANK> dst_strides;
+      // total number of elements
+      size_t size;
+      // dimension tiled against the innermost one, the one with the smallest source stride
+      size_t tile_axis;
+    };
+
+    /**
+     * Build layout for copying a source with strides `src_strides` into a dense array of shape `dst_shape`.
+     *
+     * @param dst_shape - shape of the destination
+     * @param src_strides - stride of the source along each of the destination dimensions
+     * @return fused layout
+     */
+    template<typename Shape, typename Strides>
+    transpose_layout make_transpose_layout(const Shape &dst_shape, const Strides &src_strides) {
+      transpose_layout layout;
+      layout.size = 1;
+      for (size_t i = 0; i < dst_shape.size(); ++i) {
+        size_t extent = dst_shape[i];
+        std::ptrdiff_t stride = std::ptrdiff_t(src_strides[i]);
+        layout.size *= extent;
+        if (extent == 1) {
+          continue;
+        }
+        if (!layout.shape.empty() && layout.src_strides.back() == stride * std::ptrdiff_t(extent)) {
+          layout.shape.back() *= extent;
+          layout.src_strides.back() = stride;
+        } else {
+          layout.shape.push_back(extent);
+          layout.src_strides.push_back(stride);
+        }
+      }
+      layout.dst_strides.resize(layout.shape.size());
+      std::ptrdiff_t stride = 1;
+      for (size_t k = layout.shape.size(); k > 0; --k) {
+        layout.dst_strides[k - 1] = stride;
+        stride *= std::ptrdiff_t(layout.shape[k - 1]);
+      }
+      layout.tile_axis = 0;
+      for (size_t d = 1; d + 1 < layout.shape.size(); ++d) {
+        if (std::abs(layout.src_strides[d]) < std::abs(layout.src_strides[layout.tile_axis])) {
+          layout.tile_axis = d;
+        }
+      }
+      return layout;
+    }
+
+    /**
+     * Blocked copy of a 2D `rows x cols` block, where destination rows are contiguous.
+     */
+    template<typename T, typename T2>
+    void transpose_tile_2d(const T2 *src, T *dst, size_t rows, size_t cols,
+                           std::ptrdiff_t src_row_stride, std::ptrdiff_t src_col_stride, std::ptrdiff_t dst_row_stride) {
+      const size_t tile = transpose_tile<T>();
+      for (size_t ib = 0; ib < rows; ib += tile) {
+        size_t ie = std::min(rows, ib + tile);
+        for (size_t jb = 0; jb < cols; jb += tile) {
+          size_t je = std::min(cols, jb + tile);
+          for (size_t i = ib; i < ie; ++i) {
+            const T2 *s = src + std::ptrdiff_t(i) * src_row_stride + std::ptrdiff_t(jb) * src_col_stride;
+            T *d = dst + std::ptrdiff_t(i) * dst_row_stride;
+            for (size_t j = jb; j < je; ++j, s += src_col_stride) {
+              d[j] = *s;
+            }
+          }
+        }
+      }
+    }
+
+    /**
+     * Execute permuted copy described by `layout` from `src` into dense `dst`.
+     *
+     * Innermost destination dimension that is also contiguous in the source is copied row by row.
+     * Otherwise the innermost destination dimension is tiled against the destination dimension with
+     * the smallest source stride, and the remaining dimensions are walked by an odometer.
+     *
+     * @param layout - fused layout of the copy
+     * @param src - pointer to the first element of the source
+     * @param dst - pointer to the first element of the dense destination
+     */
+    template<typename T, typename T2>
+    void transpose_execute(const transpose_layout &layout, const T2 *src, T *dst) {
+      if (layout.size == 0) {
+        return;
+      }
+      size_t rank = layout.shape.size();
+      if (rank == 0) {
+        *dst = *src;
+        return;
+      }
+      size_t inner = rank - 1;
+      size_t cols = layout.shape[inner];
+      std::ptrdiff_t col_stride = layout.src_strides[inner];
+      if (rank == 1) {
+        if (col_stride == 1) {
+          std::copy(src, src + cols, dst);
+          return;
+        }
+        for (size_t j = 0; j < cols; ++j) {
+          dst[j] = src[std::ptrdiff_t(j) * col_stride];
+        }
+        return;
+      }
+      if (col_stride == 1) {
+        // rows are contiguous in both source and destination
+        strided_counter counter;
+        for (size_t d = 0; d < inner; ++d) {
+          counter.add(layout.shape[d], layout.src_strides[d], layout.dst_strides[d]);
+        }
+        for (size_t it = 0, n = counter.count(); it < n; ++it, counter.next()) {
+          std::copy(src + counter.offset_a, src + counter.offset_a + cols, dst + counter.offset_b);
+        }
+        return;
+      }
+      size_t tile_axis = layout.tile_axis;
+      size_t rows = layout.shape[tile_axis];
+      std::ptrdiff_t row_stride = layout.src_strides[tile_axis];
+      std::ptrdiff_t dst_row_stride = layout.dst_strides[tile_axis];
+      if (tile_axis + 2 == rank && rank <= 3) {
+        // swap of the last two axes with an optional batch dimension in front
+        size_t batch = rank == 3 ? layout.shape[0] : 1;
+        std::ptrdiff_t src_batch = rank == 3 ? layout.src_strides[0] : 0;
+        std::ptrdiff_t dst_batch = rank == 3 ? layout.dst_strides[0] : 0;
+        for (size_t b = 0; b < batch; ++b) {
+          transpose_tile_2d(src + std::ptrdiff_t(b) * src_batch, dst + std::ptrdiff_t(b) * dst_batch,
+                            rows, cols, row_stride, col_stride, dst_row_stride);
+        }
+        return;
+      }
+      strided_counter counter;
+      for (size_t d = 0; d < inner; ++d) {
+        if (d != tile_axis) {
+          counter.add(layout.shape[d], layout.src_strides[d], layout.dst_strides[d]);
+        }
+      }
+      for (size_t it = 0, n = counter.count(); it < n; ++it, counter.next()) {
+        transpose_tile_2d(src + counter.offset_a, dst + counter.offset_b,
+                          rows, cols, row_stride, col_stride, dst_row_stride);
+      }
+    }
+
+    /**
+     * Layout of the part of a copy described by `layout` that writes block `block` of the fused destination.
+     * Strides are kept, so the block is addressed relative to its first element in the full source and destination.
+     * The tile axis is only chosen again if the block has a single index along it.
+     *
+     * @param layout - fused layout of the whole copy
+     * @param block - shape of the block, of the rank of `layout.shape`
+     * @return layout of the block
+     */
+    template<typename Shape>
+    transpose_layout block_layout(const transpose_layout &layout, const Shape &block) {
+      transpose_layout result(layout);
+      result.size = 1;
+      for (size_t k = 0; k < block.size(); ++k) {
+        result.shape[k] = block[k];
+        result.size *= block[k];
+      }
+      size_t rank = block.size();
+      if (rank > 1 && block[result.tile_axis] == 1) {
+        for (size_t d = 0; d + 1 < rank; ++d) {
+          if (block[d] != 1 && (block[result.tile_axis] == 1 ||
+                                std::abs(layout.src_strides[d]) < std::abs(layout.src_strides[result.tile_axis]))) {
+            result.tile_axis = d;
+          }
+        }
+      }
+      return result;
+    }
+
+    /**
+     * Permuted copy of a strided source into dense `dst` of shape `dst_shape`. Large copies are split between
+     * threads into destination blocks by `parallel_blocks`.
+     *
+     * @param dst_shape - shape of the destination
+     * @param src_strides - stride of the source along each of the destination dimensions
+     * @param src - pointer to the first element of the source
+     * @param dst - pointer to the first element of the dense destination
+     */
+    template<typename Shape, typename Strides, typename T, typename T2>
+    void transpose_copy(const Shape &dst_shape, const Strides &src_strides, const T2 *src, T *dst) {
+      parallel_blocks(dst_shape, sizeof(T), [&](const Shape &first, const Shape &block) {
+        // blocks are dense parts of the destination
+        std::ptrdiff_t src_offset = 0;
+        size_t dst_offset = 0;
+        size_t dst_stride = 1;
+        for (size_t k = first.size(); k > 0; --k) {
+          src_offset += std::ptrdiff_t(first[k - 1]) * std::ptrdiff_t(src_strides[k - 1]);
+          dst_offset += first[k - 1] * dst_stride;
+          dst_stride *= dst_shape[k - 1];
+        }
+        transpose_execute(make_transpose_layout(block, src_strides), src + src_offset, dst + dst_offset);
+      });
+    }
+
+  }
+}
+
+#endif //NDARRAY_TRANSPOSE_KERNEL_H
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <cstdint>
+
+#include <ndarray_math.h>
+
+#include "common.h"
+
+TEST(AllocatorTest, Alignment) {
+  ndarray::ndarray<double> arr1(3, 5, 7);
+  ndarray::ndarray<std::complex<float> > arr2(1);
+  ndarray::ndarray<char> arr3(ndarray::uninitialized, 13);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(arr1.begin()) % ndarray::default_alignment, 0);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(arr2.begin()) % ndarray::default_alignment, 0);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(arr3.begin()) % ndarray::default_alignment, 0);
+}
+
+TEST(AllocatorTest, Counters) {
+  ndarray::reset_allocation_stats();
+  size_t in_use = ndarray::get_allocation_stats().bytes_in_use;
+  {
+    ndarray::ndarray<double> arr1(10, 10);
+    ndarray::ndarray<double> arr2 = arr1(1);
+    ndarray::allocation_stats stats = ndarray::get_allocation_stats();
+    ASSERT_EQ(stats.allocations, 1);
+    ASSERT_EQ(stats.bytes_in_use - in_use, 100 * sizeof(double));
+  }
+  ndarray::allocation_stats stats = ndarray::get_allocation_stats();
+  ASSERT_EQ(stats.deallocations, 1);
+  ASSERT_EQ(stats.bytes_in_use, in_use);
+}
+
+TEST(AllocatorTest, PoolSteadyState) {
+  ndarray::pool_resource pool;
+  ndarray::memory_resource *previous = ndarray::set_default_resource(&pool);
+  ndarray::ndarray<double> a(4, 8, 8);
+  ndarray::ndarray<double> b(4, 8, 8);
+  initialize_array(a);
+  initialize_array(b);
+  size_t system_allocations = 0;
+  for (int it = 0; it < 5; ++it) {
+    if (it == 1) {
+      system_allocations = ndarray::get_allocation_stats().system_allocations;
+    }
+    ndarray::ndarray<double> c = a + b;
+    ndarray::ndarray<double> d = c - 1.0;
+    ndarray::ndarray<double> e = c.copy();
+    ASSERT_NEAR(d(1, 2, 3), a(1, 2, 3) + b(1, 2, 3) - 1.0, 1e-12);
+  }
+  // after the first iteration all buffers and control blocks are recycled
+  ASSERT_EQ(ndarray::get_allocation_stats().system_allocations, system_allocations);
+  ASSERT_GT(pool.cached_bytes(), 0);
+  a = ndarray::ndarray<double>();
+  b = ndarray::ndarray<double>();
+  ndarray::set_default_resource(previous);
+  pool.release();
+  ASSERT_EQ(pool.cached_bytes(), 0);
+}
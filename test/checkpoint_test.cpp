@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <checkpoint.h>
+#include <ndarray_math.h>
+
+#include "common.h"
+
+TEST(CheckpointTest, Snapshots) {
+  ndarray::ndarray<std::complex<double> > g(16, 8, 8);
+  ndarray::ndarray<double> sigma(32, 4);
+  initialize_array(g);
+  initialize_array(sigma);
+  ndarray::ndarray<std::complex<double> > g0 = g.copy();
+  ndarray::ndarray<double> sigma0 = sigma.copy();
+  ndarray::checkpoint_writer writer(1 << 20);
+  std::shared_future<void> first = writer.save(g, temp_file("g"));
+  writer.save(sigma(ndarray::range(ndarray::none, ndarray::none, 2)), temp_file("sigma"));
+  std::shared_future<void> done = writer.barrier();
+  // arrays can be modified as soon as the snapshot is taken
+  g.set_value(0.0);
+  sigma += sigma0;
+  // next checkpoint overlaps with the previous one
+  writer.save(sigma, temp_file("sigma_next"));
+  done.get();
+  first.get();
+  writer.wait();
+  ASSERT_EQ(writer.buffered_bytes(), 0u);
+  ASSERT_TRUE(ndarray::load<std::complex<double> >(temp_file("g")) == g0);
+  ASSERT_TRUE(ndarray::load<double>(temp_file("sigma")) ==
+              ndarray::ndarray<double>(sigma0(ndarray::range(ndarray::none, ndarray::none, 2))));
+  ASSERT_TRUE(ndarray::load<double>(temp_file("sigma_next")) == sigma);
+  for (const char *name : {"g", "sigma", "sigma_next"}) {
+    std::remove(temp_file(name).c_str());
+  }
+}
+
+TEST(CheckpointTest, BoundedMemory) {
+  ndarray::ndarray<double> a(1024);
+  initialize_array(a);
+  const size_t bytes = a.size() * sizeof(double);
+  std::vector<std::shared_future<void> > writes;
+  {
+    // at most two snapshots are waiting at any time
+    ndarray::checkpoint_writer writer(2 * bytes);
+    for (size_t i = 0; i < 8; ++i) {
+      writes.push_back(writer.save(a, temp_file("bounded_" + std::to_string(i))));
+      ASSERT_LE(writer.buffered_bytes(), 2 * bytes);
+      a += a;
+    }
+    // a snapshot larger than the limit is written when nothing else is pending
+    ndarray::ndarray<double> large(4096);
+    writes.push_back(writer.save(large, temp_file("bounded_large")));
+  }
+  // the destructor waits for pending writes
+  for (const std::shared_future<void> &write : writes) {
+    ASSERT_EQ(write.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+  }
+  initialize_array(a);
+  for (size_t i = 0; i < 8; ++i) {
+    std::string filename = temp_file("bounded_" + std::to_string(i));
+    ASSERT_TRUE(ndarray::load<double>(filename) == a);
+    a += a;
+    std::remove(filename.c_str());
+  }
+  std::remove(temp_file("bounded_large").c_str());
+}
+
+TEST(CheckpointTest, Errors) {
+  ndarray::checkpoint_writer writer(1 << 20);
+  ndarray::ndarray<double> a(8);
+  std::shared_future<void> failed = writer.save(a, temp_file("missing_directory/a"));
+  std::shared_future<void> stored = writer.save(a, temp_file("stored"));
+  ASSERT_THROW(failed.get(), std::runtime_error);
+  ASSERT_NO_THROW(stored.get());
+  // the error is reported once by the next barrier
+  ASSERT_THROW(writer.barrier().get(), std::runtime_error);
+  ASSERT_NO_THROW(writer.barrier().get());
+  std::remove(temp_file("stored").c_str());
+}
@@ -6,8 +6,11 @@
 #ifndef NDARRAY_COMMON_H
 #define NDARRAY_COMMON_H
 
+#include <gtest/gtest.h>
+
 #include <ndarray.h>
 #include <random>
+#include <string>
 
 template<typename T>
 inline void initialize_array(ndarray::ndarray<T> &array) {
@@ -21,4 +24,28 @@ inline void initialize_array(ndarray::ndarray<T> &array) {
   );
 }
 
+/**
+ * Force multithreaded execution for arrays of any size within a scope
+ */
+struct parallel_scope {
+  explicit parallel_scope(size_t threads) : threads_(ndarray::set_num_threads(threads)),
+                                            threshold_(ndarray::set_parallel_threshold(0)) {}
+
+  ~parallel_scope() {
+    ndarray::set_num_threads(threads_);
+    ndarray::set_parallel_threshold(threshold_);
+  }
+
+  size_t threads_;
+  size_t threshold_;
+};
+
+/**
+ * Path of a temporary file `name` for the current test suite
+ */
+inline std::string temp_file(const std::string &name) {
+  return ::testing::TempDir() + ::testing::UnitTest::GetInstance()->current_test_info()->test_suite_name() + "_" +
+         name;
+}
+
 #endif //NDARRAY_COMMON_H
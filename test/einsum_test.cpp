@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+
+#include <einsum.h>
+#include <reduction.h>
+
+#include "common.h"
+
+TEST(EinsumTest, MatrixProduct) {
+  ndarray::ndarray<double> a(5, 7);
+  ndarray::ndarray<double> b(7, 3);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> c = ndarray::einsum("ij,jk->ik", a, b);
+  ASSERT_EQ(c.shape(), std::vector<size_t>({5, 3}));
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t k = 0; k < 3; ++k) {
+      double ref = 0;
+      for (size_t j = 0; j < 7; ++j) {
+        ref += a(i, j) * b(j, k);
+      }
+      ASSERT_NEAR(c(i, k), ref, 1e-10);
+    }
+  }
+  // implicit result indices and transposed result
+  ASSERT_TRUE(ndarray::einsum("ij,jk", a, b) == c);
+  ASSERT_TRUE(ndarray::einsum("ij,jk->ki", a, b) == ndarray::transpose(c, "ik->ki"));
+}
+
+TEST(EinsumTest, TensorContraction) {
+  ndarray::ndarray<double> a(3, 4, 5, 6);
+  ndarray::ndarray<double> b(6, 2);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> c = ndarray::einsum("ijkl,lm->ijkm", a, b);
+  ndarray::ndarray<double> d = ndarray::einsum("ijkl,lm->mkji", a, b);
+  ASSERT_EQ(c.shape(), std::vector<size_t>({3, 4, 5, 2}));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      for (size_t k = 0; k < 5; ++k) {
+        for (size_t m = 0; m < 2; ++m) {
+          double ref = 0;
+          for (size_t l = 0; l < 6; ++l) {
+            ref += a(i, j, k, l) * b(l, m);
+          }
+          ASSERT_NEAR(c(i, j, k, m), ref, 1e-10);
+          ASSERT_NEAR(d(m, k, j, i), ref, 1e-10);
+        }
+      }
+    }
+  }
+  // contraction over two indices with strided operands
+  ndarray::ndarray<double> at = ndarray::transpose_view(a, "ijkl->lkji");
+  ndarray::ndarray<double> e = ndarray::einsum("lkji,kl->ij", at, a(0, 0));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      double ref = 0;
+      for (size_t k = 0; k < 5; ++k) {
+        for (size_t l = 0; l < 6; ++l) {
+          ref += a(i, j, k, l) * a(0, 0, k, l);
+        }
+      }
+      ASSERT_NEAR(e(i, j), ref, 1e-9);
+    }
+  }
+}
+
+TEST(EinsumTest, BatchAndOuter) {
+  ndarray::ndarray<double> a(4, 2, 3);
+  ndarray::ndarray<double> b(4, 3, 5);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> c = ndarray::einsum("bij,bjk->bik", a, b);
+  ndarray::ndarray<double> o = ndarray::einsum("bij,bjk->ijbk", a, b);
+  for (size_t q = 0; q < 4; ++q) {
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t k = 0; k < 5; ++k) {
+        double ref = 0;
+        for (size_t j = 0; j < 3; ++j) {
+          ref += a(q, i, j) * b(q, j, k);
+          ASSERT_NEAR(o(i, j, q, k), a(q, i, j) * b(q, j, k), 1e-12);
+        }
+        ASSERT_NEAR(c(q, i, k), ref, 1e-10);
+      }
+    }
+  }
+  ndarray::ndarray<double> x(3);
+  ndarray::ndarray<double> y(4);
+  initialize_array(x);
+  initialize_array(y);
+  ndarray::ndarray<double> xy = ndarray::einsum("i,j->ij", x, y);
+  ASSERT_EQ(xy.shape(), std::vector<size_t>({3, 4}));
+  ASSERT_NEAR(xy(2, 1), x(2) * y(1), 1e-12);
+}
+
+TEST(EinsumTest, ParallelBatch) {
+  // many small matrices are split between threads by batch
+  ndarray::ndarray<double> a(256, 8, 6);
+  ndarray::ndarray<double> b(256, 6, 8);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> expected = ndarray::einsum("bij,bjk->bik", a, b);
+  size_t threads = ndarray::set_num_threads(4);
+  size_t threshold = ndarray::set_parallel_threshold(0);
+  ndarray::ndarray<double> c = ndarray::einsum("bij,bjk->bik", a, b);
+  ndarray::set_num_threads(threads);
+  ndarray::set_parallel_threshold(threshold);
+  ASSERT_EQ(c, expected);
+  ASSERT_TRUE(ndarray::allclose(c, ndarray::matmul(a, b)));
+}
+
+TEST(EinsumTest, DiagonalAndReduction) {
+  ndarray::ndarray<double> a(4, 4);
+  initialize_array(a);
+  ndarray::ndarray<double> trace = ndarray::einsum("ii->", a);
+  ndarray::ndarray<double> diag = ndarray::einsum("ii->i", a);
+  ndarray::ndarray<double> rows = ndarray::einsum("ij->i", a);
+  ASSERT_EQ(trace.dim(), 0ul);
+  double ref = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    ref += a(i, i);
+    ASSERT_NEAR(diag(i), a(i, i), 1e-12);
+    ASSERT_NEAR(rows(i), a(i, 0) + a(i, 1) + a(i, 2) + a(i, 3), 1e-12);
+  }
+  ASSERT_NEAR(*trace.data().get(), ref, 1e-12);
+  // result of a single operand einsum does not share data with the operand
+  ndarray::ndarray<double> same = ndarray::einsum("ij->ij", a);
+  ASSERT_NE(same.data(), a.data());
+  ASSERT_TRUE(same == a);
+}
+
+TEST(EinsumTest, ThreeOperands) {
+  ndarray::ndarray<double> a(3, 20);
+  ndarray::ndarray<double> b(20, 2);
+  ndarray::ndarray<double> c(2, 4);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  ndarray::ndarray<double> abc = ndarray::einsum("ij,jk,kl->il", a, b, c);
+  ndarray::ndarray<double> ref = ndarray::einsum("ik,kl->il", ndarray::einsum("ij,jk->ik", a, b), c);
+  ASSERT_TRUE(abc == ref);
+  // scalar result of a full contraction
+  ndarray::ndarray<double> s = ndarray::einsum("ij,jk,ik->", a, b, ndarray::einsum("ij,jk->ik", a, b));
+  double expected = 0;
+  ndarray::ndarray<double> ab = ndarray::einsum("ij,jk->ik", a, b);
+  for (double v : ab) {
+    expected += v * v;
+  }
+  ASSERT_NEAR(*s.data().get(), expected, 1e-8 * expected);
+}
+
+TEST(EinsumTest, MixedTypes) {
+  ndarray::ndarray<std::complex<double>> a(3, 4);
+  ndarray::ndarray<float> b(4, 2);
+  initialize_array(a);
+  initialize_array(b);
+  a(1, 2) = std::complex<double>(1.0, 2.0);
+  ndarray::ndarray<std::complex<double>> c = ndarray::einsum("ij,jk->ik", a, b);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t k = 0; k < 2; ++k) {
+      std::complex<double> ref = 0;
+      for (size_t j = 0; j < 4; ++j) {
+        ref += a.at(i, j) * double(b.at(j, k));
+      }
+      ASSERT_NEAR(std::abs(c.at(i, k) - ref), 0.0, 1e-10);
+    }
+  }
+}
+
+TEST(EinsumTest, Plan) {
+  ndarray::ndarray<double> a(3, 4, 5);
+  ndarray::ndarray<double> b(5, 4);
+  ndarray::ndarray<double> c(3, 2);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  std::shared_ptr<const ndarray::einsum_plan> plan =
+      ndarray::get_einsum_plan("ijk,kj,il->l", {a.shape(), b.shape(), c.shape()});
+  ASSERT_EQ(plan, ndarray::get_einsum_plan("ijk,kj,il->l", {a.shape(), b.shape(), c.shape()}));
+  ndarray::ndarray<double> r = plan->execute(std::vector<ndarray::ndarray<double>>{a, b, c});
+  ASSERT_TRUE(r == ndarray::einsum("ijk,kj,il->l", a, b, c));
+  for (size_t l = 0; l < 2; ++l) {
+    double ref = 0;
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 4; ++j) {
+        for (size_t k = 0; k < 5; ++k) {
+          ref += a(i, j, k) * b(k, j) * c(i, l);
+        }
+      }
+    }
+    ASSERT_NEAR(r(l), ref, 1e-8 * ref);
+  }
+  ASSERT_THROW(plan->execute(std::vector<ndarray::ndarray<double>>{a, b, b}), std::runtime_error);
+  ASSERT_THROW(ndarray::get_einsum_plan("ijk,kj->i", {a.shape(), c.shape()}), std::runtime_error);
+}
+
+TEST(EinsumTest, Errors) {
+  ndarray::ndarray<double> a(3, 4);
+  ndarray::ndarray<double> b(5, 2);
+  ASSERT_THROW(ndarray::einsum("ij,jk->ik", a, b), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("ij,jk->ik", a), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("ijk->ik", a), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("ij->iq", a), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("ij->ii", a), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("i1->i", a), std::runtime_error);
+  ASSERT_THROW(ndarray::einsum("ii->i", a), std::runtime_error);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+
+#include <fixed_ndarray.h>
+
+#include "common.h"
+
+TEST(FixedNDArrayTest, Init) {
+  ndarray::fixed_ndarray<double, 4> array(2, 3, 4, 5);
+  ASSERT_EQ(array.size(), 2 * 3 * 4 * 5);
+  ASSERT_EQ(array.dim(), 4);
+  ASSERT_EQ(array.strides()[0], 60);
+  ASSERT_EQ(array.strides()[3], 1);
+  ASSERT_EQ(array.shape()[2], 4);
+  ASSERT_TRUE(std::all_of(array.begin(), array.end(), [](double x) {return x == 0.0;}));
+}
+
+TEST(FixedNDArrayTest, ElementAccessAndSlicing) {
+  ndarray::ndarray<double> dynamic(2, 3, 4);
+  initialize_array(dynamic);
+  ndarray::fixed_ndarray<double, 3> array(dynamic);
+  ASSERT_EQ(array(1, 2, 3), dynamic.at(1, 2, 3));
+  ASSERT_EQ(array.at(0, 1, 2), dynamic.at(0, 1, 2));
+  ndarray::fixed_ndarray<double, 2> slice = array(1);
+  ndarray::fixed_ndarray<double, 1> row = array(1, 2);
+  ASSERT_EQ(slice(2, 3), dynamic.at(1, 2, 3));
+  ASSERT_EQ(row(1), dynamic.at(1, 2, 1));
+  // data is shared
+  slice(0, 0) = -3.0;
+  ASSERT_EQ(dynamic.at(1, 0, 0), -3.0);
+  const ndarray::fixed_ndarray<double, 3> &carray = array;
+  ndarray::fixed_ndarray<const double, 1> crow = carray(0, 1);
+  ASSERT_EQ(crow(3), dynamic.at(0, 1, 3));
+#ifndef NDEBUG
+  EXPECT_ANY_THROW(array(2, 0, 0));
+#endif
+}
+
+TEST(FixedNDArrayTest, Conversions) {
+  ndarray::fixed_ndarray<std::complex<double>, 2> array(3, 4);
+  array(1, 2) = std::complex<double>(1.0, 2.0);
+  ndarray::ndarray<std::complex<double> > dynamic = array;
+  ASSERT_EQ(dynamic.shape(), (std::vector<size_t>{3, 4}));
+  ASSERT_EQ(dynamic.at(1, 2), std::complex<double>(1.0, 2.0));
+  ASSERT_EQ(dynamic.data(), array.data());
+  ASSERT_THROW((ndarray::fixed_ndarray<std::complex<double>, 3>(dynamic)), std::runtime_error);
+  // views with real strides keep their layout
+  ndarray::ndarray<std::complex<double> > column = dynamic(ndarray::range(), 2);
+  ndarray::fixed_ndarray<std::complex<double>, 1> fixed_column(column);
+  ASSERT_FALSE(fixed_column.is_contiguous());
+  ASSERT_EQ(fixed_column(1), std::complex<double>(1.0, 2.0));
+#ifndef NDEBUG
+  EXPECT_ANY_THROW(fixed_column.begin());
+#endif
+  ndarray::fixed_ndarray<std::complex<double>, 1> dense = fixed_column.copy();
+  ASSERT_TRUE(dense.is_contiguous());
+  ASSERT_EQ(dense(1), std::complex<double>(1.0, 2.0));
+  ASSERT_EQ(*(dense.begin() + 1), std::complex<double>(1.0, 2.0));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <cstdio>
+#include <string>
+
+#include <mapped_ndarray.h>
+#include <ndarray_math.h>
+
+#include "common.h"
+
+TEST(MappedNDArrayTest, CreateAndOpen) {
+  std::string filename = temp_file("create");
+  ndarray::ndarray<double> values(6, 4, 5);
+  initialize_array(values);
+  {
+    ndarray::mapped_ndarray<double> mapped = ndarray::mapped_ndarray<double>::create(filename, {6, 4, 5});
+    ASSERT_EQ(mapped.shape(), values.shape());
+    // new files are filled with zeros
+    ASSERT_TRUE(mapped.array() == ndarray::ndarray<double>(6, 4, 5));
+    // the existing API operates on the mapped data
+    ndarray::ndarray<double> array = mapped.array();
+    array += values;
+    array *= 2.0;
+    mapped.flush();
+  }
+  // modifications are stored in the file in the native format
+  ndarray::ndarray<double> loaded = ndarray::load<double>(filename);
+  ndarray::mapped_ndarray<double> reopened = ndarray::mapped_ndarray<double>::open(filename);
+  for (size_t i = 0; i < 6; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      for (size_t k = 0; k < 5; ++k) {
+        ASSERT_EQ(loaded.at(i, j, k), 2.0 * values.at(i, j, k));
+        ASSERT_EQ(reopened.array().at(i, j, k), 2.0 * values.at(i, j, k));
+      }
+    }
+  }
+  // slices over leading indices are views of the file that outlive the mapped array object
+  ndarray::ndarray<double> slice = reopened(3);
+  ndarray::ndarray<double> transposed = ndarray::transpose(reopened(1), "ij->ji");
+  reopened = ndarray::mapped_ndarray<double>::open(filename);
+  for (size_t j = 0; j < 4; ++j) {
+    for (size_t k = 0; k < 5; ++k) {
+      ASSERT_EQ(slice.at(j, k), 2.0 * values.at(3, j, k));
+      ASSERT_EQ(transposed.at(k, j), 2.0 * values.at(1, j, k));
+    }
+  }
+  ASSERT_THROW(ndarray::mapped_ndarray<float>::open(filename), std::runtime_error);
+  ASSERT_THROW(ndarray::mapped_ndarray<float>::open(temp_file("missing")), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+TEST(MappedNDArrayTest, Chunks) {
+  std::string filename = temp_file("chunks");
+  ndarray::mapped_ndarray<std::complex<double> > mapped =
+      ndarray::mapped_ndarray<std::complex<double> >::create(filename, {100, 3, 7});
+  mapped.advise(ndarray::access_pattern::sequential);
+  size_t rows = 0;
+  mapped.for_each_chunk(16, [&rows](ndarray::ndarray<std::complex<double> > block, size_t first) {
+    ASSERT_EQ(first, rows);
+    ASSERT_EQ(block.shape()[0], std::min(size_t(16), 100 - first));
+    for (size_t i = 0; i < block.shape()[0]; ++i) {
+      block(i).set_value(std::complex<double>(double(first + i), 1.0));
+    }
+    rows += block.shape()[0];
+  });
+  ASSERT_EQ(rows, 100u);
+  // dropped pages keep the modifications
+  mapped.evict(mapped.array());
+  mapped.prefetch(mapped(ndarray::range(ndarray::none, ndarray::none, -3), 1));
+  mapped.advise(ndarray::access_pattern::normal);
+  for (size_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(mapped.array().at(i, 2, 6), std::complex<double>(double(i), 1.0));
+  }
+  ASSERT_THROW(mapped.evict(ndarray::ndarray<std::complex<double> >(3)), std::runtime_error);
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <ndarray_io.h>
+#include <ndarray_math.h>
+
+#include "common.h"
+
+namespace {
+
+  template<typename T>
+  void check_round_trip(const ndarray::ndarray<T> &array, const std::string &filename) {
+    ndarray::save(array, filename);
+    ndarray::ndarray<T> loaded = ndarray::load<T>(filename);
+    ASSERT_EQ(loaded.shape(), array.shape());
+    ASSERT_TRUE(loaded.is_contiguous());
+    ASSERT_TRUE(loaded == array);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(loaded.begin()) % ndarray::default_alignment, 0u);
+    std::remove(filename.c_str());
+  }
+
+}
+
+TEST(NDArrayIOTest, SaveLoad) {
+  ndarray::ndarray<double> a(4, 5, 6);
+  ndarray::ndarray<std::complex<float> > b(7, 3);
+  ndarray::ndarray<int> c(11);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  check_round_trip(a, temp_file("double"));
+  check_round_trip(b, temp_file("complex"));
+  check_round_trip(c, temp_file("int"));
+  // views are stored as dense arrays
+  check_round_trip(ndarray::ndarray<double>(a(ndarray::range(ndarray::none, ndarray::none, -2), 3)),
+                   temp_file("view"));
+  check_round_trip(ndarray::ndarray<double>(0, 3), temp_file("empty"));
+  // arrays of rank 0 hold a single element
+  ndarray::ndarray<double> scalar = a(1, 2, 3);
+  check_round_trip(scalar, temp_file("scalar"));
+}
+
+TEST(NDArrayIOTest, LoadIsZeroCopy) {
+  std::string filename = temp_file("mapped");
+  ndarray::ndarray<double> a(64, 64);
+  initialize_array(a);
+  ndarray::save(a, filename);
+  ndarray::reset_allocation_stats();
+  ndarray::ndarray<double> loaded = ndarray::load<double>(filename);
+  // no buffer is allocated for the data
+  ASSERT_EQ(ndarray::get_allocation_stats().allocations, 0u);
+  // the mapping outlives the array returned by load
+  ndarray::ndarray<double> row = loaded(5);
+  loaded = ndarray::ndarray<double>();
+  for (size_t j = 0; j < 64; ++j) {
+    ASSERT_EQ(row.at(j), a.at(5, j));
+  }
+  // changes are private to the process
+  row.at(0) = -1.0;
+  ASSERT_EQ(ndarray::load<double>(filename).at(5, 0), a.at(5, 0));
+  std::remove(filename.c_str());
+}
+
+TEST(NDArrayIOTest, Errors) {
+  std::string filename = temp_file("errors");
+  ndarray::ndarray<float> a(3, 4);
+  ndarray::save(a, filename);
+  ASSERT_THROW(ndarray::load<double>(filename), std::runtime_error);
+  ASSERT_THROW(ndarray::load<float>(temp_file("missing")), std::runtime_error);
+  {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << "not an array at all, but long enough for a header of the native format";
+  }
+  ASSERT_THROW(ndarray::load<float>(filename), std::runtime_error);
+  // truncated payload
+  ndarray::save(a, filename);
+  std::string content;
+  {
+    std::ifstream in(filename, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), std::streamsize(content.size() - sizeof(float)));
+  }
+  ASSERT_THROW(ndarray::load<float>(filename), std::runtime_error);
+  // element size that does not match the requested type
+  std::string resized = content;
+  uint32_t item_size = 2;
+  std::memcpy(&resized[offsetof(ndarray::detail::native_header, item_size)], &item_size, sizeof(item_size));
+  {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(resized.data(), std::streamsize(resized.size()));
+  }
+  ASSERT_THROW(ndarray::load<float>(filename), std::runtime_error);
+  // broadcast layout whose number of elements overflows, the header is followed by extents and strides
+  std::string broadcast = content;
+  const uint64_t dims[4] = {uint64_t(1) << 32, uint64_t(1) << 32, 0, 0};
+  std::memcpy(&broadcast[sizeof(ndarray::detail::native_header)], dims, sizeof(dims));
+  {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(broadcast.data(), std::streamsize(broadcast.size()));
+  }
+  ASSERT_THROW(ndarray::load<float>(filename), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+namespace {
+
+  // version 1.0 NumPy file with a given dictionary and payload
+  void write_npy(const std::string &filename, const std::string &dict, const void *data, size_t bytes) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write("\x93NUMPY\x01\x00", 8);
+    char length[2] = {char(dict.size() & 0xff), char(dict.size() >> 8)};
+    out.write(length, 2);
+    out.write(dict.data(), std::streamsize(dict.size()));
+    out.write(static_cast<const char *>(data), std::streamsize(bytes));
+  }
+
+  template<typename T>
+  void check_npy_round_trip(const ndarray::ndarray<T> &array, const std::string &filename) {
+    ndarray::save_npy(array, filename);
+    ndarray::ndarray<T> loaded = ndarray::load_npy<T>(filename);
+    ASSERT_EQ(loaded.shape(), array.shape());
+    ASSERT_TRUE(loaded == array);
+    std::remove(filename.c_str());
+  }
+
+}
+
+TEST(NDArrayIOTest, NpyRoundTrip) {
+  ndarray::ndarray<double> a(4, 5, 6);
+  ndarray::ndarray<std::complex<double> > b(7, 3);
+  ndarray::ndarray<int16_t> c(11);
+  ndarray::ndarray<uint8_t> d(2, 2);
+  ndarray::ndarray<float> e(3, 1, 2);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  initialize_array(d);
+  initialize_array(e);
+  check_npy_round_trip(a, temp_file("a.npy"));
+  check_npy_round_trip(b, temp_file("b.npy"));
+  check_npy_round_trip(c, temp_file("c.npy"));
+  check_npy_round_trip(d, temp_file("d.npy"));
+  check_npy_round_trip(e, temp_file("e.npy"));
+  check_npy_round_trip(ndarray::ndarray<double>(a(1, ndarray::range(ndarray::none, ndarray::none, -2))),
+                       temp_file("view.npy"));
+  check_npy_round_trip(ndarray::ndarray<double>(0, 4), temp_file("empty.npy"));
+  ndarray::ndarray<bool> flags(5);
+  flags.at(1) = true;
+  flags.at(4) = true;
+  check_npy_round_trip(flags, temp_file("bool.npy"));
+}
+
+TEST(NDArrayIOTest, NpyHeader) {
+  std::string filename = temp_file("header.npy");
+  ndarray::ndarray<double> a(2, 3);
+  ndarray::save_npy(a, filename);
+  std::ifstream in(filename, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  // header is padded so that the data is aligned to 64 bytes, as written by NumPy
+  std::string dict = "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }";
+  ASSERT_EQ(content.size(), 128u + 6 * sizeof(double));
+  ASSERT_EQ(content.substr(0, 8), std::string("\x93NUMPY\x01\x00", 8));
+  ASSERT_EQ(size_t(static_cast<unsigned char>(content[8])) + 256 * static_cast<unsigned char>(content[9]), 118u);
+  ASSERT_EQ(content.substr(10, dict.size()), dict);
+  ASSERT_EQ(content[127], '\n');
+  ndarray::save_npy(ndarray::ndarray<std::complex<float> >(3), filename);
+  ASSERT_EQ(ndarray::load_npy<std::complex<float> >(filename).shape(), (std::vector<size_t>{3}));
+  ASSERT_THROW(ndarray::load_npy<std::complex<double> >(filename), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+TEST(NDArrayIOTest, NpyFortranOrder) {
+  std::string filename = temp_file("fortran.npy");
+  // 2 x 3 matrix stored by columns, the header is not padded, so the data is not aligned
+  const double columns[] = {0.0, 10.0, 1.0, 11.0, 2.0, 12.0};
+  write_npy(filename, "{'descr': '<f8', 'fortran_order': True, 'shape': (2, 3), }\n", columns, sizeof(columns));
+  ndarray::ndarray<double> a = ndarray::load_npy<double>(filename);
+  ASSERT_EQ(a.shape(), (std::vector<size_t>{2, 3}));
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(a.at(i, j), 10.0 * i + j);
+    }
+  }
+  // aligned Fortran-ordered data is mapped, rows are strided views
+  std::string dict = "{'descr': '<f8', 'fortran_order': True, 'shape': (2, 3), }";
+  dict.append(128 - 10 - dict.size() - 1, ' ');
+  write_npy(filename, dict + "\n", columns, sizeof(columns));
+  ndarray::ndarray<double> b = ndarray::load_npy<double>(filename);
+  ASSERT_FALSE(b.is_contiguous());
+  ASSERT_TRUE(b == a);
+  // elements in the opposite byte order are rejected
+  write_npy(filename, "{'descr': '>f8', 'fortran_order': False, 'shape': (6,), }\n", columns, sizeof(columns));
+  ASSERT_THROW(ndarray::load_npy<double>(filename), std::runtime_error);
+  // as well as missing data
+  write_npy(filename, "{'descr': '<f8', 'fortran_order': False, 'shape': (7,), }\n", columns, sizeof(columns));
+  ASSERT_THROW(ndarray::load_npy<double>(filename), std::runtime_error);
+  // and shapes whose number of elements overflows
+  write_npy(filename, "{'descr': '<f8', 'fortran_order': False, 'shape': (4294967296, 4294967296, 2), }\n", columns,
+            sizeof(columns));
+  ASSERT_THROW(ndarray::load_npy<double>(filename), std::runtime_error);
+  std::remove(filename.c_str());
+}
+
+TEST(NDArrayIOTest, NpyWriter) {
+  std::string filename = temp_file("stream.npy");
+  ndarray::ndarray<double> block(5, 2, 3);
+  initialize_array(block);
+  {
+    ndarray::npy_writer<double> writer(filename, {2, 3});
+    writer.write(block(0));
+    writer.write(block(ndarray::range(1, 4)));
+    writer.write(block(ndarray::range(4, 5)));
+    ASSERT_EQ(writer.rows(), 5u);
+    ASSERT_THROW(writer.write(ndarray::ndarray<double>(3, 2)), std::runtime_error);
+  }
+  ndarray::ndarray<double> loaded = ndarray::load_npy<double>(filename);
+  ASSERT_EQ(loaded.shape(), (std::vector<size_t>{5, 2, 3}));
+  ASSERT_TRUE(loaded == block);
+  // strided rows, and a file without rows
+  ndarray::npy_writer<double> columns(filename, {5});
+  for (size_t j = 0; j < 3; ++j) {
+    columns.write(block(ndarray::range(), 1, j));
+  }
+  columns.close();
+  ASSERT_THROW(columns.write(block(ndarray::range(), 1, 0)), std::runtime_error);
+  loaded = ndarray::load_npy<double>(filename);
+  ASSERT_EQ(loaded.shape(), (std::vector<size_t>{3, 5}));
+  for (size_t i = 0; i < 5; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(loaded.at(j, i), block.at(i, 1, j));
+    }
+  }
+  ndarray::npy_writer<int>(filename, {4}).close();
+  ASSERT_EQ(ndarray::load_npy<int>(filename).shape(), (std::vector<size_t>{0, 4}));
+  std::remove(filename.c_str());
+}
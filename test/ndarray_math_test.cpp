@@ -5,6 +5,13 @@
 
 #include <gtest/gtest.h>
 
+#include <complex>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
 #include <ndarray_math.h>
 
 #include "common.h"
@@ -127,3 +134,654 @@ TEST(NDArrayTest, Transpose) {
     }
   }
 }
+
+TEST(NDArrayMathTest, TransposeBlocked) {
+  ndarray::ndarray<double> array(3, 37, 41, 2);
+  initialize_array(array);
+  ndarray::ndarray<double> lkji = transpose(array, "ijkl->lkji");
+  ndarray::ndarray<double> ijlk = transpose(array, "ijkl->ijlk");
+  ndarray::ndarray<double> ikjl = transpose(array, "ijkl->ikjl");
+  ndarray::ndarray<double> ijkl = transpose(array, "ijkl->ijkl");
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 37; ++j) {
+      for (size_t k = 0; k < 41; ++k) {
+        for (size_t l = 0; l < 2; ++l) {
+          ASSERT_EQ(array.at(i, j, k, l), lkji.at(l, k, j, i));
+          ASSERT_EQ(array.at(i, j, k, l), ijlk.at(i, j, l, k));
+          ASSERT_EQ(array.at(i, j, k, l), ikjl.at(i, k, j, l));
+          ASSERT_EQ(array.at(i, j, k, l), ijkl.at(i, j, k, l));
+        }
+      }
+    }
+  }
+  // swap of the last two axes of a slice
+  ndarray::ndarray<std::complex<double> > carray(2, 70, 33);
+  initialize_array(carray);
+  ndarray::ndarray<std::complex<double> > slice = carray(1);
+  ndarray::ndarray<std::complex<double> > ji = transpose(slice, "ij->ji");
+  for (size_t i = 0; i < 70; ++i) {
+    for (size_t j = 0; j < 33; ++j) {
+      ASSERT_EQ(slice.at(i, j), ji.at(j, i));
+    }
+  }
+}
+
+TEST(NDArrayMathTest, FusedExpression) {
+  ndarray::ndarray<double> a(2, 3, 4);
+  ndarray::ndarray<float> b(2, 3, 4);
+  ndarray::ndarray<std::complex<double> > c(2, 3, 4);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  ndarray::ndarray<std::complex<double> > r1 = a + b - 2.0 + c;
+  ndarray::ndarray<double> r2 = -(a - b) + 1.5;
+  ndarray::ndarray<double> r3 = a.copy();
+  r3 += a + b;
+  r3 -= -b;
+  for (size_t i = 0; i < a.size(); ++i) {
+    double ab = double(a.begin()[i]) + double(b.begin()[i]);
+    std::complex<double> expected = std::complex<double>(ab - 2.0) + c.begin()[i];
+    ASSERT_EQ(r1.begin()[i], expected);
+    ASSERT_EQ(r2.begin()[i], -(a.begin()[i] - double(b.begin()[i])) + 1.5);
+    ASSERT_EQ(r3.begin()[i], (a.begin()[i] + ab) - double(-b.begin()[i]));
+  }
+  ASSERT_EQ(r1.shape(), a.shape());
+  double value = a(1, 2, 3) + b(1, 2, 3);
+  ASSERT_EQ(value, a.at(1, 2, 3) + double(b.at(1, 2, 3)));
+}
+
+TEST(NDArrayMathTest, StridedViews) {
+  using ndarray::range;
+  ndarray::ndarray<double> a(6, 8, 4);
+  ndarray::ndarray<std::complex<double> > b(6, 8, 4);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> av = a(range(ndarray::none, ndarray::none, -2), range(1, 7), 2);
+  ndarray::ndarray<std::complex<double> > bv = b(range(0, 3), range(0, 6), 1);
+  ndarray::ndarray<std::complex<double> > sum = av + bv - 1.0;
+  ndarray::ndarray<double> neg = -av;
+  ASSERT_EQ(sum.shape(), (std::vector<size_t>{3, 6}));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 6; ++j) {
+      ASSERT_EQ(sum.at(i, j), (std::complex<double>(a.at(5 - 2 * i, j + 1, 2)) + b.at(i, j, 1)) - 1.0);
+      ASSERT_EQ(neg.at(i, j), -a.at(5 - 2 * i, j + 1, 2));
+    }
+  }
+  ASSERT_TRUE(neg == ndarray::ndarray<double>(-av.copy()));
+  ASSERT_FALSE(av == ndarray::ndarray<double>(av.copy() + 1.0));
+  ndarray::ndarray<std::complex<double> > acc = bv.copy();
+  bv += av;
+  bv -= av;
+  ASSERT_TRUE(bv == acc);
+  bv += av + av;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 6; ++j) {
+      ASSERT_NEAR(std::abs(b.at(i, j, 1) - acc.at(i, j) - 2.0 * a.at(5 - 2 * i, j + 1, 2)), 0.0, 1e-12);
+    }
+  }
+  ndarray::ndarray<double> t = transpose(av, "ij->ji");
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 6; ++j) {
+      ASSERT_EQ(t.at(j, i), av.at(i, j));
+    }
+  }
+}
+
+TEST(NDArrayMathTest, TransposeView) {
+  ndarray::ndarray<double> array(3, 4, 5);
+  initialize_array(array);
+  ndarray::ndarray<double> view = transpose_view(array, "ijk->kij");
+  ASSERT_EQ(view.shape(), (std::vector<size_t>{5, 3, 4}));
+  ASSERT_EQ(view.data(), array.data());
+  ASSERT_FALSE(view.is_contiguous());
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      for (size_t k = 0; k < 5; ++k) {
+        ASSERT_EQ(view.at(k, i, j), array.at(i, j, k));
+      }
+    }
+  }
+  // writes through the view are visible in the original array
+  view.at(4, 2, 3) = -1.0;
+  ASSERT_EQ(array.at(2, 3, 4), -1.0);
+  ndarray::ndarray<double> dense = view.contiguous();
+  ASSERT_TRUE(dense.is_contiguous());
+  ASSERT_TRUE(dense == transpose(array, "ijk->kij"));
+  // contiguous array is returned as is
+  ASSERT_EQ(array.contiguous().data(), array.data());
+  // views compose with slicing and arithmetic
+  ndarray::ndarray<double> sum = permute_view(array, {1, 0, 2})(1) + array(ndarray::range(), 1);
+  ASSERT_EQ(sum.at(2, 3), 2 * array.at(2, 1, 3));
+  ASSERT_THROW(permute_view(array, {0, 0, 1}), std::runtime_error);
+  // in-place operations with a view of the destination read it before any element is updated
+  ndarray::ndarray<double> sq(64, 64);
+  initialize_array(sq);
+  ndarray::ndarray<double> expected = sq + transpose(sq, "ij->ji");
+  sq += transpose_view(sq, "ij->ji");
+  ASSERT_TRUE(sq == expected);
+  ndarray::ndarray<double> cube(4, 4, 4);
+  initialize_array(cube);
+  expected = cube - permute_view(cube, {2, 0, 1});
+  cube -= permute_view(cube, {2, 0, 1});
+  ASSERT_TRUE(cube == expected);
+}
+
+TEST(NDArrayMathTest, TransposeHighRank) {
+  ndarray::ndarray<double> array(std::vector<size_t>(10, 2));
+  initialize_array(array);
+  std::vector<size_t> pattern(array.dim());
+  std::iota(pattern.rbegin(), pattern.rend(), 0);
+  ndarray::ndarray<double> reversed = ndarray::permute_view(array, pattern).copy();
+  ASSERT_EQ(reversed.at(1, 0, 0, 0, 0, 0, 0, 0, 0, 0), array.at(0, 0, 0, 0, 0, 0, 0, 0, 0, 1));
+  ASSERT_EQ(reversed.at(0, 1, 1, 0, 0, 0, 0, 0, 0, 1), array.at(1, 0, 0, 0, 0, 0, 0, 1, 1, 0));
+}
+
+TEST(NDArrayMathTest, TransposePlan) {
+  ndarray::ndarray<double> big(10, 4, 5, 6);
+  initialize_array(big);
+  // blocks of a larger array share the layout and therefore the plan
+  std::shared_ptr<const ndarray::transpose_plan> plan = ndarray::get_transpose_plan("ijk->kji", big(0));
+  ASSERT_EQ(plan, ndarray::get_transpose_plan("ijk->kji", big(7)));
+  ASSERT_NE(plan, ndarray::get_transpose_plan("ijk->jki", big(0)));
+  ASSERT_EQ(plan->shape(), std::vector<size_t>({6, 5, 4}));
+  ASSERT_EQ(plan->permutation(), std::vector<size_t>({2, 1, 0}));
+  ndarray::ndarray<double> out(6, 5, 4);
+  for (size_t b = 0; b < 10; ++b) {
+    plan->execute(big(b), out);
+    ASSERT_TRUE(out == ndarray::permute_view(big(b), plan->permutation()));
+    ASSERT_TRUE(plan->execute(big(b)) == ndarray::transpose(big(b), "ijk->kji"));
+  }
+  // strided source has a different plan
+  ndarray::ndarray<double> strided = ndarray::transpose_view(big, "bijk->ibjk")(1);
+  ASSERT_THROW(plan->execute(strided), std::runtime_error);
+  ASSERT_TRUE(ndarray::transpose(strided, "bjk->kjb") == ndarray::permute_view(strided, {2, 1, 0}));
+  ndarray::ndarray<double> wrong(5, 6, 4);
+  ASSERT_THROW(plan->execute(big(0), wrong), std::runtime_error);
+  ASSERT_THROW(ndarray::get_transpose_plan("ijk->kjj", big(0)), std::runtime_error);
+  // plans are shared between threads, clearing the cache also drops the per-thread front caches
+  std::shared_ptr<const ndarray::transpose_plan> other;
+  std::thread([&]() { other = ndarray::get_transpose_plan("ijk->kji", big(3)); }).join();
+  ASSERT_EQ(plan, other);
+  ndarray::detail::transpose_plans().clear();
+  ASSERT_EQ(plan.use_count(), 2);
+  ASSERT_NE(plan, ndarray::get_transpose_plan("ijk->kji", big(0)));
+  ASSERT_EQ(ndarray::detail::transpose_plans().size(), 1u);
+  // a new cache does not see the front cache entries of a destroyed one
+  ndarray::ndarray<double> block = big(0);
+  ndarray::detail::plan_layout layout(block.shape().begin(), block.shape().end());
+  auto make = [&]() { return ndarray::transpose_plan("ijk->kji", block.shape(), block.strides()); };
+  std::shared_ptr<const ndarray::transpose_plan> cached;
+  {
+    ndarray::detail::plan_cache<ndarray::transpose_plan> cache;
+    cached = cache.get("ijk->kji", layout, make);
+    ASSERT_EQ(cached, cache.get("ijk->kji", layout, make));
+  }
+  ndarray::detail::plan_cache<ndarray::transpose_plan> cache;
+  ASSERT_NE(cached, cache.get("ijk->kji", layout, make));
+}
+
+namespace {
+
+  template<typename T>
+  ndarray::ndarray<T> naive_matmul(const ndarray::ndarray<T> &a, const ndarray::ndarray<T> &b) {
+    ndarray::ndarray<T> c(a.shape()[0], b.shape()[1]);
+    for (size_t i = 0; i < a.shape()[0]; ++i) {
+      for (size_t j = 0; j < b.shape()[1]; ++j) {
+        T sum(0);
+        for (size_t p = 0; p < a.shape()[1]; ++p) {
+          sum += a.at(i, p) * b.at(p, j);
+        }
+        c.at(i, j) = sum;
+      }
+    }
+    return c;
+  }
+
+}
+
+namespace {
+
+  template<typename T>
+  void check_gemm_kernel() {
+    ndarray::ndarray<T> a(37, 150);
+    ndarray::ndarray<T> b(150, 301);
+    initialize_array(a);
+    initialize_array(b);
+    ndarray::ndarray<T> ref = naive_matmul(a, b);
+    ndarray::ndarray<T> at = ndarray::transpose(a, "ij->ji");
+    ndarray::ndarray<T> bt = ndarray::transpose(b, "ij->ji");
+    for (bool trans_a : {false, true}) {
+      for (bool trans_b : {false, true}) {
+        ndarray::ndarray<T> c(37, 301);
+        ndarray::detail::gemm_rows(trans_a, trans_b, 0, 37, 301, 150, (trans_a ? at : a).data().get(),
+                                   trans_a ? 37ul : 150ul, (trans_b ? bt : b).data().get(), trans_b ? 150ul : 301ul,
+                                   c.data().get(), 301ul);
+        ASSERT_TRUE(c == ref);
+      }
+    }
+  }
+
+}
+
+TEST(NDArrayMathTest, GemmKernel) {
+  // loop kernel is checked directly, since matmul may dispatch to BLAS
+  check_gemm_kernel<double>();
+  check_gemm_kernel<std::complex<double>>();
+}
+
+TEST(NDArrayMathTest, Matmul) {
+  ndarray::ndarray<double> a(6, 5);
+  ndarray::ndarray<double> b(5, 7);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> ref = naive_matmul(a, b);
+  ASSERT_TRUE(ndarray::matmul(a, b) == ref);
+  // transposed views are passed to the kernel without copies
+  ndarray::ndarray<double> at = ndarray::transpose(a, "ij->ji");
+  ndarray::ndarray<double> bt = ndarray::transpose(b, "ij->ji");
+  ASSERT_TRUE(ndarray::matmul(ndarray::transpose_view(at, "ij->ji"), ndarray::transpose_view(bt, "ij->ji")) == ref);
+  // strided rows and columns are copied
+  ndarray::ndarray<double> big(12, 10);
+  initialize_array(big);
+  ndarray::ndarray<double> strided(big, ndarray::shape_t{6, 5}, ndarray::shape_t{20, 2}, size_t(1));
+  ASSERT_TRUE(ndarray::matmul(strided, b) == naive_matmul(strided.copy(), b));
+  // vectors
+  ndarray::ndarray<double> v(5);
+  initialize_array(v);
+  ndarray::ndarray<double> av = ndarray::matmul(a, v);
+  ndarray::ndarray<double> va = ndarray::matmul(v, b);
+  ASSERT_EQ(av.shape(), std::vector<size_t>({6}));
+  ASSERT_EQ(va.shape(), std::vector<size_t>({7}));
+  for (size_t i = 0; i < 6; ++i) {
+    double sum = 0;
+    for (size_t p = 0; p < 5; ++p) {
+      sum += a(i, p) * v(p);
+    }
+    ASSERT_NEAR(av(i), sum, 1e-10);
+  }
+  for (size_t j = 0; j < 7; ++j) {
+    double sum = 0;
+    for (size_t p = 0; p < 5; ++p) {
+      sum += v(p) * b(p, j);
+    }
+    ASSERT_NEAR(va(j), sum, 1e-10);
+  }
+  // batched product with broadcasting of the batch dimensions
+  ndarray::ndarray<double> stack(3, 6, 5);
+  initialize_array(stack);
+  ndarray::ndarray<double> layer = stack(1);
+  layer += a;
+  ndarray::ndarray<double> sb = ndarray::matmul(stack, b);
+  ASSERT_EQ(sb.shape(), std::vector<size_t>({3, 6, 7}));
+  for (size_t q = 0; q < 3; ++q) {
+    ASSERT_TRUE(sb(q) == naive_matmul(stack(q).copy(), b));
+  }
+  // mixed types
+  ndarray::ndarray<std::complex<double>> z(5, 7);
+  initialize_array(z);
+  ndarray::ndarray<std::complex<double>> az = ndarray::matmul(a, z);
+  ASSERT_TRUE(az == naive_matmul(ndarray::ndarray<std::complex<double>>(a + std::complex<double>(0)), z));
+  ASSERT_THROW(ndarray::matmul(a, a), std::runtime_error);
+}
+
+TEST(NDArrayMathTest, Tensordot) {
+  ndarray::ndarray<double> a(3, 4, 5);
+  ndarray::ndarray<double> b(5, 4, 2);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> c = ndarray::tensordot(a, b, {1, 2}, {1, 0});
+  ASSERT_EQ(c.shape(), std::vector<size_t>({3, 2}));
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t l = 0; l < 2; ++l) {
+      double sum = 0;
+      for (size_t j = 0; j < 4; ++j) {
+        for (size_t k = 0; k < 5; ++k) {
+          sum += a(i, j, k) * b(k, j, l);
+        }
+      }
+      ASSERT_NEAR(c(i, l), sum, 1e-9);
+    }
+  }
+  // contraction over the leading axis of `a` uses it as a transposed matrix
+  ndarray::ndarray<double> d = ndarray::tensordot(a, a, {0}, {0});
+  ASSERT_EQ(d.shape(), std::vector<size_t>({4, 5, 4, 5}));
+  ASSERT_NEAR(d(1, 2, 3, 4), a(0, 1, 2) * a(0, 3, 4) + a(1, 1, 2) * a(1, 3, 4) + a(2, 1, 2) * a(2, 3, 4), 1e-10);
+  ndarray::ndarray<double> m(5, 4);
+  initialize_array(m);
+  ASSERT_TRUE(ndarray::tensordot(m, b, 2) == ndarray::tensordot(m, b, {0, 1}, {0, 1}));
+  ASSERT_TRUE(ndarray::tensordot(a, m, 1) == ndarray::matmul(a, m));
+  ASSERT_THROW(ndarray::tensordot(a, b, {0}, {0}), std::runtime_error);
+  ASSERT_THROW(ndarray::tensordot(a, b, {1, 1}, {1, 0}), std::runtime_error);
+}
+
+namespace {
+
+  template<typename T>
+  T random_value(std::mt19937 &engine, T) {
+    std::uniform_real_distribution<T> dist{-10.0, 10.0};
+    return dist(engine);
+  }
+
+  template<typename T>
+  std::complex<T> random_value(std::mt19937 &engine, std::complex<T>) {
+    std::uniform_real_distribution<T> dist{-10.0, 10.0};
+    T re = dist(engine);
+    return std::complex<T>(re, re < 0 ? T(-0.0) : dist(engine));
+  }
+
+  template<typename T>
+  ndarray::ndarray<T> random_array(size_t n, unsigned seed) {
+    std::mt19937 engine(seed);
+    ndarray::ndarray<T> array(ndarray::uninitialized, n);
+    for (size_t i = 0; i < n; ++i) {
+      array.at(i) = random_value(engine, T());
+    }
+    return array;
+  }
+
+  template<typename T>
+  bool same_bits(const ndarray::ndarray<T> &lhs, const std::vector<T> &rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.begin(), rhs.data(), rhs.size() * sizeof(T)) == 0;
+  }
+
+  template<typename T1, typename T2>
+  void check_simd_add_sub(size_t n) {
+    using result_t = decltype(T1{} + T2{});
+    ndarray::ndarray<T1> a = random_array<T1>(n, 1);
+    ndarray::ndarray<T2> b = random_array<T2>(n, 2);
+    std::mt19937 engine(3);
+    T2 s = random_value(engine, T2());
+    std::vector<result_t> sum(n), diff(n), sum_s(n), diff_s(n);
+    for (size_t i = 0; i < n; ++i) {
+      sum[i] = result_t(a.at(i)) + result_t(b.at(i));
+      diff[i] = result_t(a.at(i)) - result_t(b.at(i));
+      sum_s[i] = result_t(a.at(i)) + result_t(s);
+      diff_s[i] = result_t(a.at(i)) - result_t(s);
+    }
+    for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+      ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+      ASSERT_TRUE(same_bits(ndarray::ndarray<result_t>(a + b), sum));
+      ASSERT_TRUE(same_bits(ndarray::ndarray<result_t>(a - b), diff));
+      ASSERT_TRUE(same_bits(ndarray::ndarray<result_t>(a + s), sum_s));
+      ASSERT_TRUE(same_bits(ndarray::ndarray<result_t>(a - s), diff_s));
+      ndarray::set_simd_level(previous);
+    }
+  }
+
+  template<typename T1, typename T2>
+  void check_simd_inplace(size_t n) {
+    ndarray::ndarray<T1> a = random_array<T1>(n, 1);
+    ndarray::ndarray<T2> b = random_array<T2>(n, 2);
+    std::vector<T1> sum(n), diff(n);
+    for (size_t i = 0; i < n; ++i) {
+      sum[i] = a.at(i) + T1(b.at(i));
+      diff[i] = a.at(i) - T1(b.at(i));
+    }
+    for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+      ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+      ndarray::ndarray<T1> c = a.copy();
+      c += b;
+      ASSERT_TRUE(same_bits(c, sum));
+      c = a.copy();
+      c -= b;
+      ASSERT_TRUE(same_bits(c, diff));
+      ndarray::set_simd_level(previous);
+    }
+  }
+
+  template<typename T1, typename T2>
+  void check_simd_scaling(size_t n) {
+    using real_t = typename ndarray::detail::real_type<T1>::type;
+    ndarray::ndarray<T1> a = random_array<T1>(n, 1);
+    ndarray::ndarray<T2> b = random_array<T2>(n, 2);
+    ndarray::ndarray<T1> x = random_array<T1>(n, 3);
+    const real_t alpha = real_t(0.75), beta = real_t(-1.5);
+    std::vector<T1> product(n), quotient(n), scaled(n), divided(n), axpy(n), axpby(n);
+    for (size_t i = 0; i < n; ++i) {
+      product[i] = a.at(i) * b.at(i);
+      quotient[i] = a.at(i) / b.at(i);
+      scaled[i] = a.at(i) * alpha;
+      divided[i] = a.at(i) / alpha;
+      // library kernels do not fuse products with additions, neither may the reference
+      axpy[i] = a.at(i) + ndarray::detail::uncontracted(alpha * x.at(i));
+      axpby[i] = ndarray::detail::uncontracted(alpha * x.at(i)) + ndarray::detail::uncontracted(beta * a.at(i));
+    }
+    for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+      ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+      ndarray::ndarray<T1> c = a.copy();
+      c *= b;
+      ASSERT_TRUE(same_bits(c, product));
+      c = a.copy();
+      c /= b;
+      ASSERT_TRUE(same_bits(c, quotient));
+      c = a.copy();
+      c *= alpha;
+      ASSERT_TRUE(same_bits(c, scaled));
+      c = a.copy();
+      c /= alpha;
+      ASSERT_TRUE(same_bits(c, divided));
+      c = a.copy();
+      ndarray::axpy(alpha, x, c);
+      ASSERT_TRUE(same_bits(c, axpy));
+      c = a.copy();
+      ndarray::axpby(alpha, x, beta, c);
+      ASSERT_TRUE(same_bits(c, axpby));
+      // strided destinations use the fallback loops, which have to round like the kernels
+      ndarray::ndarray<T1> wide(2 * n);
+      ndarray::ndarray<T1> strided = wide(ndarray::range(0, 2 * n, 2));
+      for (size_t i = 0; i < n; ++i) {
+        strided.at(i) = a.at(i);
+      }
+      ndarray::axpy(alpha, x, strided);
+      ASSERT_TRUE(same_bits(strided.copy(), axpy));
+      for (size_t i = 0; i < n; ++i) {
+        strided.at(i) = a.at(i);
+      }
+      ndarray::axpby(alpha, x, beta, strided);
+      ASSERT_TRUE(same_bits(strided.copy(), axpby));
+      ndarray::set_simd_level(previous);
+    }
+  }
+
+}
+
+TEST(NDArrayMathTest, SimdKernels) {
+  // odd sizes cover vector loops together with scalar tails
+  for (size_t n : {1, 7, 37, 1000}) {
+    check_simd_add_sub<double, double>(n);
+    check_simd_add_sub<float, float>(n);
+    check_simd_add_sub<std::complex<double>, std::complex<double> >(n);
+    check_simd_add_sub<std::complex<float>, std::complex<float> >(n);
+    check_simd_add_sub<double, std::complex<double> >(n);
+    check_simd_add_sub<std::complex<double>, double>(n);
+    check_simd_add_sub<float, std::complex<float> >(n);
+    check_simd_add_sub<std::complex<float>, float>(n);
+    check_simd_inplace<double, double>(n);
+    check_simd_inplace<float, float>(n);
+    check_simd_inplace<std::complex<double>, double>(n);
+    check_simd_inplace<std::complex<float>, std::complex<float> >(n);
+    check_simd_scaling<double, double>(n);
+    check_simd_scaling<float, float>(n);
+    check_simd_scaling<std::complex<double>, double>(n);
+    check_simd_scaling<std::complex<float>, std::complex<float> >(n);
+  }
+}
+
+TEST(NDArrayMathTest, InplaceOverlap) {
+  using ndarray::range;
+  // operands that overlap with the destination are read before any element is updated, as in NumPy,
+  // so the result is the same for every instruction set
+  ndarray::ndarray<double> values(ndarray::uninitialized, 16);
+  std::iota(values.begin(), values.end(), 1.0);
+  std::vector<double> shifted_sum(16), shifted_product(16), shifted_expression(16), reversed_sum(16);
+  for (size_t i = 0; i < 16; ++i) {
+    shifted_sum[i] = i == 0 ? 1.0 : 1.0 + 1.0;
+    shifted_product[i] = i == 0 ? values.at(i) : values.at(i) * values.at(i - 1);
+    shifted_expression[i] = i == 0 ? values.at(i) : values.at(i) - (values.at(i - 1) + 0.5);
+    reversed_sum[i] = values.at(i) + values.at(15 - i);
+  }
+  for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+    ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+    ndarray::ndarray<double> x(16);
+    x.set_value(1.0);
+    x(range(1, 16)) += x(range(0, 15));
+    ASSERT_TRUE(same_bits(x, shifted_sum));
+    x = values.copy();
+    x(range(1, 16)) *= x(range(0, 15));
+    ASSERT_TRUE(same_bits(x, shifted_product));
+    x = values.copy();
+    x(range(1, 16)) -= x(range(0, 15)) + 0.5;
+    ASSERT_TRUE(same_bits(x, shifted_expression));
+    x = values.copy();
+    x += x(range(ndarray::none, ndarray::none, -1));
+    ASSERT_TRUE(same_bits(x, reversed_sum));
+    // an operand referring to the same elements is not copied
+    x = values.copy();
+    x -= x;
+    ASSERT_TRUE(same_bits(x, std::vector<double>(16, 0.0)));
+    ndarray::set_simd_level(previous);
+  }
+  // a broadcast row of the destination
+  ndarray::ndarray<double> m(3, 4);
+  initialize_array(m);
+  ndarray::ndarray<double> expected = m.copy();
+  expected += ndarray::ndarray<double>(m(0).copy());
+  m += m(0);
+  ASSERT_TRUE(m == expected);
+}
+
+TEST(NDArrayMathTest, InplaceScaling) {
+  ndarray::ndarray<double> a(4, 3);
+  ndarray::ndarray<double> b(4, 3);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> c = a.copy();
+  c *= b;
+  c /= 2;
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_DOUBLE_EQ(c.at(i, j), a.at(i, j) * b.at(i, j) / 2);
+    }
+  }
+  // row broadcast against every row of a strided view
+  ndarray::ndarray<double> row(3);
+  initialize_array(row);
+  ndarray::ndarray<double> d = a.copy();
+  ndarray::ndarray<double> column = d(ndarray::range(ndarray::none, ndarray::none), ndarray::range(0, 3, 2));
+  column /= ndarray::ndarray<double>(row(ndarray::range(0, 2)));
+  d(ndarray::range(ndarray::none, ndarray::none), ndarray::range(0, 3, 2)) *= 3.0;
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_DOUBLE_EQ(d.at(i, 0), a.at(i, 0) / row.at(0) * 3.0);
+    ASSERT_DOUBLE_EQ(d.at(i, 1), a.at(i, 1));
+    ASSERT_DOUBLE_EQ(d.at(i, 2), a.at(i, 2) / row.at(1) * 3.0);
+  }
+  // complex arrays by real and complex factors, integer arrays keep integer arithmetic
+  ndarray::ndarray<std::complex<double> > z(5);
+  initialize_array(z);
+  ndarray::ndarray<std::complex<double> > w = z.copy();
+  w *= std::complex<double>(0.0, 2.0);
+  w /= 2.0;
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_EQ(w.at(i), z.at(i) * std::complex<double>(0.0, 2.0) / 2.0);
+  }
+  ndarray::ndarray<int> n(6);
+  for (size_t i = 0; i < 6; ++i) {
+    n.at(i) = int(i) * 3;
+  }
+  n /= 2;
+  ndarray::scale(2, n);
+  for (size_t i = 0; i < 6; ++i) {
+    ASSERT_EQ(n.at(i), int(i) * 3 / 2 * 2);
+  }
+}
+
+TEST(NDArrayMathTest, Axpy) {
+  ndarray::ndarray<double> x(4, 3);
+  ndarray::ndarray<double> y(4, 3);
+  initialize_array(x);
+  initialize_array(y);
+  ndarray::ndarray<double> r = y.copy();
+  ndarray::axpy(2.0, x, r);
+  ndarray::ndarray<double> s = y.copy();
+  ndarray::axpby(2.0, x, -0.5, s);
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_DOUBLE_EQ(r.at(i, j), y.at(i, j) + 2.0 * x.at(i, j));
+      ASSERT_DOUBLE_EQ(s.at(i, j), 2.0 * x.at(i, j) - 0.5 * y.at(i, j));
+    }
+  }
+  // a row broadcast to every row, and a strided destination
+  ndarray::ndarray<double> row(3);
+  initialize_array(row);
+  r = y.copy();
+  ndarray::axpy(-1.0, row, r);
+  ndarray::ndarray<double> t = y.copy();
+  ndarray::axpby(1.0, x(ndarray::range(1, 4, 2)), 3.0, t(ndarray::range(0, 4, 2)));
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_DOUBLE_EQ(r.at(i, j), y.at(i, j) - row.at(j));
+      ASSERT_DOUBLE_EQ(t.at(i, j), i % 2 ? y.at(i, j) : x.at(i + 1, j) + 3.0 * y.at(i, j));
+    }
+  }
+  // real arrays added to complex ones, with complex factors
+  ndarray::ndarray<std::complex<double> > z(4, 3);
+  initialize_array(z);
+  ndarray::ndarray<std::complex<double> > u = z.copy();
+  ndarray::axpby(std::complex<double>(0.0, 1.0), x, 2.0, u);
+  ndarray::scale(0.5, u(ndarray::range(ndarray::none, ndarray::none)));
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(u.at(i, j), (std::complex<double>(0.0, 1.0) * x.at(i, j) + 2.0 * z.at(i, j)) * 0.5);
+    }
+  }
+}
+
+TEST(NDArrayMathTest, Broadcasting) {
+  ndarray::ndarray<double> tensor(5, 3, 3);
+  ndarray::ndarray<double> vector(3);
+  ndarray::ndarray<std::complex<double> > column(5, 1, 1);
+  initialize_array(tensor);
+  initialize_array(vector);
+  initialize_array(column);
+  // missing leading dimensions and unit dimensions are stretched, only the result is allocated
+  ndarray::reset_allocation_stats();
+  ndarray::ndarray<std::complex<double> > result = tensor + vector - column;
+  ASSERT_EQ(ndarray::get_allocation_stats().allocations, 1);
+  ASSERT_EQ(result.shape(), (std::vector<size_t>{5, 3, 3}));
+  for (size_t k = 0; k < 5; ++k) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        ASSERT_EQ(result.at(k, i, j), tensor.at(k, i, j) + vector.at(j) - column.at(k, 0, 0));
+      }
+    }
+  }
+  // both operands stretched
+  ndarray::ndarray<double> row = vector.reshape({1, 3});
+  ndarray::ndarray<double> col = vector.reshape({3, 1});
+  ndarray::ndarray<double> outer = col - row;
+  ASSERT_EQ(outer.shape(), (std::vector<size_t>{3, 3}));
+  ASSERT_EQ(outer.at(2, 0), vector.at(2) - vector.at(0));
+  // stride-0 view
+  ndarray::ndarray<double> stretched = ndarray::broadcast_view(vector, {4, 3});
+  ASSERT_EQ(stretched.strides(), (std::vector<size_t>{0, 1}));
+  ASSERT_EQ(stretched.at(3, 1), vector.at(1));
+  // in-place
+  ndarray::ndarray<double> expected = tensor.copy();
+  for (size_t k = 0; k < 5; ++k) {
+    for (size_t i = 0; i < 3; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        expected.at(k, i, j) += vector.at(j);
+        expected.at(k, i, j) += vector.at(j) - vector.at(j) + 1.0 + vector.at(j);
+      }
+    }
+  }
+  ndarray::ndarray<double> inplace = tensor.copy();
+  inplace += vector;
+  inplace += vector.reshape({1, 3}) - vector + 1.0 + vector;
+  ASSERT_TRUE(inplace == expected);
+  // incompatible shapes
+  ndarray::ndarray<double> wrong(4);
+  ASSERT_THROW(tensor + wrong, std::runtime_error);
+  ASSERT_THROW(vector += tensor, std::runtime_error);
+  ASSERT_THROW(vector += tensor + vector, std::runtime_error);
+}
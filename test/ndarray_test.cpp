@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 
 #include <complex>
+#include <numeric>
 #include <random>
 
 #include <ndarray.h>
@@ -185,4 +186,146 @@ TEST(NDArrayTest, ElementAccess) {
   initialize_array(arr1);
   ndarray::ndarray<double> arr2 = arr1(0,1,2);
   ASSERT_TRUE(arr1.at(0,1,2,1,1) == arr2(1,1));
+  ASSERT_EQ(arr1.ref(0, 1, 2), &arr2.at(0, 0));
+  ASSERT_EQ(*arr1.ref(0, 1, 2, 3, 4), arr1.at(0, 1, 2, 3, 4));
+#if NDARRAY_CHECKED_ACCESS
+  try {
+    arr1.at(0, 1, 3, 0, 0);
+    FAIL();
+  } catch (const ndarray::index_error &e) {
+    ASSERT_EQ(e.axis(), 2);
+    ASSERT_EQ(e.index(), 3);
+    ASSERT_EQ(e.extent(), 3);
+  }
+  ASSERT_THROW(arr1.at(0, 1, 2), std::invalid_argument);
+  ASSERT_THROW(arr1.ref(0, 1, 2, 3, 4, 0), std::invalid_argument);
+#endif
+}
+
+TEST(NDArrayTest, Uninitialized) {
+  ndarray::ndarray<double> array(ndarray::uninitialized, 2, 3, 4);
+  ASSERT_EQ(array.size(), 2 * 3 * 4);
+  ASSERT_EQ(array.strides()[0], 12);
+  std::vector<size_t> shape{3, 5};
+  ndarray::ndarray<std::complex<double> > array2(ndarray::uninitialized, shape);
+  ASSERT_EQ(array2.shape(), shape);
+  array2.set_value(1.0);
+  ASSERT_TRUE(std::all_of(array2.begin(), array2.end(),
+                          [](std::complex<double> x) {return std::abs(x - 1.0) < 1e-12;}));
+}
+
+TEST(NDArrayTest, ExternalBuffer) {
+  std::vector<double> buffer(2 * 3 * 4);
+  std::iota(buffer.begin(), buffer.end(), 0.0);
+  // wrapping keeps content of the buffer
+  ndarray::ndarray<double> array(buffer.data(), std::array<size_t, 3>{{2, 3, 4}});
+  ASSERT_EQ(array.at(1, 2, 3), 23.0);
+  array.at(0, 0, 1) = -1.0;
+  ASSERT_EQ(buffer[1], -1.0);
+
+  // buffer is released by user-supplied deleter
+  bool released = false;
+  {
+    double *data = new double[6]{0, 1, 2, 3, 4, 5};
+    ndarray::ndarray<double> owned(data, std::vector<size_t>{2, 3}, [&released](double *p) {
+      released = true;
+      delete[] p;
+    });
+    ndarray::ndarray<double> slice = owned(1);
+    owned = ndarray::ndarray<double>();
+    ASSERT_FALSE(released);
+    ASSERT_EQ(slice.at(2), 5.0);
+  }
+  ASSERT_TRUE(released);
+
+  // buffer lifetime is tied to ownership token
+  std::shared_ptr<std::vector<double> > owner = std::make_shared<std::vector<double> >(buffer);
+  std::weak_ptr<std::vector<double> > token = owner;
+  ndarray::ndarray<double> shared(owner, owner->data(), std::vector<size_t>{4, 6});
+  owner.reset();
+  ASSERT_FALSE(token.expired());
+  ASSERT_EQ(shared.at(3, 5), 23.0);
+  shared = ndarray::ndarray<double>();
+  ASSERT_TRUE(token.expired());
+}
+
+TEST(NDArrayTest, StridedSlice) {
+  ndarray::ndarray<double> array(4, 6, 5);
+  initialize_array(array);
+  using ndarray::range;
+  // column of a matrix
+  ndarray::ndarray<double> column = array(range(), 2, 3);
+  ASSERT_EQ(column.shape(), std::vector<size_t>{4});
+  ASSERT_EQ(column.strides()[0], 30);
+  ASSERT_FALSE(column.is_contiguous());
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(column.at(i), array.at(i, 2, 3));
+  }
+  // every other element of a sub-block, views share the data
+  ndarray::ndarray<double> block = array.slice(range(1, 3), range(1, ndarray::none, 2));
+  ASSERT_EQ(block.shape(), (std::vector<size_t>{2, 3, 5}));
+  block.at(1, 2, 4) = -1.0;
+  ASSERT_EQ(array.at(2, 5, 4), -1.0);
+  // negative steps and indices
+  ndarray::ndarray<double> reversed = array(range(ndarray::none, ndarray::none, -1), -1, range(3, 0, -2));
+  ASSERT_EQ(reversed.shape(), (std::vector<size_t>{4, 2}));
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(reversed.at(i, 0), array.at(3 - i, 5, 3));
+    ASSERT_EQ(reversed.at(i, 1), array.at(3 - i, 5, 1));
+  }
+  ASSERT_EQ(array(range(10, 20)).size(), 0);
+  ASSERT_THROW(array(range(0, 2, 0)), std::logic_error);
+  // copy makes a contiguous array
+  ndarray::ndarray<double> copy = reversed.copy();
+  ASSERT_TRUE(copy.is_contiguous());
+  ASSERT_EQ(copy.at(2, 1), reversed.at(2, 1));
+  // fill a view
+  ndarray::ndarray<double> odd = array(range(), range(1, ndarray::none, 2));
+  odd.set_value(7.0);
+  ASSERT_EQ(array.at(3, 3, 0), 7.0);
+  ASSERT_NE(array.at(3, 2, 0), 7.0);
+  // const views
+  const ndarray::ndarray<double> &carray = array;
+  ndarray::ndarray<const double> cview = carray(range(), 1);
+  ASSERT_EQ(cview.at(2, 3), array.at(2, 1, 3));
+#ifndef NDEBUG
+  ASSERT_THROW(column.begin(), std::runtime_error);
+#endif
+}
+
+TEST(NDArrayTest, HighRank) {
+  // rank above the default inline capacity keeps shape and strides on the heap
+  std::vector<size_t> shape(10, 2);
+  ndarray::ndarray<double> array(shape);
+  initialize_array(array);
+  ASSERT_EQ(array.shape(), shape);
+  ASSERT_EQ(array.strides().front(), array.size() / 2);
+  ndarray::ndarray<double> sub = array(1, 0);
+  ASSERT_EQ(sub.dim(), shape.size() - 2);
+  ASSERT_EQ(*sub.begin(), array.data().get()[array.size() / 2]);
+  ndarray::ndarray<double> copy = array;
+  ASSERT_EQ(copy.shape(), array.shape());
+  ndarray::ndarray<double> reshaped = array.reshape({4, array.size() / 4});
+  ASSERT_EQ(reshaped.shape(), (std::vector<size_t>{4, array.size() / 4}));
+  ASSERT_EQ(reshaped.strides(), (std::vector<size_t>{array.size() / 4, 1}));
+}
+
+TEST(NDArrayTest, ShapeAliasing) {
+  // elements of the shape itself can be appended and inserted, as with std::vector
+  ndarray::shape_t shape(NDARRAY_INLINE_RANK, 0);
+  std::iota(shape.begin(), shape.end(), size_t(1));
+  std::vector<size_t> expected(shape.begin(), shape.end());
+  // growth from the inline buffer to the heap, then of the heap buffer
+  for (size_t k = 0; k <= NDARRAY_INLINE_RANK; ++k) {
+    shape.push_back(shape[k]);
+    expected.push_back(expected[k]);
+  }
+  ASSERT_EQ(shape, expected);
+  std::vector<size_t> inserted = expected;
+  shape.insert(shape.begin() + 1, shape.begin(), shape.end());
+  expected.insert(expected.begin() + 1, inserted.begin(), inserted.end());
+  ASSERT_EQ(shape, expected);
+  shape.resize(4 * shape.size(), shape[2]);
+  expected.resize(4 * expected.size(), expected[2]);
+  ASSERT_EQ(shape, expected);
 }
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <type_traits>
+
+#include <einsum.h>
+#include <ndarray_view.h>
+#include <reduction.h>
+
+#include "common.h"
+
+static_assert(std::is_trivially_copyable<ndarray::ndarray_view<std::complex<float> > >::value, "");
+static_assert(std::is_trivially_copyable<ndarray::ndarray_view<const int> >::value, "");
+static_assert(!std::is_convertible<ndarray::ndarray_view<double>, ndarray::ndarray<double> >::value, "");
+
+namespace {
+
+  template<typename A, typename B, typename = void>
+  struct has_plus_assign : std::false_type {
+  };
+
+  template<typename A, typename B>
+  struct has_plus_assign<A, B, decltype(void(std::declval<A &>() += std::declval<const B &>()))> : std::true_type {
+  };
+
+}
+
+// adding a scalar to a view fails at compile time instead of in the scalar conversion
+static_assert(has_plus_assign<ndarray::ndarray_view<double>, ndarray::ndarray<double> >::value, "");
+static_assert(!has_plus_assign<ndarray::ndarray_view<double>, double>::value, "");
+
+TEST(NDArrayViewTest, AccessAndSlicing) {
+  using ndarray::range;
+  ndarray::ndarray<double> array(3, 4, 5);
+  initialize_array(array);
+  ndarray::ndarray_view<double> view = array;
+  ASSERT_EQ(view.dim(), 3u);
+  ASSERT_EQ(view.size(), array.size());
+  ASSERT_EQ(view.shape(), array.shape());
+  ASSERT_EQ(view.strides(), array.strides());
+  ASSERT_TRUE(view.is_contiguous());
+  ASSERT_EQ(view.at(1, 2, 3), array.at(1, 2, 3));
+  ndarray::ndarray_view<double> row = view(2, 1);
+  ASSERT_EQ(row.dim(), 1u);
+  ASSERT_EQ(row.at(4), array.at(2, 1, 4));
+  // views refer to the elements of the array
+  row.at(0) = -1.0;
+  ASSERT_EQ(array.at(2, 1, 0), -1.0);
+  view(1).set_value(2.0);
+  ASSERT_EQ(array.at(1, 3, 4), 2.0);
+  ndarray::ndarray_view<double> strided = view(range(ndarray::none, ndarray::none, -1), 2, range(0, 5, 2));
+  ASSERT_EQ(strided.shape(), (std::vector<size_t>{3, 3}));
+  ASSERT_FALSE(strided.is_contiguous());
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      ASSERT_EQ(strided.at(i, j), array.at(2 - i, 2, 2 * j));
+    }
+  }
+  ndarray::ndarray<double> dense = strided.copy();
+  ASSERT_TRUE(dense.is_contiguous());
+  ASSERT_EQ(dense.at(2, 1), array.at(0, 2, 2));
+  // read-only views of arrays and of views
+  const ndarray::ndarray<double> &carray = array;
+  ndarray::ndarray_view<const double> cview = carray(0);
+  ndarray::ndarray_view<const double> crow = row;
+  ASSERT_EQ(cview.at(3, 4), array.at(0, 3, 4));
+  ASSERT_EQ(crow.data(), row.data());
+  double buffer[6] = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0};
+  ndarray::ndarray_view<double> matrix(buffer, {2, 3});
+  ASSERT_EQ(matrix.at(1, 0), 3.0);
+  ASSERT_EQ(ndarray::ndarray_view<double>().size(), 0u);
+  ASSERT_THROW(ndarray::ndarray_view<double>(buffer, ndarray::shape_t(NDARRAY_INLINE_RANK + 1, 1)),
+               std::runtime_error);
+#if NDARRAY_CHECKED_ACCESS
+  ASSERT_THROW(view.at(3, 0, 0), ndarray::index_error);
+#endif
+}
+
+TEST(NDArrayViewTest, NoReferenceCounting) {
+  using ndarray::range;
+  ndarray::ndarray<double> array(4, 6);
+  initialize_array(array);
+  long count = array.data().use_count();
+  ndarray::ndarray_view<double> view = array;
+  ndarray::ndarray_view<double> reversed = view(range(ndarray::none, ndarray::none, -1), 1);
+  // conversion back gives an ndarray that does not own the elements, so it has to be requested explicitly
+  ndarray::ndarray<double> converted = reversed.unowned_array();
+  ASSERT_TRUE(ndarray::ndarray<double>(reversed) == converted);
+  ASSERT_EQ(array.data().use_count(), count);
+  ASSERT_EQ(converted.data().use_count(), 0);
+  ASSERT_EQ(converted.shape(), (std::vector<size_t>{4}));
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(converted.at(i), array.at(3 - i, 1));
+  }
+  ASSERT_TRUE(ndarray::ndarray<double>(ndarray::ndarray_view<double>()).data() == nullptr);
+}
+
+TEST(NDArrayViewTest, Arithmetic) {
+  ndarray::ndarray<double> a(3, 4);
+  ndarray::ndarray<double> b(3, 4);
+  ndarray::ndarray<double> c(4);
+  initialize_array(a);
+  initialize_array(b);
+  initialize_array(c);
+  ndarray::ndarray_view<double> va = a, vb = b, vc = c;
+  ndarray::ndarray<double> sum = va + vb;
+  ndarray::ndarray<double> mixed = va - b + 1.0;
+  ndarray::ndarray<double> broadcast = vc + a;
+  ndarray::ndarray<double> negated = -va;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      ASSERT_EQ(sum.at(i, j), a.at(i, j) + b.at(i, j));
+      ASSERT_EQ(mixed.at(i, j), a.at(i, j) - b.at(i, j) + 1.0);
+      ASSERT_EQ(broadcast.at(i, j), c.at(j) + a.at(i, j));
+      ASSERT_EQ(negated.at(i, j), -a.at(i, j));
+    }
+  }
+  ASSERT_TRUE(va == a);
+  ASSERT_TRUE(b == vb);
+  // in place operations on views write to the viewed array
+  ndarray::ndarray<double> expected = a.copy();
+  expected += b;
+  expected *= 2.0;
+  expected -= c;
+  va += vb;
+  va *= 2.0;
+  va -= vc;
+  ASSERT_TRUE(a == expected);
+  ndarray::ndarray<double> d = b.copy();
+  d /= vb;
+  ndarray::ndarray<double> ones(3, 4);
+  ones.set_value(1.0);
+  ASSERT_TRUE(ndarray::allclose(d, ones));
+  expected = b.copy();
+  ndarray::axpy(0.5, va, expected);
+  ndarray::axpy(0.5, a, vb);
+  ASSERT_TRUE(b == expected);
+  ndarray::axpby(2.0, vc, 3.0, vb(1));
+  ndarray::scale(0.25, vb(2));
+  ndarray::ndarray<double> first = expected(1), second = expected(2);
+  ndarray::axpby(2.0, c, 3.0, first);
+  ndarray::scale(0.25, second);
+  ASSERT_TRUE(b == expected);
+}
+
+TEST(NDArrayViewTest, Reductions) {
+  ndarray::ndarray<std::complex<double> > a(5, 6);
+  ndarray::ndarray<std::complex<double> > b(5, 6);
+  initialize_array(a);
+  initialize_array(b);
+  b *= std::complex<double>(0.5, 1.0);
+  ndarray::ndarray_view<std::complex<double> > va = a;
+  ndarray::ndarray_view<const std::complex<double> > vb = b;
+  ASSERT_EQ(ndarray::sum(va), ndarray::sum(a));
+  ASSERT_TRUE(ndarray::sum(va, {1}) == ndarray::sum(a, {1}));
+  ASSERT_EQ(ndarray::prod(va(1)), ndarray::prod(a(1)));
+  ASSERT_TRUE(ndarray::prod(va, {0}) == ndarray::prod(a, {0}));
+  ASSERT_EQ(ndarray::max_abs(va), ndarray::max_abs(a));
+  ASSERT_TRUE(ndarray::max_abs(va, {0}) == ndarray::max_abs(a, {0}));
+  ASSERT_EQ(ndarray::norm(va), ndarray::norm(a));
+  ASSERT_TRUE(ndarray::norm(va, {1}) == ndarray::norm(a, {1}));
+  ASSERT_EQ(ndarray::dot(va, vb), ndarray::dot(a, b));
+  ASSERT_EQ(ndarray::vdot(a, vb), ndarray::vdot(a, b));
+  ASSERT_EQ(ndarray::max_abs_diff(va, b), ndarray::max_abs_diff(a, b));
+  ASSERT_TRUE(ndarray::allclose(va, a));
+  ASSERT_FALSE(ndarray::allclose(a, vb));
+}
+
+TEST(NDArrayViewTest, Contractions) {
+  ndarray::ndarray<double> a(4, 3, 5);
+  ndarray::ndarray<double> b(5, 2);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray_view<double> va = a, vb = b;
+  ndarray::ndarray_view<double> transposed = ndarray::transpose_view(va, "ijk->kji");
+  ASSERT_EQ(transposed.shape(), (std::vector<size_t>{5, 3, 4}));
+  ASSERT_EQ(transposed.at(4, 1, 2), a.at(2, 1, 4));
+  ASSERT_TRUE(ndarray::transpose(va, "ijk->kji") == ndarray::transpose(a, "ijk->kji"));
+  ASSERT_TRUE(ndarray::permute_view(va, {1, 0, 2}) == ndarray::permute_view(a, {1, 0, 2}));
+  ASSERT_TRUE(ndarray::broadcast_view(vb(1), {3, 2}) == ndarray::broadcast_view(b(1), {3, 2}));
+  ndarray::ndarray<double> product = ndarray::matmul(a, b);
+  ASSERT_TRUE(ndarray::allclose(ndarray::matmul(va, vb), product));
+  ASSERT_TRUE(ndarray::allclose(ndarray::matmul(va(1), b), ndarray::matmul(a(1), b)));
+  ASSERT_TRUE(ndarray::allclose(ndarray::tensordot(va, vb, 1), product));
+  ASSERT_TRUE(ndarray::allclose(ndarray::tensordot(a, vb, {2}, {0}), product));
+  ASSERT_TRUE(ndarray::allclose(ndarray::einsum("ijk,kl->ijl", va, b), product));
+  ndarray::ndarray<double> c = a(0);
+  ASSERT_TRUE(ndarray::allclose(ndarray::einsum("ijk,kl,jm->iml", a, vb, ndarray::ndarray_view<double>(c)),
+                                ndarray::einsum("ijk,kl,jm->iml", a, b, c)));
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <complex>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ndarray_math.h>
+#include <reduction.h>
+
+#include "common.h"
+
+TEST(ParallelTest, ParallelFor) {
+  parallel_scope scope(4);
+  const size_t n = 100003;
+  std::vector<std::atomic<int> > visits(n);
+  ndarray::detail::parallel_for(n, sizeof(double), [&visits](size_t begin, size_t end) {
+    // chunks start at cache line boundaries
+    ASSERT_EQ(begin % (ndarray::cache_line_size / sizeof(double)), 0);
+    for (size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(visits[i], 1);
+  }
+}
+
+TEST(ParallelTest, TaskExceptions) {
+  ndarray::detail::thread_pool pool(4);
+  std::atomic<int> done(0);
+  // exceptions from workers and from the calling thread reach the caller after all tasks completed
+  for (size_t thrower = 0; thrower < pool.size(); ++thrower) {
+    done = 0;
+    auto task = [&done, thrower](size_t i) {
+      ++done;
+      if (i == thrower) {
+        throw std::runtime_error("task " + std::to_string(i));
+      }
+    };
+    ASSERT_THROW(pool.run(pool.size(), task), std::runtime_error);
+    ASSERT_EQ(done, int(pool.size()));
+  }
+  auto all = [](size_t i) {
+    throw std::invalid_argument("task " + std::to_string(i));
+  };
+  ASSERT_THROW(pool.run(pool.size(), all), std::invalid_argument);
+  // the pool remains usable
+  done = 0;
+  auto count = [&done](size_t) { ++done; };
+  pool.run(pool.size(), count);
+  ASSERT_EQ(done, int(pool.size()));
+  parallel_scope scope(4);
+  ASSERT_THROW(ndarray::detail::parallel_for(size_t(1) << 20, sizeof(double), [](size_t begin, size_t) {
+    if (begin != 0) {
+      throw std::runtime_error("chunk");
+    }
+  }), std::runtime_error);
+}
+
+TEST(ParallelTest, ThreadCountChanges) {
+  parallel_scope scope(4);
+  const size_t n = 1 << 16;
+  ndarray::ndarray<double> ones(n);
+  ones.set_value(1.0);
+  std::atomic<bool> stop(false);
+  // every item is processed exactly once while another thread changes the number of threads
+  std::thread changer([&stop]() {
+    for (size_t threads = 2; !stop; threads = threads % 7 + 2) {
+      ndarray::set_num_threads(threads);
+      std::this_thread::yield();
+    }
+  });
+  size_t missed = 0, wrong_sums = 0;
+  for (size_t repeat = 0; repeat < 200; ++repeat) {
+    std::vector<std::atomic<int> > visits(n);
+    ndarray::detail::parallel_for(n, sizeof(double), [&visits](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    for (size_t i = 0; i < n; ++i) {
+      missed += visits[i] != 1;
+    }
+    wrong_sums += ndarray::sum(ones) != double(n);
+  }
+  stop = true;
+  changer.join();
+  ASSERT_EQ(missed, 0u);
+  ASSERT_EQ(wrong_sums, 0u);
+}
+
+TEST(ParallelTest, MatchesSerial) {
+  ndarray::ndarray<double> a(64, 33, 17);
+  ndarray::ndarray<std::complex<double> > b(64, 33, 17);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> at = ndarray::transpose_view(a, "ijk->kji");
+  ndarray::ndarray<std::complex<double> > expected_sum = b + a;
+  ndarray::ndarray<double> expected_copy = at.copy();
+  ndarray::ndarray<double> expected_strided = at + at;
+  ndarray::ndarray<std::complex<double> > expected_inplace = b.copy();
+  expected_inplace -= a;
+  ndarray::ndarray<double> expected_fill = a.copy();
+  ndarray::ndarray<double>(expected_fill(ndarray::range(), ndarray::range(1, ndarray::none, 3))).set_value(2.0);
+
+  parallel_scope scope(4);
+  ASSERT_EQ(ndarray::ndarray<std::complex<double> >(b + a), expected_sum);
+  ASSERT_EQ(at.copy(), expected_copy);
+  ASSERT_EQ(ndarray::transpose_plan("ijk->kji", a.shape(), a.strides()).execute(a), expected_copy);
+  ASSERT_EQ(ndarray::ndarray<double>(at + at), expected_strided);
+  ndarray::ndarray<std::complex<double> > inplace = b.copy();
+  inplace -= a;
+  ASSERT_EQ(inplace, expected_inplace);
+  ndarray::ndarray<double> fill = a.copy();
+  ndarray::ndarray<double>(fill(ndarray::range(), ndarray::range(1, ndarray::none, 3))).set_value(2.0);
+  ASSERT_EQ(fill, expected_fill);
+  // one-dimensional strided operand and zero-dimension array
+  ndarray::ndarray<double> column = a(ndarray::range(), 3, 5);
+  ASSERT_EQ(ndarray::ndarray<double>(column + column).at(7), 2 * a.at(7, 3, 5));
+  ndarray::ndarray<double> scalar(std::vector<size_t>{});
+  scalar.set_value(5.0);
+  ASSERT_EQ(double(scalar), 5.0);
+}
+
+TEST(ParallelTest, SmallLeadingExtent) {
+  ndarray::ndarray<double> a(301, 257, 2);
+  ndarray::ndarray<double> b(2, 3, 97, 211);
+  initialize_array(a);
+  initialize_array(b);
+  ndarray::ndarray<double> at = ndarray::transpose_view(a, "ijk->kji");
+  ndarray::ndarray<double> bt = ndarray::transpose_view(b, "ijkl->ilkj");
+  ndarray::ndarray<double> expected_copy = at.copy();
+  ndarray::ndarray<double> expected_transpose = bt.copy();
+  ndarray::ndarray<double> expected_sum = at + at;
+  ndarray::range odd(1, ndarray::none, 2);
+  ndarray::ndarray<double> expected_fill = b.copy();
+  ndarray::ndarray<double>(expected_fill(ndarray::range(), ndarray::range(), odd)).set_value(2.0);
+
+  parallel_scope scope(4);
+  ASSERT_EQ(at.copy(), expected_copy);
+  ASSERT_EQ(bt.copy(), expected_transpose);
+  // plans split their precomputed layout between threads
+  ASSERT_EQ(ndarray::transpose_plan("ijk->kji", a.shape(), a.strides()).execute(a), expected_copy);
+  ASSERT_EQ(ndarray::transpose_plan("ijkl->ilkj", b.shape(), b.strides()).execute(b), expected_transpose);
+  ASSERT_EQ(ndarray::ndarray<double>(at + at), expected_sum);
+  ndarray::ndarray<double> fill = b.copy();
+  ndarray::ndarray<double>(fill(ndarray::range(), ndarray::range(), odd)).set_value(2.0);
+  ASSERT_EQ(fill, expected_fill);
+  // an array with two leading rows is still processed by all threads
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  ndarray::ndarray<double> c(2, 256, 256);
+  ndarray::detail::parallel_strided_for_each(c.shape(), c.data().get(), c.strides(), [&](double &x) {
+    x = 1.0;
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  });
+  ASSERT_EQ(threads.size(), 4u);
+  ASSERT_EQ(ndarray::sum(c), double(c.size()));
+}
+
+TEST(ParallelTest, ThreadCount) {
+  size_t previous = ndarray::set_num_threads(3);
+  ASSERT_EQ(ndarray::get_num_threads(), 3);
+  ndarray::set_num_threads(0);
+  ASSERT_EQ(ndarray::get_num_threads(), 1);
+  ndarray::set_num_threads(previous);
+}
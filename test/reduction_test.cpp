@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2021-2022 Sergei Iskakov
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include <reduction.h>
+
+#include "common.h"
+
+namespace {
+
+  ndarray::ndarray<std::complex<double> > complex_array(size_t n, unsigned seed) {
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    ndarray::ndarray<std::complex<double> > array(n);
+    for (size_t i = 0; i < n; ++i) {
+      array(i) = std::complex<double>(dist(engine), dist(engine));
+    }
+    return array;
+  }
+
+  template<typename T>
+  bool same_bits(const T &a, const T &b) {
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+  }
+
+}
+
+TEST(ReductionTest, Sum) {
+  ndarray::ndarray<double> a(7, 3, 1000);
+  initialize_array(a);
+  long double ref = 0;
+  for (double v : a) {
+    ref += v;
+  }
+  ASSERT_NEAR(ndarray::sum(a), double(ref), 1e-9 * double(ref));
+  ASSERT_NEAR(ndarray::sum(a, ndarray::summation::compensated), double(ref), 1e-15 * double(ref));
+  // strided view is summed in the same order as a dense copy
+  ndarray::ndarray<double> t = ndarray::transpose_view(a, "ijk->kji");
+  ASSERT_EQ(ndarray::sum(t), ndarray::sum(ndarray::transpose(a, "ijk->kji")));
+  ndarray::ndarray<float> f(1001);
+  ndarray::ndarray<int> i(1001);
+  initialize_array(f);
+  initialize_array(i);
+  double ref_f = 0;
+  int ref_i = 0;
+  for (size_t k = 0; k < 1001; ++k) {
+    ref_f += f(k);
+    ref_i += i(k);
+  }
+  ASSERT_NEAR(ndarray::sum(f), ref_f, 1e-5 * ref_f);
+  ASSERT_EQ(ndarray::sum(i), ref_i);
+  ndarray::ndarray<std::complex<double> > c = complex_array(12345, 1);
+  std::complex<double> ref_c = 0;
+  for (size_t k = 0; k < c.size(); ++k) {
+    ref_c += c.at(k);
+  }
+  ASSERT_NEAR(std::abs(ndarray::sum(c) - ref_c), 0.0, 1e-10);
+  ASSERT_EQ(ndarray::sum(ndarray::ndarray<double>(0, 5)), 0.0);
+}
+
+TEST(ReductionTest, CompensatedSum) {
+  const size_t n = 1000000;
+  ndarray::ndarray<double> a(n);
+  a.set_value(1e-16);
+  a(0) = 1.0;
+  double exact = double(1.0L + (n - 1) * 1e-16L);
+  double standard = ndarray::sum(a);
+  double compensated = ndarray::sum(a, ndarray::summation::compensated);
+  ASSERT_GT(std::abs(standard - exact), 1e-14);
+  ASSERT_DOUBLE_EQ(compensated, exact);
+  ndarray::ndarray<std::complex<float> > c(n);
+  c.set_value(std::complex<float>(0.1f, -0.1f));
+  std::complex<float> s = ndarray::sum(c, ndarray::summation::compensated);
+  ASSERT_FLOAT_EQ(s.real(), float(n * (long double)(0.1f)));
+  ASSERT_FLOAT_EQ(s.imag(), -float(n * (long double)(0.1f)));
+}
+
+TEST(ReductionTest, Axes) {
+  ndarray::ndarray<double> a(4, 5, 6);
+  initialize_array(a);
+  ndarray::ndarray<double> s0 = ndarray::sum(a, {0});
+  ndarray::ndarray<double> s2 = ndarray::sum(a, {2});
+  ndarray::ndarray<double> s02 = ndarray::sum(a, {2, 0});
+  ndarray::ndarray<double> p1 = ndarray::prod(a, {1});
+  ASSERT_EQ(s0.shape(), std::vector<size_t>({5, 6}));
+  ASSERT_EQ(s2.shape(), std::vector<size_t>({4, 5}));
+  ASSERT_EQ(s02.shape(), std::vector<size_t>({5}));
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 5; ++j) {
+      for (size_t k = 0; k < 6; ++k) {
+        double r0 = 0, r2 = 0, p = 1;
+        for (size_t q = 0; q < 4; ++q) {
+          r0 += a(q, j, k);
+        }
+        for (size_t q = 0; q < 6; ++q) {
+          r2 += a(i, j, q);
+        }
+        for (size_t q = 0; q < 5; ++q) {
+          p *= a(i, q, k);
+        }
+        ASSERT_NEAR(s0(j, k), r0, 1e-12);
+        ASSERT_NEAR(s2(i, j), r2, 1e-12);
+        ASSERT_NEAR(p1(i, k), p, 1e-10 * p);
+      }
+    }
+  }
+  for (size_t j = 0; j < 5; ++j) {
+    double ref = 0;
+    for (size_t i = 0; i < 4; ++i) {
+      for (size_t k = 0; k < 6; ++k) {
+        ref += a(i, j, k);
+      }
+    }
+    ASSERT_NEAR(s02(j), ref, 1e-11);
+  }
+  // reduction over all axes is the full reduction, over no axes is a copy
+  ndarray::ndarray<double> all = ndarray::sum(a, {0, 1, 2});
+  ASSERT_EQ(all.dim(), 0ul);
+  ASSERT_EQ(*all.data().get(), ndarray::sum(a));
+  ASSERT_TRUE(ndarray::sum(a, std::vector<size_t>()) == a);
+  ASSERT_THROW(ndarray::sum(a, {3}), std::runtime_error);
+  ASSERT_THROW(ndarray::sum(a, {1, 1}), std::runtime_error);
+  // empty reduced dimension gives identities
+  ndarray::ndarray<double> e = ndarray::prod(ndarray::ndarray<double>(3, 0), {1});
+  ASSERT_EQ(e.shape(), std::vector<size_t>({3}));
+  ASSERT_EQ(e(1), 1.0);
+}
+
+TEST(ReductionTest, NormAndMaxAbs) {
+  ndarray::ndarray<std::complex<double> > c = complex_array(10007, 2);
+  double squares = 0, largest = 0;
+  for (size_t k = 0; k < c.size(); ++k) {
+    squares += std::norm(c.at(k));
+    largest = std::max(largest, std::abs(c.at(k)));
+  }
+  ASSERT_NEAR(ndarray::norm(c), std::sqrt(squares), 1e-12 * std::sqrt(squares));
+  ASSERT_EQ(ndarray::max_abs(c), largest);
+  ndarray::ndarray<float> f(3, 1000);
+  initialize_array(f);
+  f(1, 517) = -20.0f;
+  ASSERT_EQ(ndarray::max_abs(f), 20.0f);
+  ndarray::ndarray<float> rows = ndarray::max_abs(f, {1});
+  ndarray::ndarray<float> columns = ndarray::norm(f, {0});
+  ASSERT_EQ(rows(1), 20.0f);
+  ASSERT_NEAR(columns(517), std::sqrt(f(0, 517) * f(0, 517) + 400.0f + f(2, 517) * f(2, 517)), 1e-4);
+  ASSERT_EQ(ndarray::norm(ndarray::ndarray<int>(0)), 0.0);
+  // NaN is propagated, infinity is the largest value
+  f(2, 3) = std::numeric_limits<float>::infinity();
+  ASSERT_TRUE(std::isinf(ndarray::max_abs(f)));
+  f(0, 999) = std::numeric_limits<float>::quiet_NaN();
+  ASSERT_TRUE(std::isnan(ndarray::max_abs(f)));
+  ASSERT_TRUE(std::isnan(ndarray::max_abs(f, {1})(0)));
+  ASSERT_TRUE(std::isnan(ndarray::max_abs(f, {0})(999)));
+}
+
+TEST(ReductionTest, Dot) {
+  ndarray::ndarray<std::complex<double> > a = complex_array(5003, 3);
+  ndarray::ndarray<std::complex<double> > b = complex_array(5003, 4);
+  std::complex<double> dot = 0, vdot = 0;
+  for (size_t k = 0; k < a.size(); ++k) {
+    dot += a.at(k) * b.at(k);
+    vdot += std::conj(a.at(k)) * b.at(k);
+  }
+  ASSERT_NEAR(std::abs(ndarray::dot(a, b) - dot), 0.0, 1e-10);
+  ASSERT_NEAR(std::abs(ndarray::vdot(a, b) - vdot), 0.0, 1e-10);
+  ASSERT_NEAR(std::abs(ndarray::dot(a, b, ndarray::summation::compensated) - dot), 0.0, 1e-10);
+  ASSERT_NEAR(std::abs(ndarray::vdot(a, b, ndarray::summation::compensated) - vdot), 0.0, 1e-10);
+  ASSERT_NEAR(ndarray::vdot(a, a).real(), ndarray::norm(a) * ndarray::norm(a), 1e-9);
+  ASSERT_NEAR(ndarray::vdot(a, a).imag(), 0.0, 1e-12);
+  ndarray::ndarray<double> x(40, 50);
+  ndarray::ndarray<float> y(50, 40);
+  initialize_array(x);
+  initialize_array(y);
+  ndarray::ndarray<float> yt = ndarray::transpose_view(y, "ij->ji");
+  double ref = 0;
+  for (size_t i = 0; i < 40; ++i) {
+    for (size_t j = 0; j < 50; ++j) {
+      ref += x(i, j) * double(y(j, i));
+    }
+  }
+  ASSERT_NEAR(ndarray::dot(x, yt), ref, 1e-12 * ref);
+  ASSERT_THROW(ndarray::dot(x, y), std::runtime_error);
+}
+
+TEST(ReductionTest, Reproducible) {
+  ndarray::ndarray<double> a(200003);
+  initialize_array(a);
+  ndarray::ndarray<std::complex<double> > c = complex_array(100003, 5);
+  ndarray::ndarray<std::complex<double> > d = complex_array(100003, 6);
+  ndarray::ndarray<double> m(300, 700);
+  initialize_array(m);
+  const double sum = ndarray::sum(a);
+  const double compensated = ndarray::sum(a, ndarray::summation::compensated);
+  const double norm = ndarray::norm(a);
+  const std::complex<double> vdot = ndarray::vdot(c, d, ndarray::summation::compensated);
+  const ndarray::ndarray<double> rows = ndarray::sum(m, {1});
+  const ndarray::ndarray<double> columns = ndarray::sum(m, {0});
+  for (size_t threads : {1, 3, 4}) {
+    parallel_scope scope(threads);
+    for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+      ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+      ASSERT_TRUE(same_bits(ndarray::sum(a), sum));
+      ASSERT_TRUE(same_bits(ndarray::sum(a, ndarray::summation::compensated), compensated));
+      ASSERT_TRUE(same_bits(ndarray::norm(a), norm));
+      ASSERT_TRUE(same_bits(ndarray::vdot(c, d, ndarray::summation::compensated), vdot));
+      ndarray::ndarray<double> r = ndarray::sum(m, {1});
+      ndarray::ndarray<double> s = ndarray::sum(m, {0});
+      ASSERT_EQ(std::memcmp(r.data().get(), rows.data().get(), sizeof(double) * r.size()), 0);
+      ASSERT_EQ(std::memcmp(s.data().get(), columns.data().get(), sizeof(double) * s.size()), 0);
+      ndarray::set_simd_level(previous);
+    }
+  }
+}
+
+TEST(ReductionTest, Allclose) {
+  ndarray::ndarray<double> a(3, 50000);
+  initialize_array(a);
+  ndarray::ndarray<double> b = a.copy();
+  b(2, 40000) += 1e-6;
+  for (int level = 0; level <= int(ndarray::simd_level::avx512); ++level) {
+    ndarray::simd_level previous = ndarray::set_simd_level(ndarray::simd_level(level));
+    ASSERT_TRUE(ndarray::allclose(a, b));
+    ASSERT_FALSE(ndarray::allclose(a, b, 0.0, 1e-7));
+    ASSERT_TRUE(ndarray::allclose(a, b, 0.0, 2e-6));
+    ASSERT_NEAR(ndarray::max_abs_diff(a, b), 1e-6, 1e-12);
+    ndarray::set_simd_level(previous);
+  }
+  // strided and broadcast operands, mixed types
+  ndarray::ndarray<float> row(50000);
+  initialize_array(row);
+  ndarray::ndarray<double> rows(3, 50000);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 50000; ++j) {
+      rows.at(i, j) = row.at(j);
+    }
+  }
+  ASSERT_TRUE(ndarray::allclose(rows, row, 0.0, 0.0));
+  ASSERT_EQ(ndarray::max_abs_diff(ndarray::transpose_view(rows, "ij->ji"), ndarray::transpose_view(rows, "ij->ji")), 0.0);
+  rows(1, 7) = 100.0;
+  ASSERT_FALSE(ndarray::allclose(row, rows));
+  ASSERT_NEAR(ndarray::max_abs_diff(row, rows), 100.0 - row.at(7), 1e-5);
+  ASSERT_THROW(ndarray::allclose(a, ndarray::ndarray<double>(4)), std::runtime_error);
+  // special values
+  ndarray::ndarray<double> x(40);
+  x.set_value(1.0);
+  ndarray::ndarray<double> y = x.copy();
+  x(3) = std::numeric_limits<double>::infinity();
+  y(3) = std::numeric_limits<double>::infinity();
+  ASSERT_TRUE(ndarray::allclose(x, y));
+  y(3) = -std::numeric_limits<double>::infinity();
+  ASSERT_FALSE(ndarray::allclose(x, y));
+  x(3) = 1e300;
+  ASSERT_FALSE(ndarray::allclose(x, y));
+  x(3) = std::numeric_limits<double>::quiet_NaN();
+  y(3) = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_FALSE(ndarray::allclose(x, y));
+  ASSERT_TRUE(std::isnan(ndarray::max_abs_diff(x, y)));
+  // complex and unsigned elements
+  ndarray::ndarray<std::complex<double> > c = complex_array(1000, 7);
+  ndarray::ndarray<std::complex<double> > d = c.copy();
+  d.at(10) += std::complex<double>(3e-3, 4e-3);
+  ASSERT_NEAR(ndarray::max_abs_diff(c, d), 5e-3, 1e-12);
+  ASSERT_TRUE(ndarray::allclose(c, d, 0.0, 6e-3));
+  ASSERT_FALSE(ndarray::allclose(c, d, 0.0, 4e-3));
+  ndarray::ndarray<unsigned> u(4), v(4);
+  u.set_value(5u);
+  v.set_value(7u);
+  ASSERT_EQ(ndarray::max_abs_diff(u, v), 2u);
+  ASSERT_TRUE(ndarray::allclose(u, v, 0.3));
+  ASSERT_FALSE(ndarray::allclose(u, v, 0.2));
+}